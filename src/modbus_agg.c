@@ -0,0 +1,217 @@
+/**
+ * @file modbus_agg.c
+ * @brief Streaming window aggregate implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_agg.h"
+#include <math.h>
+#include <string.h>
+
+/* Per-point bytes: six doubles, two timestamps, a record, a count and a flag */
+#define AGG_POINT_BYTES         (6 * sizeof(double) + 2 * sizeof(uint64_t) + \
+                                 sizeof(modbus_agg_record_t) + sizeof(uint32_t) + 1)
+
+/* Helper function prototypes */
+static size_t close_window(modbus_agg_t *agg, uint64_t end);
+static void drop_last(modbus_agg_t *agg);
+
+size_t modbus_agg_size(size_t point_count)
+{
+    return point_count * AGG_POINT_BYTES;
+}
+
+int modbus_agg_init(modbus_agg_t *agg,
+                    size_t point_count,
+                    uint64_t window,
+                    void *storage,
+                    size_t storage_size)
+{
+    uint8_t *p = (uint8_t *)storage;
+
+    if (!agg || (!storage && point_count)) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (window == 0) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    if (storage_size < modbus_agg_size(point_count)) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    memset(agg, 0, sizeof(*agg));
+    agg->point_count = point_count;
+    agg->window = window;
+
+    /* Widest members first keeps every array aligned */
+    agg->min = (double *)(void *)p;
+    agg->max = agg->min + point_count;
+    agg->sum = agg->max + point_count;
+    agg->first = agg->sum + point_count;
+    agg->last = agg->first + point_count;
+    agg->area = agg->last + point_count;
+    agg->last_timestamp = (uint64_t *)(void *)(agg->area + point_count);
+    agg->since = agg->last_timestamp + point_count;
+    agg->records = (modbus_agg_record_t *)(void *)(agg->since + point_count);
+    agg->count = (uint32_t *)(void *)(agg->records + point_count);
+    agg->has_last = (uint8_t *)(agg->count + point_count);
+
+    memset(storage, 0, modbus_agg_size(point_count));
+    return MODBUS_CONV_OK;
+}
+
+void modbus_agg_begin(modbus_agg_t *agg, uint64_t timestamp)
+{
+    uint64_t start;
+
+    if (!agg) {
+        return;
+    }
+    agg->record_count = 0;
+    if (agg->started && timestamp - agg->window_start < agg->window) {
+        return;
+    }
+
+    start = timestamp - timestamp % agg->window;
+    if (agg->started) {
+        size_t i;
+
+        close_window(agg, agg->window_start + agg->window);
+
+        /* Carried values are integrated from the start of the new window */
+        for (i = 0; i < agg->point_count; i++) {
+            agg->last_timestamp[i] = start;
+            agg->since[i] = start;
+        }
+    } else {
+        /* Nothing is carried into the first window after a flush */
+        drop_last(agg);
+    }
+    agg->window_start = start;
+    agg->started = true;
+}
+
+void modbus_agg_add(modbus_agg_t *agg, size_t point, double value, uint64_t timestamp)
+{
+    if (!agg || point >= agg->point_count || !isfinite(value)) {
+        return;
+    }
+
+    if (agg->has_last[point]) {
+        agg->area[point] += agg->last[point] * (double)(timestamp - agg->last_timestamp[point]);
+    } else {
+        agg->since[point] = timestamp;
+        agg->has_last[point] = 1;
+    }
+
+    if (agg->count[point] == 0) {
+        agg->first[point] = value;
+        agg->min[point] = value;
+        agg->max[point] = value;
+    } else {
+        if (value < agg->min[point]) {
+            agg->min[point] = value;
+        }
+        if (value > agg->max[point]) {
+            agg->max[point] = value;
+        }
+    }
+    agg->sum[point] += value;
+    agg->last[point] = value;
+    agg->last_timestamp[point] = timestamp;
+    agg->count[point]++;
+}
+
+int modbus_agg_update(modbus_agg_t *agg,
+                      const modbus_plan_t *plan,
+                      const modbus_value_t *values,
+                      const int *status,
+                      uint64_t timestamp)
+{
+    size_t i;
+
+    if (!agg || !plan || !values) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (plan->point_count > agg->point_count) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    modbus_agg_begin(agg, timestamp);
+    for (i = 0; i < plan->point_count; i++) {
+        if (status && status[i] != MODBUS_CONV_OK) {
+            continue;
+        }
+        modbus_agg_add(agg, i, modbus_value_to_double(plan->points[i].data_type, &values[i]), timestamp);
+    }
+    return MODBUS_CONV_OK;
+}
+
+size_t modbus_agg_flush(modbus_agg_t *agg, uint64_t timestamp)
+{
+    uint64_t end;
+
+    if (!agg || !agg->started) {
+        return 0;
+    }
+    end = agg->window_start + agg->window;
+    if (timestamp < end) {
+        end = timestamp;
+    }
+    agg->record_count = close_window(agg, end);
+    agg->started = false;
+    drop_last(agg);
+    return agg->record_count;
+}
+
+/* Helper function implementations */
+
+/* Emits records for points with samples and resets the window state */
+static size_t close_window(modbus_agg_t *agg, uint64_t end)
+{
+    size_t n = 0;
+    size_t i;
+
+    for (i = 0; i < agg->point_count; i++) {
+        modbus_agg_record_t *r;
+        double span;
+
+        if (agg->count[i] == 0) {
+            continue;
+        }
+        r = &agg->records[n++];
+        span = (double)(end - agg->since[i]);
+        r->window_start = agg->window_start;
+        r->point = (uint32_t)i;
+        r->count = agg->count[i];
+        r->min = agg->min[i];
+        r->max = agg->max[i];
+        r->mean = agg->sum[i] / agg->count[i];
+        r->first = agg->first[i];
+        r->last = agg->last[i];
+        r->twa = span > 0 ? (agg->area[i] + agg->last[i] * (double)(end - agg->last_timestamp[i])) / span
+                          : agg->last[i];
+    }
+
+    /* Plain array resets, left to the compiler to vectorize */
+    for (i = 0; i < agg->point_count; i++) {
+        agg->count[i] = 0;
+        agg->sum[i] = 0.0;
+        agg->area[i] = 0.0;
+    }
+
+    agg->record_count = n;
+    return n;
+}
+
+/* Forgets the carried values, so the gap after a flush is not integrated */
+static void drop_last(modbus_agg_t *agg)
+{
+    size_t i;
+
+    for (i = 0; i < agg->point_count; i++) {
+        agg->has_last[i] = 0;
+        agg->last_timestamp[i] = 0;
+        agg->since[i] = 0;
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * @file modbus_agg.h
+ * @brief Streaming window aggregates of converted values
+ * @details Per-point min, max, sum, count, first, last and time-weighted
+ *          average over fixed, epoch-aligned windows (e.g. one minute). The
+ *          aggregates are updated inside the plan executor's conversion loop
+ *          (modbus_plan_execute_agg()), so no second pass over the results is
+ *          needed. When a sample falls past the current window, one compact
+ *          record per point with samples is emitted into agg->records.
+ *
+ *          The time-weighted average treats values as steps: each value
+ *          holds until the next sample, and the last value of a window is
+ *          carried into the next one.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_AGG_H
+#define MODBUS_AGG_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Aggregate of one point over one window, one cache line */
+typedef struct {
+    uint64_t window_start;          /* Start of the window */
+    uint32_t point;                 /* Point index */
+    uint32_t count;                 /* Samples in the window */
+    double min;
+    double max;
+    double mean;
+    double first;
+    double last;
+    double twa;                     /* Time-weighted average */
+} modbus_agg_record_t;
+
+/* Aggregation state; per-point fields are arrays in caller storage */
+struct modbus_agg {
+    size_t point_count;             /* Points aggregated */
+    uint64_t window;                /* Window length in timestamp units */
+    uint64_t window_start;          /* Start of the current window */
+    bool started;                   /* A window is open */
+
+    double *min;
+    double *max;
+    double *sum;
+    double *first;
+    double *last;
+    double *area;                   /* Integral of the value over time */
+    uint64_t *last_timestamp;       /* Time of the last value (or window start) */
+    uint64_t *since;                /* Start of the integrated span */
+    uint32_t *count;
+    uint8_t *has_last;              /* last holds a value */
+
+    modbus_agg_record_t *records;   /* Records of the last closed window */
+    size_t record_count;            /* Valid until the next window closes */
+};
+
+typedef struct modbus_agg modbus_agg_t;
+
+/**
+ * @brief Storage needed for an aggregator
+ * @param point_count Number of points
+ * @return Size in bytes for modbus_agg_init()
+ */
+size_t modbus_agg_size(size_t point_count);
+
+/**
+ * @brief Initialize an aggregator
+ * @param agg Aggregator
+ * @param point_count Number of points (plan->point_count)
+ * @param window Window length in timestamp units, e.g. 60000 for one minute in ms
+ * @param storage Storage of at least modbus_agg_size() bytes, 8-byte aligned
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if window is 0,
+ *         MODBUS_CONV_ERR_BUFFER if storage is too small
+ */
+int modbus_agg_init(modbus_agg_t *agg,
+                    size_t point_count,
+                    uint64_t window,
+                    void *storage,
+                    size_t storage_size);
+
+/**
+ * @brief Start a sample time, closing the current window if ts is past it
+ * @details Called once per plan execution before modbus_agg_add(). Sets
+ *          agg->record_count to the number of records emitted (0 if the
+ *          window is still open). Timestamps must not decrease.
+ * @param agg Aggregator
+ * @param timestamp Sample timestamp
+ */
+void modbus_agg_begin(modbus_agg_t *agg, uint64_t timestamp);
+
+/**
+ * @brief Add one converted value
+ * @param agg Aggregator
+ * @param point Point index
+ * @param value Value (non-finite values are ignored)
+ * @param timestamp Sample timestamp passed to modbus_agg_begin()
+ */
+void modbus_agg_add(modbus_agg_t *agg, size_t point, double value, uint64_t timestamp);
+
+/**
+ * @brief Aggregate already converted plan results
+ * @details For results not produced by modbus_plan_execute_agg().
+ * @param agg Aggregator
+ * @param plan Plan the values were produced with
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Sample timestamp
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if the plan has
+ *         more points than the aggregator
+ */
+int modbus_agg_update(modbus_agg_t *agg,
+                      const modbus_plan_t *plan,
+                      const modbus_value_t *values,
+                      const int *status,
+                      uint64_t timestamp);
+
+/**
+ * @brief Close the current window early, e.g. at shutdown
+ * @details Emits records with the time-weighted average taken up to timestamp
+ *          (at most the window end). Carried values are dropped, so the
+ *          next window starts from its first sample rather than integrating
+ *          the gap.
+ * @param agg Aggregator
+ * @param timestamp End of the aggregated span
+ * @return Number of records emitted into agg->records
+ */
+size_t modbus_agg_flush(modbus_agg_t *agg, uint64_t timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_AGG_H */
@@ -0,0 +1,252 @@
+/**
+ * @file modbus_alarm.c
+ * @brief Limit alarm implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_alarm.h"
+#include <math.h>
+#include <string.h>
+
+/* Bitsets per level (enabled, active, pending) plus delayed and valid */
+#define ALARM_BITSETS           (3 * MODBUS_ALARM_LEVELS + 2)
+
+/* Helper function prototypes */
+static size_t bitset_words(size_t count);
+static void compare_word(const modbus_alarm_set_t *set, unsigned level, size_t base, size_t n,
+                         uint64_t *enter, uint64_t *stay);
+static unsigned lsb_index(uint64_t value);
+
+size_t modbus_alarm_size(size_t count)
+{
+    /* Point indices rounded up to whole words, then per-alarm doubles and timestamps */
+    return ((count + 1) / 2 + (2 * MODBUS_ALARM_LEVELS + 3) * count +
+            ALARM_BITSETS * bitset_words(count)) * sizeof(uint64_t);
+}
+
+int modbus_alarm_init(modbus_alarm_set_t *set,
+                      const modbus_plan_t *plan,
+                      const modbus_alarm_def_t *defs,
+                      size_t count,
+                      void *storage,
+                      size_t storage_size)
+{
+    uint64_t *p = (uint64_t *)storage;
+    unsigned level;
+    size_t words;
+    size_t i;
+
+    if (!set || !plan || (!defs && count) || (!storage && count)) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    for (i = 0; i < count; i++) {
+        if (defs[i].point >= plan->point_count) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+    }
+    if (storage_size < modbus_alarm_size(count)) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    memset(set, 0, sizeof(*set));
+    memset(storage, 0, modbus_alarm_size(count));
+    words = bitset_words(count);
+    set->plan = plan;
+    set->count = count;
+    set->words = words;
+
+    set->points = (uint32_t *)(void *)p;
+    p += (count + 1) / 2;
+    for (level = 0; level < MODBUS_ALARM_LEVELS; level++) {
+        set->limits[level] = (double *)(void *)p;
+        p += count;
+        set->since[level] = p;
+        p += count;
+    }
+    set->deadband = (double *)(void *)p;
+    p += count;
+    set->delay = p;
+    p += count;
+    set->input = (double *)(void *)p;
+    p += count;
+    for (level = 0; level < MODBUS_ALARM_LEVELS; level++) {
+        set->enabled[level] = p;
+        p += words;
+        set->active[level] = p;
+        p += words;
+        set->pending[level] = p;
+        p += words;
+    }
+    set->delayed = p;
+    p += words;
+    set->valid = p;
+
+    for (i = 0; i < count; i++) {
+        uint64_t bit = (uint64_t)1 << (i % 64);
+
+        set->points[i] = defs[i].point;
+        set->deadband[i] = defs[i].deadband;
+        set->delay[i] = defs[i].delay;
+        for (level = 0; level < MODBUS_ALARM_LEVELS; level++) {
+            set->limits[level][i] = defs[i].limits[level];
+            if (defs[i].levels & MODBUS_ALARM_EN(level)) {
+                set->enabled[level][i / 64] |= bit;
+            }
+        }
+        if (defs[i].delay) {
+            set->delayed[i / 64] |= bit;
+        }
+    }
+    return MODBUS_CONV_OK;
+}
+
+int modbus_alarm_eval(modbus_alarm_set_t *set,
+                      const modbus_value_t *values,
+                      const int *status,
+                      uint64_t timestamp,
+                      modbus_alarm_event_t *events,
+                      size_t max_events,
+                      size_t *event_count)
+{
+    const modbus_point_t *points;
+    size_t written = 0;
+    bool dropped = false;
+    size_t w, i;
+
+    if (!set || !values || (!events && max_events) || !event_count) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    points = set->plan->points;
+
+    /* Gather values into a dense array and a validity bitset */
+    memset(set->valid, 0, set->words * sizeof(uint64_t));
+    for (i = 0; i < set->count; i++) {
+        uint32_t p = set->points[i];
+
+        if (status && status[p] != MODBUS_CONV_OK) {
+            set->input[i] = NAN;
+        } else {
+            set->input[i] = modbus_value_to_double(points[p].data_type, &values[p]);
+            set->valid[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+    }
+
+    for (w = 0; w < set->words; w++) {
+        size_t base = w * 64;
+        size_t n = set->count - base < 64 ? set->count - base : 64;
+        uint64_t valid = set->valid[w];
+        uint64_t delayed = set->delayed[w];
+        unsigned level;
+
+        for (level = 0; level < MODBUS_ALARM_LEVELS; level++) {
+            uint64_t active = set->active[level][w];
+            uint64_t pending = set->pending[level][w];
+            uint64_t enter, stay, raw, start, matured, next, changes, m;
+
+            if (!set->enabled[level][w]) {
+                continue;
+            }
+            compare_word(set, level, base, n, &enter, &stay);
+
+            /* Hysteresis: active levels stay while inside the deadband */
+            raw = ((active & stay) | (~active & enter)) & set->enabled[level][w];
+
+            /* Delay-on: conditions wait in pending until their delay has passed */
+            start = raw & ~active & ~pending & delayed;
+            for (m = start; m; m &= m - 1) {
+                set->since[level][base + lsb_index(m)] = timestamp;
+            }
+            pending = (pending & raw & ~active) | start;
+            matured = 0;
+            for (m = pending; m; m &= m - 1) {
+                size_t a = base + lsb_index(m);
+                if (timestamp - set->since[level][a] >= set->delay[a]) {
+                    matured |= m & -m;
+                }
+            }
+            next = (active & raw) | (raw & ~active & ~delayed) | matured;
+            pending &= ~matured;
+
+            /* Alarms without a valid value keep their state */
+            next = (next & valid) | (active & ~valid);
+            pending = (pending & valid) | (set->pending[level][w] & ~valid);
+
+            set->active[level][w] = next;
+            set->pending[level][w] = pending;
+
+            for (changes = next ^ active; changes; changes &= changes - 1) {
+                size_t a = base + lsb_index(changes);
+
+                if (written == max_events) {
+                    dropped = true;
+                    continue;
+                }
+                events[written].timestamp = timestamp;
+                events[written].value = set->input[a];
+                events[written].alarm = (uint32_t)a;
+                events[written].level = (uint8_t)level;
+                events[written].active = (uint8_t)((next >> (a - base)) & 1);
+                written++;
+            }
+        }
+    }
+
+    *event_count = written;
+    return dropped ? MODBUS_CONV_ERR_BUFFER : MODBUS_CONV_OK;
+}
+
+bool modbus_alarm_active(const modbus_alarm_set_t *set, size_t alarm, unsigned level)
+{
+    if (!set || alarm >= set->count || level >= MODBUS_ALARM_LEVELS) {
+        return false;
+    }
+    return (set->active[level][alarm / 64] >> (alarm % 64)) & 1;
+}
+
+/* Helper function implementations */
+static size_t bitset_words(size_t count)
+{
+    return (count + 63) / 64;
+}
+
+/*
+ * Limit compares for up to 64 alarms, one bit each. Branch-free over dense
+ * arrays so the compiler can vectorize; NaN compares false and clears.
+ */
+static void compare_word(const modbus_alarm_set_t *set, unsigned level, size_t base, size_t n,
+                         uint64_t *enter, uint64_t *stay)
+{
+    const double *x = set->input + base;
+    const double *limit = set->limits[level] + base;
+    const double *deadband = set->deadband + base;
+    uint64_t e = 0, s = 0;
+    size_t j;
+
+    if (level == MODBUS_ALARM_HIHI || level == MODBUS_ALARM_HI) {
+        for (j = 0; j < n; j++) {
+            e |= (uint64_t)(x[j] > limit[j]) << j;
+            s |= (uint64_t)(x[j] > limit[j] - deadband[j]) << j;
+        }
+    } else {
+        for (j = 0; j < n; j++) {
+            e |= (uint64_t)(x[j] < limit[j]) << j;
+            s |= (uint64_t)(x[j] < limit[j] + deadband[j]) << j;
+        }
+    }
+    *enter = e;
+    *stay = s;
+}
+
+static unsigned lsb_index(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(value);
+#else
+    unsigned n = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
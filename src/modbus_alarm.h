@@ -0,0 +1,132 @@
+/**
+ * @file modbus_alarm.h
+ * @brief Limit alarms with hysteresis and delay-on
+ * @details Every alarm watches one point against up to four limits (HIHI, HI,
+ *          LO, LOLO). A level becomes active when the value crosses its limit
+ *          and stays active until the value is back inside by more than the
+ *          deadband; with a delay, the condition must hold that long before
+ *          the level activates. Active and pending levels are kept in
+ *          bitsets, 64 alarms per word, and the limit compares run over
+ *          dense arrays a word at a time. Evaluation reports only the levels
+ *          that changed state.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_ALARM_H
+#define MODBUS_ALARM_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Alarm levels */
+#define MODBUS_ALARM_HIHI               0
+#define MODBUS_ALARM_HI                 1
+#define MODBUS_ALARM_LO                 2
+#define MODBUS_ALARM_LOLO               3
+#define MODBUS_ALARM_LEVELS             4
+
+/* Level enable bits for modbus_alarm_def_t.levels */
+#define MODBUS_ALARM_EN(level)          (1u << (level))
+
+/* Alarm definition */
+typedef struct {
+    uint32_t point;                 /* Point index in the plan */
+    uint8_t levels;                 /* MODBUS_ALARM_EN() bits of the enabled levels */
+    double limits[MODBUS_ALARM_LEVELS]; /* Limits, indexed by level */
+    double deadband;                /* Hysteresis for leaving a level */
+    uint64_t delay;                 /* Delay-on in timestamp units, 0 = immediate */
+} modbus_alarm_def_t;
+
+/* State change of one alarm level */
+typedef struct {
+    uint64_t timestamp;             /* Evaluation timestamp */
+    double value;                   /* Value that caused the change */
+    uint32_t alarm;                 /* Alarm index */
+    uint8_t level;                  /* MODBUS_ALARM_* level */
+    uint8_t active;                 /* 1 = raised, 0 = cleared */
+} modbus_alarm_event_t;
+
+/* Alarm set for one plan; arrays in caller storage */
+typedef struct {
+    const modbus_plan_t *plan;      /* Plan providing the values */
+    size_t count;                   /* Number of alarms */
+    size_t words;                   /* Bitset words per level */
+
+    uint32_t *points;               /* Point of every alarm */
+    double *limits[MODBUS_ALARM_LEVELS];
+    double *deadband;
+    uint64_t *delay;
+    double *input;                  /* Values of the current evaluation */
+    uint64_t *since[MODBUS_ALARM_LEVELS];   /* Start of a pending condition */
+
+    uint64_t *enabled[MODBUS_ALARM_LEVELS]; /* Bitsets of enabled levels */
+    uint64_t *active[MODBUS_ALARM_LEVELS];  /* Bitsets of active levels */
+    uint64_t *pending[MODBUS_ALARM_LEVELS]; /* Bitsets of conditions waiting for their delay */
+    uint64_t *delayed;              /* Bitset of alarms with a delay */
+    uint64_t *valid;                /* Bitset of alarms with a valid value */
+} modbus_alarm_set_t;
+
+/**
+ * @brief Storage needed for an alarm set
+ * @param count Number of alarms
+ * @return Size in bytes for modbus_alarm_init()
+ */
+size_t modbus_alarm_size(size_t count);
+
+/**
+ * @brief Initialize an alarm set with every level inactive
+ * @param set Alarm set
+ * @param plan Compiled plan (must outlive the set)
+ * @param defs Alarm definitions (copied)
+ * @param count Number of alarms
+ * @param storage Storage of at least modbus_alarm_size() bytes, 8-byte aligned
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if a point is
+ *         out of range, MODBUS_CONV_ERR_BUFFER if storage is too small
+ */
+int modbus_alarm_init(modbus_alarm_set_t *set,
+                      const modbus_plan_t *plan,
+                      const modbus_alarm_def_t *defs,
+                      size_t count,
+                      void *storage,
+                      size_t storage_size);
+
+/**
+ * @brief Evaluate all alarms against one plan execution
+ * @details Alarms whose point failed to convert keep their state. The state
+ *          is always fully updated; events beyond max_events are dropped.
+ * @param set Alarm set
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Evaluation timestamp
+ * @param events Array receiving state changes
+ * @param max_events Capacity of events
+ * @param event_count Pointer to store the number of events written
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if events were dropped
+ */
+int modbus_alarm_eval(modbus_alarm_set_t *set,
+                      const modbus_value_t *values,
+                      const int *status,
+                      uint64_t timestamp,
+                      modbus_alarm_event_t *events,
+                      size_t max_events,
+                      size_t *event_count);
+
+/**
+ * @brief Whether an alarm level is active
+ * @param set Alarm set
+ * @param alarm Alarm index
+ * @param level MODBUS_ALARM_* level
+ * @return true if active
+ */
+bool modbus_alarm_active(const modbus_alarm_set_t *set, size_t alarm, unsigned level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_ALARM_H */
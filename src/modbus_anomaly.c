@@ -0,0 +1,205 @@
+/**
+ * @file modbus_anomaly.c
+ * @brief Streaming anomaly detection implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_anomaly.h"
+#include <math.h>
+#include <string.h>
+
+/* Per-point bytes: nine doubles, three 64-bit timestamps, two counters and two flag bytes */
+#define ANOMALY_BYTES           (9 * sizeof(double) + 3 * sizeof(uint64_t) + 2 * sizeof(uint32_t) + 2)
+
+/* Helper function prototypes */
+static size_t check_points(size_t n,
+                           uint64_t timestamp,
+                           const double *restrict input,
+                           const uint8_t *restrict valid,
+                           const double *restrict elapsed,
+                           const double *restrict alpha,
+                           const double *restrict z_limit,
+                           const double *restrict max_rate,
+                           const uint64_t *restrict stuck_time,
+                           const uint32_t *restrict warmup,
+                           double *restrict mean,
+                           double *restrict var,
+                           double *restrict last,
+                           uint64_t *restrict last_timestamp,
+                           uint64_t *restrict since,
+                           uint32_t *restrict samples,
+                           double *restrict score,
+                           uint8_t *restrict flags);
+
+size_t modbus_anomaly_size(size_t count)
+{
+    return count * ANOMALY_BYTES;
+}
+
+int modbus_anomaly_init(modbus_anomaly_set_t *set,
+                        const modbus_plan_t *plan,
+                        const modbus_anomaly_def_t *defs,
+                        double ticks_per_second,
+                        void *storage,
+                        size_t storage_size)
+{
+    size_t count;
+    size_t i;
+
+    if (!set || !plan || !defs || !storage) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    count = plan->point_count;
+    if (!(ticks_per_second > 0)) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    for (i = 0; i < count; i++) {
+        if (!(defs[i].alpha > 0.0 && defs[i].alpha <= 1.0)) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+    }
+    if (storage_size < modbus_anomaly_size(count)) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    memset(set, 0, sizeof(*set));
+    set->plan = plan;
+    set->count = count;
+    set->ticks_per_second = ticks_per_second;
+
+    set->alpha = (double *)storage;
+    set->z_limit = set->alpha + count;
+    set->max_rate = set->z_limit + count;
+    set->mean = set->max_rate + count;
+    set->var = set->mean + count;
+    set->last = set->var + count;
+    set->input = set->last + count;
+    set->elapsed = set->input + count;
+    set->score = set->elapsed + count;
+    set->stuck_time = (uint64_t *)(void *)(set->score + count);
+    set->last_timestamp = set->stuck_time + count;
+    set->since = set->last_timestamp + count;
+    set->warmup = (uint32_t *)(void *)(set->since + count);
+    set->samples = set->warmup + count;
+    set->valid = (uint8_t *)(set->samples + count);
+    set->flags = set->valid + count;
+    memset(storage, 0, modbus_anomaly_size(count));
+
+    for (i = 0; i < count; i++) {
+        set->alpha[i] = defs[i].alpha;
+        set->z_limit[i] = defs[i].z_limit;
+        set->max_rate[i] = defs[i].max_rate;
+        set->stuck_time[i] = defs[i].stuck_time;
+        set->warmup[i] = defs[i].warmup;
+    }
+    return MODBUS_CONV_OK;
+}
+
+size_t modbus_anomaly_update(modbus_anomaly_set_t *set,
+                             const modbus_value_t *values,
+                             const int *status,
+                             uint64_t timestamp)
+{
+    const modbus_point_t *points;
+    double inv_tps;
+    size_t i;
+
+    if (!set || !values) {
+        return 0;
+    }
+    points = set->plan->points;
+    inv_tps = 1.0 / set->ticks_per_second;
+
+    /* Gather readings into a dense array; non-finite readings count as failed
+     * and repeat the previous reading. The elapsed time is converted here, 64-bit
+     * integers have no vector conversion to double before AVX-512 */
+    for (i = 0; i < set->count; i++) {
+        double x = modbus_value_to_double(points[i].data_type, &values[i]);
+        bool ok = (!status || status[i] == MODBUS_CONV_OK) && isfinite(x);
+
+        set->input[i] = ok ? x : set->last[i];
+        set->valid[i] = ok;
+        set->elapsed[i] = (double)(timestamp - set->last_timestamp[i]) * inv_tps;
+    }
+
+    return check_points(set->count, timestamp, set->input, set->valid, set->elapsed,
+                        set->alpha, set->z_limit, set->max_rate, set->stuck_time, set->warmup,
+                        set->mean, set->var, set->last, set->last_timestamp, set->since,
+                        set->samples, set->score, set->flags);
+}
+
+/* Helper function implementations */
+
+/*
+ * Checks and EWMA update over all points. The arrays are disjoint parts of the
+ * storage and every case is arithmetic on 0/1 flags instead of a branch, so gcc
+ * vectorizes the loop. A failed reading repeats the previous one with weight
+ * zero, which leaves the mean and variance as they are. The z-score test
+ * compares squares; with zero variance a deviation divides by zero (infinity)
+ * and no deviation divides by one.
+ */
+static size_t check_points(size_t n,
+                           uint64_t timestamp,
+                           const double *restrict input,
+                           const uint8_t *restrict valid,
+                           const double *restrict elapsed,
+                           const double *restrict alpha,
+                           const double *restrict z_limit,
+                           const double *restrict max_rate,
+                           const uint64_t *restrict stuck_time,
+                           const uint32_t *restrict warmup,
+                           double *restrict mean,
+                           double *restrict var,
+                           double *restrict last,
+                           uint64_t *restrict last_timestamp,
+                           uint64_t *restrict since,
+                           uint32_t *restrict samples,
+                           double *restrict score,
+                           uint8_t *restrict flags)
+{
+    size_t flagged = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        double x = input[i];
+        double m = mean[i];
+        double v = var[i];
+        double z = z_limit[i];
+        double prev = last[i];
+        uint32_t count = samples[i];
+        uint64_t changed_at = since[i];
+        int ok = valid[i] != 0;
+        int seen = count > 0;
+        double w = (alpha[i] * seen + !seen) * ok;
+        double d = x - m;
+        double d2 = d * d * (seen & ok);
+        double incr = w * d;
+        double z2 = d2 / (v + !((v > 0.0) | (d2 > 0.0)));
+        int changed = !seen | (x != prev);
+        uint64_t at = changed_at + (timestamp - changed_at) * (uint64_t)changed;
+        int f;
+
+        f = ((z > 0.0) & (count >= warmup[i]) & seen & (z2 > z * z)) * MODBUS_ANOMALY_ZSCORE;
+        f |= ((max_rate[i] > 0.0) & seen & (fabs(x - prev) > max_rate[i] * elapsed[i])) *
+             MODBUS_ANOMALY_RATE;
+        f |= ((stuck_time[i] > 0) & (timestamp - at >= stuck_time[i])) * MODBUS_ANOMALY_STUCK;
+        f = f * ok | !ok * MODBUS_ANOMALY_INVALID;
+
+        /* West's incremental EWMA; the first reading has weight one and starts the mean */
+        mean[i] = m + incr;
+        var[i] = (1.0 - w) * (v + d * incr);
+        last[i] = x;
+        last_timestamp[i] += (timestamp - last_timestamp[i]) * (uint64_t)ok;
+        since[i] = changed_at + (at - changed_at) * (uint64_t)ok;
+        samples[i] = count + (uint32_t)(ok & (count < UINT32_MAX));
+        score[i] = z2;
+        flags[i] = (uint8_t)f;
+        flagged += (size_t)(ok & (f != 0));
+    }
+
+    /* Squared scores to standard deviations; scalar, sqrt() may set errno */
+    for (i = 0; i < n; i++) {
+        score[i] = sqrt(score[i]);
+    }
+    return flagged;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file modbus_anomaly.h
+ * @brief Streaming anomaly flags for converted points
+ * @details An anomaly set follows every point of a plan with an exponentially
+ *          weighted mean and variance and raises flags for:
+ *
+ *          - z-score: the reading is more than z_limit standard deviations
+ *            from the EWMA mean (after warmup readings);
+ *          - rate of change: the change since the last reading exceeds
+ *            max_rate units per second;
+ *          - stuck value: the reading has not changed for stuck_time.
+ *
+ *          State is kept in per-point arrays and the checks run as one
+ *          branch-free, vectorizable loop over all points after the plan
+ *          execution.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_ANOMALY_H
+#define MODBUS_ANOMALY_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Result flags */
+#define MODBUS_ANOMALY_ZSCORE           0x01    /* Outside z_limit standard deviations */
+#define MODBUS_ANOMALY_RATE             0x02    /* Changed faster than max_rate */
+#define MODBUS_ANOMALY_STUCK            0x04    /* Unchanged for stuck_time */
+#define MODBUS_ANOMALY_INVALID          0x08    /* Reading failed, state kept */
+
+/* Per-point check parameters; zero disables a check */
+typedef struct {
+    double alpha;                   /* EWMA weight of a new reading, (0, 1] */
+    double z_limit;                 /* Standard deviations, 0 = no z-score check */
+    uint32_t warmup;                /* Readings before the z-score check starts */
+    double max_rate;                /* Units per second, 0 = no rate check */
+    uint64_t stuck_time;            /* Timestamp units, 0 = no stuck check */
+} modbus_anomaly_def_t;
+
+/* Anomaly state for one plan; arrays in caller storage, one entry per point */
+typedef struct {
+    const modbus_plan_t *plan;      /* Plan the set belongs to */
+    size_t count;                   /* Number of points */
+    double ticks_per_second;        /* Timestamp units per second */
+
+    double *alpha;
+    double *z_limit;
+    double *max_rate;
+    uint64_t *stuck_time;
+    uint32_t *warmup;
+
+    double *mean;                   /* EWMA mean */
+    double *var;                    /* EWMA variance */
+    double *last;                   /* Previous valid reading */
+    uint64_t *last_timestamp;       /* Time of the previous valid reading */
+    uint64_t *since;                /* Time the reading last changed */
+    uint32_t *samples;              /* Valid readings so far (saturating) */
+    double *input;                  /* Readings being processed */
+    uint8_t *valid;                 /* Reading converted */
+    double *elapsed;                /* Seconds since the previous valid reading */
+
+    /* Results of the last update */
+    double *score;                  /* |reading - mean| in standard deviations */
+    uint8_t *flags;                 /* MODBUS_ANOMALY_* flags */
+} modbus_anomaly_set_t;
+
+/**
+ * @brief Storage needed for an anomaly set
+ * @param count Number of points
+ * @return Size in bytes for modbus_anomaly_init()
+ */
+size_t modbus_anomaly_size(size_t count);
+
+/**
+ * @brief Initialize an anomaly set for every point of a plan
+ * @param set Anomaly set
+ * @param plan Compiled plan (must outlive the set)
+ * @param defs One definition per plan point (copied)
+ * @param ticks_per_second Timestamp units per second, e.g. 1000 for ms
+ * @param storage Storage of at least modbus_anomaly_size(plan->point_count) bytes, 8-byte aligned
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if an alpha
+ *         is outside (0, 1], MODBUS_CONV_ERR_BUFFER if storage is too small
+ */
+int modbus_anomaly_init(modbus_anomaly_set_t *set,
+                        const modbus_plan_t *plan,
+                        const modbus_anomaly_def_t *defs,
+                        double ticks_per_second,
+                        void *storage,
+                        size_t storage_size);
+
+/**
+ * @brief Check one plan execution and update the statistics
+ * @details Results are in set->flags and set->score. Each reading is checked
+ *          against the state before it is added.
+ * @param set Anomaly set
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Reading timestamp
+ * @return Number of points with an anomaly flag (MODBUS_ANOMALY_INVALID not counted)
+ */
+size_t modbus_anomaly_update(modbus_anomaly_set_t *set,
+                             const modbus_value_t *values,
+                             const int *status,
+                             uint64_t timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_ANOMALY_H */
@@ -0,0 +1,725 @@
+/**
+ * @file modbus_arrow.c
+ * @brief Apache Arrow columnar export implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_arrow.h"
+#include "modbus_format.h"
+#include <string.h>
+
+/* Arrow Type union members (Schema.fbs) */
+#define FB_TYPE_INT             2
+#define FB_TYPE_FLOATING_POINT  3
+#define FB_TYPE_BOOL            6
+#define FB_TYPE_TIMESTAMP       10
+
+/* MessageHeader union members and metadata version (Message.fbs) */
+#define FB_HEADER_SCHEMA        1
+#define FB_HEADER_RECORD_BATCH  3
+#define FB_METADATA_V5          4
+
+/* Column types */
+enum {
+    KIND_BOOL, KIND_I8, KIND_U8, KIND_I16, KIND_U16, KIND_I32,
+    KIND_U32, KIND_I64, KIND_U64, KIND_F32, KIND_F64
+};
+
+typedef struct {
+    const char *format;             /* C data interface format string */
+    uint8_t width;                  /* Bytes per value, 0 for bit-packed */
+    uint8_t fb_type;                /* IPC Type union member */
+    uint8_t bits;                   /* Int bit width or FloatingPoint precision */
+    uint8_t is_signed;
+} arrow_kind_t;
+
+static const arrow_kind_t kinds[] = {
+    { "b", 0, FB_TYPE_BOOL,           0,  0 },
+    { "c", 1, FB_TYPE_INT,            8,  1 },
+    { "C", 1, FB_TYPE_INT,            8,  0 },
+    { "s", 2, FB_TYPE_INT,            16, 1 },
+    { "S", 2, FB_TYPE_INT,            16, 0 },
+    { "i", 4, FB_TYPE_INT,            32, 1 },
+    { "I", 4, FB_TYPE_INT,            32, 0 },
+    { "l", 8, FB_TYPE_INT,            64, 1 },
+    { "L", 8, FB_TYPE_INT,            64, 0 },
+    { "f", 4, FB_TYPE_FLOATING_POINT, 1,  1 },
+    { "g", 8, FB_TYPE_FLOATING_POINT, 2,  1 }
+};
+
+static const char *const time_formats[] = { "tss:UTC", "tsm:UTC", "tsu:UTC", "tsn:UTC" };
+
+/* Flatbuffer cursor; offsets are relative to buf */
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} fb_t;
+
+/* Helper function prototypes */
+static uint8_t kind_of(modbus_data_type_t data_type);
+static size_t carve(size_t *offset, size_t n);
+static size_t layout(modbus_arrow_batch_t *batch, const modbus_plan_t *plan, size_t capacity, uint8_t *base);
+static size_t bitmap_bytes(size_t rows);
+static size_t pad8(size_t n);
+static void release_schema(struct ArrowSchema *schema);
+static void release_array(struct ArrowArray *array);
+static void release_child_schema(struct ArrowSchema *schema);
+static void release_child_array(struct ArrowArray *array);
+static size_t fb_reserve(fb_t *fb, size_t n, size_t align);
+static void fb_put(fb_t *fb, size_t at, uint64_t value, size_t n);
+static void fb_ref(fb_t *fb, size_t at, size_t target);
+static size_t fb_table(fb_t *fb, const uint8_t *sizes, size_t count, size_t *at);
+static size_t fb_vector(fb_t *fb, size_t count, size_t elem_size, size_t align);
+static size_t fb_string(fb_t *fb, const char *s);
+static size_t fb_message(fb_t *fb, uint8_t header_type, uint64_t body_len, size_t *header_at);
+static void fb_field(fb_t *fb, size_t at, const char *name, bool nullable, const modbus_arrow_batch_t *batch, int kind);
+static int finish_message(fb_t *fb, char *buf, size_t *len);
+
+size_t modbus_arrow_batch_size(const modbus_plan_t *plan, size_t capacity)
+{
+    if (!plan) {
+        return 0;
+    }
+    /* Slack to align the start of caller storage */
+    return layout(NULL, plan, capacity, NULL) + MODBUS_ARROW_ALIGN - 1;
+}
+
+int modbus_arrow_batch_init(modbus_arrow_batch_t *batch,
+                            const modbus_plan_t *plan,
+                            const char *const *names,
+                            modbus_arrow_time_unit_t time_unit,
+                            size_t capacity,
+                            void *storage,
+                            size_t storage_size)
+{
+    uint8_t *base;
+    size_t skew;
+    size_t i;
+
+    if (!batch || !plan || !storage) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if ((unsigned)time_unit > MODBUS_ARROW_NANOSECOND) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    skew = (size_t)(-(uintptr_t)storage & (MODBUS_ARROW_ALIGN - 1));
+    if (storage_size < skew || storage_size - skew < layout(NULL, plan, capacity, NULL)) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    base = (uint8_t *)storage + skew;
+
+    memset(batch, 0, sizeof(*batch));
+    batch->plan = plan;
+    batch->time_unit = time_unit;
+    batch->capacity = capacity;
+    layout(batch, plan, capacity, base);
+
+    for (i = 0; i < plan->point_count; i++) {
+        modbus_arrow_column_t *col = &batch->columns[i];
+        col->kind = kind_of(plan->points[i].data_type);
+        col->null_count = 0;
+        if (names) {
+            col->name = names[i];
+        } else {
+            col->label[0] = 'p';
+            col->label[1 + modbus_format_u64(i, col->label + 1)] = '\0';
+            col->name = col->label;
+        }
+        memset(col->validity, 0, bitmap_bytes(capacity));
+        if (kinds[col->kind].width == 0) {
+            memset(col->data, 0, bitmap_bytes(capacity));
+        }
+    }
+    return MODBUS_CONV_OK;
+}
+
+void modbus_arrow_batch_reset(modbus_arrow_batch_t *batch)
+{
+    size_t used;
+    size_t i;
+
+    if (!batch) {
+        return;
+    }
+
+    /* Only the bitmap bytes touched by appended rows need clearing */
+    used = bitmap_bytes(batch->rows);
+    for (i = 0; i < batch->plan->point_count; i++) {
+        modbus_arrow_column_t *col = &batch->columns[i];
+        memset(col->validity, 0, used);
+        if (kinds[col->kind].width == 0) {
+            memset(col->data, 0, used);
+        }
+        col->null_count = 0;
+    }
+    batch->rows = 0;
+}
+
+int modbus_arrow_batch_append(modbus_arrow_batch_t *batch,
+                              const modbus_value_t *values,
+                              const int *status,
+                              int64_t timestamp)
+{
+    size_t row, byte;
+    uint8_t bit;
+    size_t i;
+
+    if (!batch || !values) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (batch->rows >= batch->capacity) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    row = batch->rows;
+    byte = row >> 3;
+    bit = (uint8_t)(1u << (row & 7));
+    batch->time[row] = timestamp;
+
+    for (i = 0; i < batch->plan->point_count; i++) {
+        modbus_arrow_column_t *col = &batch->columns[i];
+        uint8_t width = kinds[col->kind].width;
+
+        if (status && status[i] != MODBUS_CONV_OK) {
+            /* Null slot; keep the value bytes deterministic */
+            if (width) {
+                memset((uint8_t *)col->data + row * width, 0, width);
+            }
+            col->null_count++;
+            continue;
+        }
+
+        col->validity[byte] |= bit;
+        switch (width) {
+            case 0:
+                if (values[i].bool_val) {
+                    ((uint8_t *)col->data)[byte] |= bit;
+                }
+                break;
+            case 1:
+                ((uint8_t *)col->data)[row] = values[i].u8;
+                break;
+            case 2:
+                ((uint16_t *)col->data)[row] = values[i].u16;
+                break;
+            case 4:
+                ((uint32_t *)col->data)[row] = values[i].u32;
+                break;
+            default:
+                ((uint64_t *)col->data)[row] = values[i].u64;
+                break;
+        }
+    }
+
+    batch->rows++;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_arrow_export(modbus_arrow_batch_t *batch,
+                        struct ArrowArray *array,
+                        struct ArrowSchema *schema)
+{
+    size_t columns;
+    size_t i;
+
+    if (!batch || !array || !schema) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    columns = batch->plan->point_count + 1;
+
+    /* Top level: struct of "time" and the point columns */
+    memset(schema, 0, sizeof(*schema));
+    schema->format = "+s";
+    schema->name = "";
+    schema->n_children = (int64_t)columns;
+    schema->children = batch->child_schema_ptrs;
+    schema->release = release_schema;
+    schema->private_data = batch;
+
+    memset(array, 0, sizeof(*array));
+    array->length = (int64_t)batch->rows;
+    array->n_buffers = 1;
+    array->buffers = batch->buffers;
+    array->n_children = (int64_t)columns;
+    array->children = batch->child_array_ptrs;
+    array->release = release_array;
+    array->private_data = batch;
+    batch->buffers[0] = NULL;
+
+    for (i = 0; i < columns; i++) {
+        struct ArrowSchema *cs = &batch->child_schemas[i];
+        struct ArrowArray *ca = &batch->child_arrays[i];
+        const void **bufs = &batch->buffers[1 + 2 * i];
+
+        memset(cs, 0, sizeof(*cs));
+        memset(ca, 0, sizeof(*ca));
+        if (i == 0) {
+            cs->format = time_formats[batch->time_unit];
+            cs->name = "time";
+            bufs[0] = NULL;
+            bufs[1] = batch->time;
+        } else {
+            const modbus_arrow_column_t *col = &batch->columns[i - 1];
+            cs->format = kinds[col->kind].format;
+            cs->name = col->name;
+            cs->flags = ARROW_FLAG_NULLABLE;
+            ca->null_count = col->null_count;
+            bufs[0] = col->null_count ? col->validity : NULL;
+            bufs[1] = col->data;
+        }
+        cs->release = release_child_schema;
+        ca->length = (int64_t)batch->rows;
+        ca->n_buffers = 2;
+        ca->buffers = bufs;
+        ca->release = release_child_array;
+
+        batch->child_schema_ptrs[i] = cs;
+        batch->child_array_ptrs[i] = ca;
+    }
+    return MODBUS_CONV_OK;
+}
+
+int modbus_arrow_ipc_schema(const modbus_arrow_batch_t *batch, char *buf, size_t size, size_t *len)
+{
+    static const uint8_t schema_sizes[] = { 2, 4 };    /* endianness, fields */
+    static const uint16_t probe = 1;
+    size_t header_at, fields_at, at[2];
+    size_t schema;
+    size_t i;
+    fb_t fb;
+
+    if (!batch || !buf || !len) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    fb.buf = (uint8_t *)buf + 8;
+    fb.size = size > 8 ? size - 8 : 0;
+    fb.len = 0;
+    fb.overflow = size < 8;
+
+    fb_message(&fb, FB_HEADER_SCHEMA, 0, &header_at);
+    schema = fb_table(&fb, schema_sizes, 2, at);
+    fb_ref(&fb, header_at, schema);
+    /* Body buffers are written in host byte order */
+    fb_put(&fb, at[0], *(const uint8_t *)&probe ? 0 : 1, 2);
+
+    fields_at = fb_vector(&fb, batch->plan->point_count + 1, 4, 4);
+    fb_ref(&fb, at[1], fields_at);
+    fb_field(&fb, fields_at + 4, "time", false, batch, -1);
+    for (i = 0; i < batch->plan->point_count; i++) {
+        fb_field(&fb, fields_at + 8 + 4 * i, batch->columns[i].name, true, batch,
+                 batch->columns[i].kind);
+    }
+
+    return finish_message(&fb, buf, len);
+}
+
+int modbus_arrow_ipc_batch(const modbus_arrow_batch_t *batch,
+                           char *buf,
+                           size_t size,
+                           size_t *len,
+                           modbus_arrow_segment_t *segments,
+                           size_t max_segments,
+                           size_t *segment_count)
+{
+    static const uint8_t batch_sizes[] = { 8, 4, 4 };  /* length, nodes, buffers */
+    size_t columns, header_at, at[3];
+    size_t nodes, buffers, record;
+    size_t offset = 0, count = 0;
+    size_t i;
+    fb_t fb;
+
+    if (!batch || !buf || !len || !segments || !segment_count) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    columns = batch->plan->point_count + 1;
+    if (max_segments < 2 * columns) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    /* Body: validity (only with nulls) and data buffer of every column */
+    for (i = 0; i < columns; i++) {
+        const modbus_arrow_column_t *col = i ? &batch->columns[i - 1] : NULL;
+        size_t data_len;
+
+        if (col && col->null_count) {
+            segments[count].data = col->validity;
+            segments[count].len = pad8(bitmap_bytes(batch->rows));
+            count++;
+        }
+        if (!col) {
+            data_len = batch->rows * sizeof(int64_t);
+        } else if (kinds[col->kind].width == 0) {
+            data_len = bitmap_bytes(batch->rows);
+        } else {
+            data_len = batch->rows * kinds[col->kind].width;
+        }
+        if (data_len) {
+            segments[count].data = col ? col->data : (const void *)batch->time;
+            segments[count].len = pad8(data_len);
+            count++;
+        }
+    }
+    for (i = 0; i < count; i++) {
+        offset += segments[i].len;
+    }
+
+    fb.buf = (uint8_t *)buf + 8;
+    fb.size = size > 8 ? size - 8 : 0;
+    fb.len = 0;
+    fb.overflow = size < 8;
+
+    fb_message(&fb, FB_HEADER_RECORD_BATCH, offset, &header_at);
+    record = fb_table(&fb, batch_sizes, 3, at);
+    fb_ref(&fb, header_at, record);
+    fb_put(&fb, at[0], batch->rows, 8);
+
+    /* FieldNode { length, null_count } per column */
+    nodes = fb_vector(&fb, columns, 16, 8);
+    fb_ref(&fb, at[1], nodes);
+    for (i = 0; i < columns; i++) {
+        fb_put(&fb, nodes + 4 + 16 * i, batch->rows, 8);
+        fb_put(&fb, nodes + 12 + 16 * i, i ? (uint64_t)batch->columns[i - 1].null_count : 0, 8);
+    }
+
+    /* Buffer { offset, length } per column buffer, in segment order */
+    buffers = fb_vector(&fb, 2 * columns, 16, 8);
+    fb_ref(&fb, at[2], buffers);
+    offset = 0;
+    count = 0;
+    for (i = 0; i < 2 * columns; i++) {
+        const modbus_arrow_column_t *col = i >= 2 ? &batch->columns[i / 2 - 1] : NULL;
+        size_t length = 0;
+
+        if (i & 1) {
+            length = batch->rows ? segments[count++].len : 0;
+        } else if (col && col->null_count) {
+            length = segments[count++].len;
+        }
+        fb_put(&fb, buffers + 4 + 16 * i, offset, 8);
+        fb_put(&fb, buffers + 12 + 16 * i, length, 8);
+        offset += length;
+    }
+
+    *segment_count = count;
+    return finish_message(&fb, buf, len);
+}
+
+int modbus_arrow_ipc_eos(char *buf, size_t size, size_t *len)
+{
+    static const char eos[8] = { '\xff', '\xff', '\xff', '\xff', 0, 0, 0, 0 };
+
+    if (!buf || !len) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (size < sizeof(eos)) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    memcpy(buf, eos, sizeof(eos));
+    *len = sizeof(eos);
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+static uint8_t kind_of(modbus_data_type_t data_type)
+{
+    switch (data_type) {
+        case MODBUS_BIT_BOOLEAN:
+            return KIND_BOOL;
+        case MODBUS_INT8_SIGNED:
+            return KIND_I8;
+        case MODBUS_INT8_UNSIGNED:
+            return KIND_U8;
+        case MODBUS_INT16_SIGNED_AB:
+        case MODBUS_INT16_SIGNED_BA:
+            return KIND_I16;
+        case MODBUS_INT16_UNSIGNED_AB:
+        case MODBUS_INT16_UNSIGNED_BA:
+            return KIND_U16;
+        default:
+            break;
+    }
+
+    if (data_type <= MODBUS_INT32_SIGNED_CDAB) {
+        return KIND_I32;
+    }
+    if (data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        return KIND_U32;
+    }
+    if (data_type <= MODBUS_INT64_SIGNED_EFGHABCD) {
+        return KIND_I64;
+    }
+    if (data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        return KIND_U64;
+    }
+    if (data_type <= MODBUS_IEEE_FLOAT32_BADC) {
+        return KIND_F32;
+    }
+    return KIND_F64;
+}
+
+static size_t carve(size_t *offset, size_t n)
+{
+    size_t at = *offset;
+    *offset += (n + MODBUS_ARROW_ALIGN - 1) & ~(size_t)(MODBUS_ARROW_ALIGN - 1);
+    return at;
+}
+
+/* Computes the storage layout, assigning pointers when batch is given */
+static size_t layout(modbus_arrow_batch_t *batch, const modbus_plan_t *plan, size_t capacity, uint8_t *base)
+{
+    size_t columns = plan->point_count + 1;
+    size_t offset = 0;
+    size_t cols, time, schemas, schema_ptrs, arrays, array_ptrs, buffers;
+    size_t i;
+
+    cols = carve(&offset, plan->point_count * sizeof(modbus_arrow_column_t));
+    time = carve(&offset, capacity * sizeof(int64_t));
+    schemas = carve(&offset, columns * sizeof(struct ArrowSchema));
+    schema_ptrs = carve(&offset, columns * sizeof(struct ArrowSchema *));
+    arrays = carve(&offset, columns * sizeof(struct ArrowArray));
+    array_ptrs = carve(&offset, columns * sizeof(struct ArrowArray *));
+    buffers = carve(&offset, (1 + 2 * columns) * sizeof(const void *));
+
+    if (batch) {
+        batch->columns = (modbus_arrow_column_t *)(void *)(base + cols);
+        batch->time = (int64_t *)(void *)(base + time);
+        batch->child_schemas = (struct ArrowSchema *)(void *)(base + schemas);
+        batch->child_schema_ptrs = (struct ArrowSchema **)(void *)(base + schema_ptrs);
+        batch->child_arrays = (struct ArrowArray *)(void *)(base + arrays);
+        batch->child_array_ptrs = (struct ArrowArray **)(void *)(base + array_ptrs);
+        batch->buffers = (const void **)(void *)(base + buffers);
+    }
+
+    for (i = 0; i < plan->point_count; i++) {
+        uint8_t width = kinds[kind_of(plan->points[i].data_type)].width;
+        size_t validity = carve(&offset, bitmap_bytes(capacity));
+        size_t data = carve(&offset, width ? capacity * width : bitmap_bytes(capacity));
+
+        if (batch) {
+            batch->columns[i].validity = base + validity;
+            batch->columns[i].data = base + data;
+        }
+    }
+    return offset;
+}
+
+static size_t bitmap_bytes(size_t rows)
+{
+    return (rows + 7) / 8;
+}
+
+static size_t pad8(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+static void release_schema(struct ArrowSchema *schema)
+{
+    int64_t i;
+
+    for (i = 0; i < schema->n_children; i++) {
+        if (schema->children[i]->release) {
+            schema->children[i]->release(schema->children[i]);
+        }
+    }
+    schema->release = NULL;
+}
+
+static void release_array(struct ArrowArray *array)
+{
+    int64_t i;
+
+    for (i = 0; i < array->n_children; i++) {
+        if (array->children[i]->release) {
+            array->children[i]->release(array->children[i]);
+        }
+    }
+    array->release = NULL;
+}
+
+static void release_child_schema(struct ArrowSchema *schema)
+{
+    schema->release = NULL;
+}
+
+static void release_child_array(struct ArrowArray *array)
+{
+    array->release = NULL;
+}
+
+/* Reserves n zeroed bytes aligned to align (a power of two) */
+static size_t fb_reserve(fb_t *fb, size_t n, size_t align)
+{
+    size_t at = (fb->len + align - 1) & ~(align - 1);
+
+    if (fb->overflow || at > fb->size || fb->size - at < n) {
+        fb->overflow = true;
+        return 0;
+    }
+    memset(fb->buf + fb->len, 0, at + n - fb->len);
+    fb->len = at + n;
+    return at;
+}
+
+/* Stores a little-endian scalar */
+static void fb_put(fb_t *fb, size_t at, uint64_t value, size_t n)
+{
+    size_t i;
+
+    if (fb->overflow) {
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        fb->buf[at + i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/* Stores a forward offset from at to target */
+static void fb_ref(fb_t *fb, size_t at, size_t target)
+{
+    fb_put(fb, at, target - at, 4);
+}
+
+/*
+ * Writes a vtable and a zeroed table with one field per entry of sizes
+ * (0 = absent); the position of each field is returned in at.
+ */
+static size_t fb_table(fb_t *fb, const uint8_t *sizes, size_t count, size_t *at)
+{
+    uint16_t offsets[8];
+    size_t table_size = 4;
+    size_t vtable, table;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        offsets[i] = 0;
+        if (sizes[i]) {
+            table_size = (table_size + sizes[i] - 1) & ~(size_t)(sizes[i] - 1);
+            offsets[i] = (uint16_t)table_size;
+            table_size += sizes[i];
+        }
+    }
+
+    vtable = fb_reserve(fb, 4 + 2 * count, 2);
+    fb_put(fb, vtable, 4 + 2 * count, 2);
+    fb_put(fb, vtable + 2, table_size, 2);
+    for (i = 0; i < count; i++) {
+        fb_put(fb, vtable + 4 + 2 * i, offsets[i], 2);
+    }
+
+    table = fb_reserve(fb, table_size, 8);
+    fb_put(fb, table, table - vtable, 4);
+    for (i = 0; i < count; i++) {
+        at[i] = table + offsets[i];
+    }
+    return table;
+}
+
+/* Writes a vector length and zeroed elements; returns the length position */
+static size_t fb_vector(fb_t *fb, size_t count, size_t elem_size, size_t align)
+{
+    size_t at;
+
+    /* Elements follow the 4-byte length and need their own alignment */
+    if (align > 4 && ((fb->len + 4) & (align - 1))) {
+        fb_reserve(fb, align - ((fb->len + 4) & (align - 1)), 1);
+    }
+    at = fb_reserve(fb, 4 + count * elem_size, 4);
+    fb_put(fb, at, count, 4);
+    return at;
+}
+
+static size_t fb_string(fb_t *fb, const char *s)
+{
+    size_t n = strlen(s);
+    size_t at = fb_reserve(fb, 4 + n + 1, 4);
+
+    fb_put(fb, at, n, 4);
+    if (!fb->overflow) {
+        memcpy(fb->buf + at + 4, s, n);
+    }
+    return at;
+}
+
+/* Writes the root Message table; the header table is referenced from header_at */
+static size_t fb_message(fb_t *fb, uint8_t header_type, uint64_t body_len, size_t *header_at)
+{
+    static const uint8_t sizes[] = { 2, 1, 4, 8 };     /* version, header_type, header, bodyLength */
+    size_t root, message, at[4];
+
+    root = fb_reserve(fb, 4, 4);
+    message = fb_table(fb, sizes, 4, at);
+    fb_ref(fb, root, message);
+    fb_put(fb, at[0], FB_METADATA_V5, 2);
+    fb_put(fb, at[1], header_type, 1);
+    fb_put(fb, at[3], body_len, 8);
+    *header_at = at[2];
+    return message;
+}
+
+/* Writes a Field table referenced from at; kind -1 is the timestamp column */
+static void fb_field(fb_t *fb, size_t at, const char *name, bool nullable, const modbus_arrow_batch_t *batch, int kind)
+{
+    /* name, nullable, type_type, type, dictionary, children */
+    static const uint8_t field_sizes[] = { 4, 1, 1, 4, 0, 4 };
+    static const uint8_t int_sizes[] = { 4, 1 };       /* bitWidth, is_signed */
+    static const uint8_t float_sizes[] = { 2 };        /* precision */
+    static const uint8_t time_sizes[] = { 2, 4 };      /* unit, timezone */
+    size_t field, type, f[6], t[2];
+
+    field = fb_table(fb, field_sizes, 6, f);
+    fb_ref(fb, at, field);
+    fb_put(fb, f[1], nullable, 1);
+
+    if (kind < 0) {
+        fb_put(fb, f[2], FB_TYPE_TIMESTAMP, 1);
+        type = fb_table(fb, time_sizes, 2, t);
+        fb_put(fb, t[0], batch->time_unit, 2);
+        fb_ref(fb, t[1], fb_string(fb, "UTC"));
+    } else if (kinds[kind].fb_type == FB_TYPE_INT) {
+        fb_put(fb, f[2], FB_TYPE_INT, 1);
+        type = fb_table(fb, int_sizes, 2, t);
+        fb_put(fb, t[0], kinds[kind].bits, 4);
+        fb_put(fb, t[1], kinds[kind].is_signed, 1);
+    } else if (kinds[kind].fb_type == FB_TYPE_FLOATING_POINT) {
+        fb_put(fb, f[2], FB_TYPE_FLOATING_POINT, 1);
+        type = fb_table(fb, float_sizes, 1, t);
+        fb_put(fb, t[0], kinds[kind].bits, 2);
+    } else {
+        fb_put(fb, f[2], FB_TYPE_BOOL, 1);
+        type = fb_table(fb, NULL, 0, t);
+    }
+    fb_ref(fb, f[3], type);
+
+    fb_ref(fb, f[0], fb_string(fb, name));
+    /* Readers require the children vector even when empty */
+    fb_ref(fb, f[5], fb_vector(fb, 0, 4, 4));
+}
+
+/* Prepends the continuation marker and metadata length, padding to 8 bytes */
+static int finish_message(fb_t *fb, char *buf, size_t *len)
+{
+    size_t meta;
+
+    if (!fb->overflow) {
+        fb_reserve(fb, pad8(fb->len) - fb->len, 1);
+    }
+    if (fb->overflow) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    meta = fb->len;
+    memset(buf, 0xFF, 4);
+    buf[4] = (char)(meta & 0xFF);
+    buf[5] = (char)((meta >> 8) & 0xFF);
+    buf[6] = (char)((meta >> 16) & 0xFF);
+    buf[7] = (char)((meta >> 24) & 0xFF);
+    *len = 8 + meta;
+    return MODBUS_CONV_OK;
+}
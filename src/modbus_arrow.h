@@ -0,0 +1,211 @@
+/**
+ * @file modbus_arrow.h
+ * @brief Apache Arrow columnar export of plan results
+ * @details An Arrow batch accumulates successive executions of one plan as
+ *          columns: a timestamp column plus one column per point, typed after
+ *          the point data type, each with a validity (quality) bitmap set from
+ *          the conversion status. Columns are laid out in caller storage with
+ *          Arrow alignment and padding, so record batches are exported without
+ *          copying, either through the Arrow C data interface (e.g. pyarrow's
+ *          RecordBatch._import_from_c) or as IPC stream messages whose body is
+ *          returned as segments pointing into the columns.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_ARROW_H
+#define MODBUS_ARROW_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Arrow C data interface structures, as published by the Arrow project */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED   1
+#define ARROW_FLAG_NULLABLE             2
+#define ARROW_FLAG_MAP_KEYS_SORTED      4
+
+struct ArrowSchema {
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema *);
+    void *private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray *);
+    void *private_data;
+};
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
+/* Alignment of every column buffer */
+#define MODBUS_ARROW_ALIGN              64
+
+/* Timestamp units (values match the Arrow TimeUnit enumeration) */
+typedef enum {
+    MODBUS_ARROW_SECOND,
+    MODBUS_ARROW_MILLISECOND,
+    MODBUS_ARROW_MICROSECOND,
+    MODBUS_ARROW_NANOSECOND
+} modbus_arrow_time_unit_t;
+
+/* One point column */
+typedef struct {
+    void *data;                     /* Values in Arrow layout (booleans bit-packed) */
+    uint8_t *validity;              /* Bit set for rows that converted */
+    int64_t null_count;             /* Rows that failed */
+    const char *name;               /* Column name */
+    uint8_t kind;                   /* Arrow type of the column */
+    char label[12];                 /* Generated name when none is given */
+} modbus_arrow_column_t;
+
+/* Columnar batch for one plan, laid out in caller storage */
+typedef struct {
+    const modbus_plan_t *plan;      /* Plan the rows are produced with */
+    modbus_arrow_time_unit_t time_unit;
+    size_t capacity;                /* Rows the storage holds */
+    size_t rows;                    /* Rows appended */
+    int64_t *time;                  /* Timestamp column */
+    modbus_arrow_column_t *columns; /* One column per point */
+
+    /* C data interface export state */
+    struct ArrowSchema *child_schemas;
+    struct ArrowSchema **child_schema_ptrs;
+    struct ArrowArray *child_arrays;
+    struct ArrowArray **child_array_ptrs;
+    const void **buffers;
+} modbus_arrow_batch_t;
+
+/* Body segment of an IPC message (same members as struct iovec) */
+typedef struct {
+    const void *data;
+    size_t len;
+} modbus_arrow_segment_t;
+
+/**
+ * @brief Storage needed for a batch
+ * @param plan Compiled plan
+ * @param capacity Rows per batch
+ * @return Size in bytes for modbus_arrow_batch_init()
+ */
+size_t modbus_arrow_batch_size(const modbus_plan_t *plan, size_t capacity);
+
+/**
+ * @brief Lay out a batch in caller storage
+ * @param batch Batch to initialize
+ * @param plan Compiled plan (must outlive the batch)
+ * @param names Per-point column names (must outlive the batch), NULL for "p0", "p1", ...
+ * @param time_unit Unit of the timestamps passed to modbus_arrow_batch_append()
+ * @param capacity Rows per batch
+ * @param storage Storage of at least modbus_arrow_batch_size() bytes
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if storage is too small,
+ *         MODBUS_CONV_ERR_INVALID_TYPE for an unknown time unit
+ */
+int modbus_arrow_batch_init(modbus_arrow_batch_t *batch,
+                            const modbus_plan_t *plan,
+                            const char *const *names,
+                            modbus_arrow_time_unit_t time_unit,
+                            size_t capacity,
+                            void *storage,
+                            size_t storage_size);
+
+/**
+ * @brief Empty a batch for reuse
+ * @param batch Batch (must not be exported any more)
+ */
+void modbus_arrow_batch_reset(modbus_arrow_batch_t *batch);
+
+/**
+ * @brief Append the values of one plan execution as a row
+ * @param batch Batch
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Row timestamp in the batch time unit since the Unix epoch
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if the batch is full
+ */
+int modbus_arrow_batch_append(modbus_arrow_batch_t *batch,
+                              const modbus_value_t *values,
+                              const int *status,
+                              int64_t timestamp);
+
+/**
+ * @brief Export the batch through the Arrow C data interface
+ * @details Produces a struct array ("time" plus one child per point) whose
+ *          buffers point into the batch. The batch must not be appended to or
+ *          reset until the consumer has released the array.
+ * @param batch Batch
+ * @param array Receives the record batch
+ * @param schema Receives its schema
+ * @return MODBUS_CONV_OK on success
+ */
+int modbus_arrow_export(modbus_arrow_batch_t *batch,
+                        struct ArrowArray *array,
+                        struct ArrowSchema *schema);
+
+/**
+ * @brief Write the Schema message that starts an IPC stream
+ * @param batch Batch
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ * @param len Pointer to store the written length
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf is too small
+ */
+int modbus_arrow_ipc_schema(const modbus_arrow_batch_t *batch, char *buf, size_t size, size_t *len);
+
+/**
+ * @brief Write a RecordBatch IPC message for the rows of the batch
+ * @details buf receives the message header; the body is returned as segments
+ *          pointing into the batch columns, to be written right after the
+ *          header (e.g. with writev()). At most 2 * (point_count + 1) segments
+ *          are produced.
+ * @param batch Batch
+ * @param buf Output buffer for the message header
+ * @param size Size of the output buffer
+ * @param len Pointer to store the header length
+ * @param segments Array receiving the body segments
+ * @param max_segments Size of the segments array
+ * @param segment_count Pointer to store the number of segments
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf or segments is too small
+ */
+int modbus_arrow_ipc_batch(const modbus_arrow_batch_t *batch,
+                           char *buf,
+                           size_t size,
+                           size_t *len,
+                           modbus_arrow_segment_t *segments,
+                           size_t max_segments,
+                           size_t *segment_count);
+
+/**
+ * @brief Write the end-of-stream marker
+ * @param buf Output buffer (at least 8 bytes)
+ * @param size Size of the output buffer
+ * @param len Pointer to store the written length
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf is too small
+ */
+int modbus_arrow_ipc_eos(char *buf, size_t size, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_ARROW_H */
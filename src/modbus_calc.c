@@ -0,0 +1,651 @@
+/**
+ * @file modbus_calc.c
+ * @brief Calculated tag compiler and evaluator
+ * @author Mouli Sai
+ */
+
+#include "modbus_calc.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Instruction: opcode in the low byte, operand in the upper 24 bits */
+#define OP_CONST                0       /* Push constants[operand] */
+#define OP_POINT                1       /* Push plan point operand */
+#define OP_TAG                  2       /* Push tag operand */
+#define OP_ADD                  3
+#define OP_SUB                  4
+#define OP_MUL                  5
+#define OP_DIV                  6
+#define OP_NEG                  7
+#define OP_ABS                  8
+#define OP_SQRT                 9
+#define OP_MIN                  10
+#define OP_MAX                  11
+#define OP_POW                  12
+
+#define OPERAND_MAX             0xFFFFFFu
+#define INSTR(op, operand)      ((uint32_t)(op) | ((uint32_t)(operand) << 8))
+
+/* Built-in functions */
+typedef struct {
+    const char *name;
+    uint8_t op;
+    uint8_t args;
+} calc_function_t;
+
+static const calc_function_t functions[] = {
+    { "abs", OP_ABS, 1 },
+    { "sqrt", OP_SQRT, 1 },
+    { "min", OP_MIN, 2 },
+    { "max", OP_MAX, 2 },
+    { "pow", OP_POW, 2 }
+};
+
+/* Compiler state for one formula */
+typedef struct {
+    modbus_calc_t *calc;
+    const char *const *names;
+    const modbus_calc_tag_t *tags;
+    const char *expr;
+    size_t pos;
+    uint32_t code_len;
+    uint32_t code_cap;
+    uint32_t const_len;
+    uint32_t const_cap;
+    size_t depth;
+    size_t max_depth;
+    size_t nesting;
+    int error;
+} parser_t;
+
+/* Helper function prototypes */
+static void *take(uint8_t **cursor, const uint8_t *end, size_t bytes);
+static size_t formula_bound(const modbus_calc_tag_t *tags, size_t tag_count);
+static void skip_spaces(parser_t *p);
+static void fail(parser_t *p, int error);
+static void emit(parser_t *p, uint8_t op, uint32_t operand, int stack_change);
+static void parse_expr(parser_t *p);
+static void parse_term(parser_t *p);
+static void parse_unary(parser_t *p);
+static void parse_primary(parser_t *p);
+static void parse_name(parser_t *p, const char *name, size_t len);
+static bool is_name_start(char c);
+static bool is_name_char(char c);
+static bool resolve(parser_t *p, const char *name, size_t len, uint8_t *op, uint32_t *index);
+static void build_index(const modbus_calc_t *calc, uint8_t op, uint32_t count,
+                        uint32_t *offsets, uint32_t *list, uint32_t *mark);
+static double point_value(const modbus_calc_t *calc, uint32_t point,
+                          const modbus_value_t *values, const int *status);
+static double run(modbus_calc_t *calc, uint32_t tag, const modbus_value_t *values, const int *status);
+
+size_t modbus_calc_size(const modbus_plan_t *plan, const modbus_calc_tag_t *tags, size_t tag_count)
+{
+    size_t points = plan ? plan->point_count : 0;
+    size_t bound = formula_bound(tags, tag_count);
+    size_t words = points > tag_count ? points : tag_count;
+
+    /* Doubles: values, constants, stack; words: code, offsets, order, lists, scratch */
+    return (tag_count + 2 * bound) * sizeof(double) +
+           (3 * bound + 3 * (tag_count + 1) + points + 1 + 2 * words) * sizeof(uint32_t) +
+           tag_count + 16 * sizeof(double);
+}
+
+int modbus_calc_compile(modbus_calc_t *calc,
+                        const modbus_plan_t *plan,
+                        const char *const *names,
+                        const modbus_calc_tag_t *tags,
+                        size_t tag_count,
+                        void *storage,
+                        size_t storage_size)
+{
+    uint8_t *cursor = (uint8_t *)storage;
+    const uint8_t *end = cursor + storage_size;
+    size_t points, bound, words, done, head;
+    uint32_t *indegree, *mark;
+    parser_t p;
+    size_t t;
+
+    if (!calc || !plan || (!tags && tag_count) || !storage) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    memset(calc, 0, sizeof(*calc));
+    points = plan->point_count;
+    bound = formula_bound(tags, tag_count);
+    words = points > tag_count ? points : tag_count;
+    if (points > OPERAND_MAX || tag_count > OPERAND_MAX || bound > UINT32_MAX) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    calc->plan = plan;
+    calc->tag_count = tag_count;
+    calc->values = (double *)take(&cursor, end, tag_count * sizeof(double));
+    calc->constants = (double *)take(&cursor, end, bound * sizeof(double));
+    calc->stack = (double *)take(&cursor, end, bound * sizeof(double));
+    calc->code = (uint32_t *)take(&cursor, end, bound * sizeof(uint32_t));
+    calc->code_offsets = (uint32_t *)take(&cursor, end, (tag_count + 1) * sizeof(uint32_t));
+    calc->order = (uint32_t *)take(&cursor, end, (tag_count + 1) * sizeof(uint32_t));
+    calc->point_offsets = (uint32_t *)take(&cursor, end, (points + 1) * sizeof(uint32_t));
+    calc->point_tags = (uint32_t *)take(&cursor, end, bound * sizeof(uint32_t));
+    calc->tag_offsets = (uint32_t *)take(&cursor, end, (tag_count + 1) * sizeof(uint32_t));
+    calc->tag_tags = (uint32_t *)take(&cursor, end, bound * sizeof(uint32_t));
+    indegree = (uint32_t *)take(&cursor, end, words * sizeof(uint32_t));
+    mark = (uint32_t *)take(&cursor, end, words * sizeof(uint32_t));
+    calc->dirty = (uint8_t *)take(&cursor, end, tag_count);
+    if (!calc->values || !calc->constants || !calc->stack || !calc->code || !calc->code_offsets ||
+        !calc->order || !calc->point_offsets || !calc->point_tags || !calc->tag_offsets ||
+        !calc->tag_tags || !indegree || !mark || !calc->dirty) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    /* Compile every formula into one code array */
+    memset(&p, 0, sizeof(p));
+    p.calc = calc;
+    p.names = names;
+    p.tags = tags;
+    p.code_cap = (uint32_t)bound;
+    p.const_cap = (uint32_t)bound;
+    for (t = 0; t < tag_count; t++) {
+        calc->code_offsets[t] = p.code_len;
+        p.expr = tags[t].expr ? tags[t].expr : "";
+        p.pos = 0;
+        p.depth = 0;
+        p.nesting = 0;
+        parse_expr(&p);
+        skip_spaces(&p);
+        if (!p.error && p.expr[p.pos] != '\0') {
+            fail(&p, MODBUS_CONV_ERR_FRAME);
+        }
+        if (p.error) {
+            calc->error_tag = t;
+            calc->error_pos = p.pos;
+            return p.error;
+        }
+    }
+    calc->code_offsets[tag_count] = p.code_len;
+    calc->stack_size = p.max_depth;
+
+    /* Readers of every point and of every tag */
+    build_index(calc, OP_POINT, (uint32_t)points, calc->point_offsets, calc->point_tags, mark);
+    build_index(calc, OP_TAG, (uint32_t)tag_count, calc->tag_offsets, calc->tag_tags, mark);
+
+    /* Dependency order (Kahn): a tag follows every tag it reads */
+    memset(indegree, 0, tag_count * sizeof(uint32_t));
+    for (t = 0; t < calc->tag_offsets[tag_count]; t++) {
+        indegree[calc->tag_tags[t]]++;
+    }
+    done = 0;
+    for (t = 0; t < tag_count; t++) {
+        if (indegree[t] == 0) {
+            calc->order[done++] = (uint32_t)t;
+        }
+    }
+    for (head = 0; head < done; head++) {
+        uint32_t u = calc->order[head];
+        uint32_t k;
+
+        for (k = calc->tag_offsets[u]; k < calc->tag_offsets[u + 1]; k++) {
+            if (--indegree[calc->tag_tags[k]] == 0) {
+                calc->order[done++] = calc->tag_tags[k];
+            }
+        }
+    }
+    if (done < tag_count) {
+        t = 0;
+        while (indegree[t] == 0) {
+            t++;
+        }
+        calc->error_tag = t;
+        calc->error_pos = 0;
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    for (t = 0; t < tag_count; t++) {
+        calc->values[t] = NAN;
+    }
+    memset(calc->dirty, 0, tag_count);
+    return MODBUS_CONV_OK;
+}
+
+size_t modbus_calc_eval(modbus_calc_t *calc,
+                        const modbus_value_t *values,
+                        const int *status,
+                        const uint32_t *changed,
+                        size_t change_count,
+                        uint32_t *changed_tags)
+{
+    size_t count = 0;
+    size_t i;
+
+    if (!calc || !values) {
+        return 0;
+    }
+
+    if (!changed) {
+        memset(calc->dirty, 1, calc->tag_count);
+    } else {
+        for (i = 0; i < change_count; i++) {
+            uint32_t p = changed[i];
+            uint32_t k;
+
+            if (p >= calc->plan->point_count) {
+                continue;
+            }
+            for (k = calc->point_offsets[p]; k < calc->point_offsets[p + 1]; k++) {
+                calc->dirty[calc->point_tags[k]] = 1;
+            }
+        }
+    }
+
+    for (i = 0; i < calc->tag_count; i++) {
+        uint32_t t = calc->order[i];
+        double value;
+        uint32_t k;
+
+        if (!calc->dirty[t]) {
+            continue;
+        }
+        calc->dirty[t] = 0;
+        value = run(calc, t, values, status);
+        if (memcmp(&value, &calc->values[t], sizeof(value)) == 0) {
+            continue;
+        }
+
+        calc->values[t] = value;
+        for (k = calc->tag_offsets[t]; k < calc->tag_offsets[t + 1]; k++) {
+            calc->dirty[calc->tag_tags[k]] = 1;
+        }
+        if (changed_tags) {
+            changed_tags[count] = t;
+        }
+        count++;
+    }
+    return count;
+}
+
+/* Helper function implementations */
+
+/* Bump allocation from caller storage, 8-byte aligned */
+static void *take(uint8_t **cursor, const uint8_t *end, size_t bytes)
+{
+    size_t pad = (size_t)(-(uintptr_t)*cursor & 7u);
+    uint8_t *start;
+
+    if ((size_t)(end - *cursor) < pad || (size_t)(end - *cursor) - pad < bytes) {
+        return NULL;
+    }
+    start = *cursor + pad;
+    *cursor = start + bytes;
+    return start;
+}
+
+/* Instructions, literals and references of a formula never exceed its length + 1 */
+static size_t formula_bound(const modbus_calc_tag_t *tags, size_t tag_count)
+{
+    size_t bound = 1;
+    size_t t;
+
+    for (t = 0; t < tag_count; t++) {
+        bound += (tags[t].expr ? strlen(tags[t].expr) : 0) + 1;
+    }
+    return bound;
+}
+
+static void skip_spaces(parser_t *p)
+{
+    while (p->expr[p->pos] == ' ' || p->expr[p->pos] == '\t') {
+        p->pos++;
+    }
+}
+
+static void fail(parser_t *p, int error)
+{
+    if (!p->error) {
+        p->error = error;
+    }
+}
+
+static void emit(parser_t *p, uint8_t op, uint32_t operand, int stack_change)
+{
+    if (p->error) {
+        return;
+    }
+    if (p->code_len == p->code_cap || operand > OPERAND_MAX) {
+        fail(p, MODBUS_CONV_ERR_BUFFER);
+        return;
+    }
+    p->calc->code[p->code_len++] = INSTR(op, operand);
+    p->depth = (size_t)((long)p->depth + stack_change);
+    if (p->depth > p->max_depth) {
+        p->max_depth = p->depth;
+    }
+}
+
+/* expr := term (('+' | '-') term)* */
+static void parse_expr(parser_t *p)
+{
+    parse_term(p);
+    for (;;) {
+        char c;
+
+        skip_spaces(p);
+        c = p->expr[p->pos];
+        if (p->error || (c != '+' && c != '-')) {
+            return;
+        }
+        p->pos++;
+        parse_term(p);
+        emit(p, c == '+' ? OP_ADD : OP_SUB, 0, -1);
+    }
+}
+
+/* term := unary (('*' | '/') unary)* */
+static void parse_term(parser_t *p)
+{
+    parse_unary(p);
+    for (;;) {
+        char c;
+
+        skip_spaces(p);
+        c = p->expr[p->pos];
+        if (p->error || (c != '*' && c != '/')) {
+            return;
+        }
+        p->pos++;
+        parse_unary(p);
+        emit(p, c == '*' ? OP_MUL : OP_DIV, 0, -1);
+    }
+}
+
+/* unary := '-' unary | '+' unary | primary; every recursion passes here */
+static void parse_unary(parser_t *p)
+{
+    skip_spaces(p);
+    if (p->error) {
+        return;
+    }
+    if (p->nesting > MODBUS_CALC_MAX_NESTING) {
+        fail(p, MODBUS_CONV_ERR_FRAME);
+        return;
+    }
+    p->nesting++;
+    if (p->expr[p->pos] == '-') {
+        p->pos++;
+        parse_unary(p);
+        emit(p, OP_NEG, 0, 0);
+    } else if (p->expr[p->pos] == '+') {
+        p->pos++;
+        parse_unary(p);
+    } else {
+        parse_primary(p);
+    }
+    p->nesting--;
+}
+
+/* primary := number | name | name '(' args ')' | '(' expr ')' */
+static void parse_primary(parser_t *p)
+{
+    const char *s;
+    char c;
+
+    if (p->error) {
+        return;
+    }
+    skip_spaces(p);
+    s = p->expr + p->pos;
+    c = *s;
+
+    if (c == '(') {
+        p->pos++;
+        parse_expr(p);
+        skip_spaces(p);
+        if (p->expr[p->pos] != ')') {
+            fail(p, MODBUS_CONV_ERR_FRAME);
+            return;
+        }
+        p->pos++;
+        return;
+    }
+
+    if ((c >= '0' && c <= '9') || (c == '.' && s[1] >= '0' && s[1] <= '9')) {
+        char *after;
+        double value = strtod(s, &after);
+
+        if (p->const_len == p->const_cap) {
+            fail(p, MODBUS_CONV_ERR_BUFFER);
+            return;
+        }
+        p->calc->constants[p->const_len] = value;
+        emit(p, OP_CONST, p->const_len++, 1);
+        p->pos += (size_t)(after - s);
+        return;
+    }
+
+    if (is_name_start(c)) {
+        size_t len = 1;
+
+        while (is_name_char(s[len])) {
+            len++;
+        }
+        p->pos += len;
+        parse_name(p, s, len);
+        return;
+    }
+
+    fail(p, MODBUS_CONV_ERR_FRAME);
+}
+
+/* Function call or variable reference */
+static void parse_name(parser_t *p, const char *name, size_t len)
+{
+    size_t f;
+    uint8_t op;
+    uint32_t index;
+
+    skip_spaces(p);
+    if (p->expr[p->pos] != '(') {
+        if (!resolve(p, name, len, &op, &index)) {
+            p->pos -= len;
+            fail(p, MODBUS_CONV_ERR_INVALID_TYPE);
+            return;
+        }
+        emit(p, op, index, 1);
+        return;
+    }
+
+    for (f = 0; f < sizeof(functions) / sizeof(functions[0]); f++) {
+        if (strlen(functions[f].name) == len && strncmp(functions[f].name, name, len) == 0) {
+            break;
+        }
+    }
+    if (f == sizeof(functions) / sizeof(functions[0])) {
+        fail(p, MODBUS_CONV_ERR_INVALID_TYPE);
+        return;
+    }
+
+    p->pos++;
+    parse_expr(p);
+    if (functions[f].args == 2) {
+        skip_spaces(p);
+        if (p->expr[p->pos] != ',') {
+            fail(p, MODBUS_CONV_ERR_FRAME);
+            return;
+        }
+        p->pos++;
+        parse_expr(p);
+    }
+    skip_spaces(p);
+    if (p->expr[p->pos] != ')') {
+        fail(p, MODBUS_CONV_ERR_FRAME);
+        return;
+    }
+    p->pos++;
+    emit(p, functions[f].op, 0, 1 - functions[f].args);
+}
+
+static bool is_name_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_name_char(char c)
+{
+    return is_name_start(c) || (c >= '0' && c <= '9') || c == '.';
+}
+
+/* Tag names first, then point names (or pN without names) */
+static bool resolve(parser_t *p, const char *name, size_t len, uint8_t *op, uint32_t *index)
+{
+    const modbus_plan_t *plan = p->calc->plan;
+    size_t i;
+
+    for (i = 0; i < p->calc->tag_count; i++) {
+        const char *tag = p->tags[i].name;
+        if (tag && strlen(tag) == len && strncmp(tag, name, len) == 0) {
+            *op = OP_TAG;
+            *index = (uint32_t)i;
+            return true;
+        }
+    }
+
+    if (p->names) {
+        for (i = 0; i < plan->point_count; i++) {
+            const char *point = p->names[i];
+            if (point && strlen(point) == len && strncmp(point, name, len) == 0) {
+                *op = OP_POINT;
+                *index = (uint32_t)i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (len >= 2 && name[0] == 'p') {
+        size_t value = 0;
+
+        for (i = 1; i < len; i++) {
+            if (name[i] < '0' || name[i] > '9' || value > plan->point_count) {
+                return false;
+            }
+            value = value * 10 + (size_t)(name[i] - '0');
+        }
+        if (value < plan->point_count) {
+            *op = OP_POINT;
+            *index = (uint32_t)value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* CSR list of the tags referring to each point or tag, without duplicates */
+static void build_index(const modbus_calc_t *calc, uint8_t op, uint32_t count,
+                        uint32_t *offsets, uint32_t *list, uint32_t *mark)
+{
+    uint32_t t, pc, i;
+
+    memset(offsets, 0, ((size_t)count + 1) * sizeof(uint32_t));
+    memset(mark, 0, (size_t)count * sizeof(uint32_t));
+    for (t = 0; t < calc->tag_count; t++) {
+        for (pc = calc->code_offsets[t]; pc < calc->code_offsets[t + 1]; pc++) {
+            uint32_t instr = calc->code[pc];
+            uint32_t target = instr >> 8;
+
+            if ((instr & 0xFF) == op && mark[target] != t + 1) {
+                mark[target] = t + 1;
+                offsets[target + 1]++;
+            }
+        }
+    }
+    for (i = 0; i < count; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    memset(mark, 0, (size_t)count * sizeof(uint32_t));
+    for (t = 0; t < calc->tag_count; t++) {
+        for (pc = calc->code_offsets[t]; pc < calc->code_offsets[t + 1]; pc++) {
+            uint32_t instr = calc->code[pc];
+            uint32_t target = instr >> 8;
+
+            if ((instr & 0xFF) == op && mark[target] != t + 1) {
+                mark[target] = t + 1;
+                list[offsets[target]++] = t;
+            }
+        }
+    }
+    /* The fill advanced offsets[i] to the end of list i */
+    for (i = count; i > 0; i--) {
+        offsets[i] = offsets[i - 1];
+    }
+    offsets[0] = 0;
+}
+
+static double point_value(const modbus_calc_t *calc, uint32_t point,
+                          const modbus_value_t *values, const int *status)
+{
+    if (status && status[point] != MODBUS_CONV_OK) {
+        return NAN;
+    }
+    return modbus_value_to_double(calc->plan->points[point].data_type, &values[point]);
+}
+
+static double run(modbus_calc_t *calc, uint32_t tag, const modbus_value_t *values, const int *status)
+{
+    double *sp = calc->stack;
+    uint32_t pc;
+
+    for (pc = calc->code_offsets[tag]; pc < calc->code_offsets[tag + 1]; pc++) {
+        uint32_t instr = calc->code[pc];
+        uint32_t arg = instr >> 8;
+
+        switch (instr & 0xFF) {
+            case OP_CONST:
+                *sp++ = calc->constants[arg];
+                break;
+            case OP_POINT:
+                *sp++ = point_value(calc, arg, values, status);
+                break;
+            case OP_TAG:
+                *sp++ = calc->values[arg];
+                break;
+            case OP_ADD:
+                sp--;
+                sp[-1] += sp[0];
+                break;
+            case OP_SUB:
+                sp--;
+                sp[-1] -= sp[0];
+                break;
+            case OP_MUL:
+                sp--;
+                sp[-1] *= sp[0];
+                break;
+            case OP_DIV:
+                sp--;
+                sp[-1] /= sp[0];
+                break;
+            case OP_NEG:
+                sp[-1] = -sp[-1];
+                break;
+            case OP_ABS:
+                sp[-1] = fabs(sp[-1]);
+                break;
+            case OP_SQRT:
+                sp[-1] = sqrt(sp[-1]);
+                break;
+            case OP_MIN:
+                sp--;
+                sp[-1] = isnan(sp[-1]) || isnan(sp[0]) ? NAN : fmin(sp[-1], sp[0]);
+                break;
+            case OP_MAX:
+                sp--;
+                sp[-1] = isnan(sp[-1]) || isnan(sp[0]) ? NAN : fmax(sp[-1], sp[0]);
+                break;
+            default:
+                sp--;
+                sp[-1] = pow(sp[-1], sp[0]);
+                break;
+        }
+    }
+    return sp > calc->stack ? sp[-1] : NAN;
+}
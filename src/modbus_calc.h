@@ -0,0 +1,115 @@
+/**
+ * @file modbus_calc.h
+ * @brief Calculated tags: formulas over converted points
+ * @details Tag formulas such as "V1 * I1 * PF1 + V2 * I2 * PF2" are compiled
+ *          once into stack bytecode. Names resolve to other calculated tags
+ *          or to plan points; tags are evaluated in dependency order, and an
+ *          incremental evaluation only re-runs the tags whose inputs changed,
+ *          then the tags depending on those that changed in turn.
+ *
+ *          Grammar: + - * / with the usual precedence, unary minus,
+ *          parentheses, decimal numbers and the functions abs(x), sqrt(x),
+ *          min(a, b), max(a, b) and pow(a, b), nested at most
+ *          MODBUS_CALC_MAX_NESTING deep. Points that failed to convert read as
+ *          NaN, which propagates to dependent tags, min() and max() included.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_CALC_H
+#define MODBUS_CALC_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Deepest nesting of parentheses, unary signs and function calls */
+#define MODBUS_CALC_MAX_NESTING         64
+
+/* Tag definition */
+typedef struct {
+    const char *name;               /* Tag name, usable in other formulas */
+    const char *expr;               /* Formula */
+} modbus_calc_tag_t;
+
+/* Compiled tags; arrays in caller storage */
+typedef struct {
+    const modbus_plan_t *plan;      /* Plan providing the inputs */
+    size_t tag_count;               /* Number of tags */
+    double *values;                 /* Current value of every tag */
+
+    uint32_t *code;                 /* Bytecode of all tags */
+    uint32_t *code_offsets;         /* tag_count + 1 code boundaries */
+    double *constants;              /* Literal pool */
+    uint32_t *order;                /* Evaluation order */
+    uint32_t *point_offsets;        /* point_count + 1 boundaries into point_tags */
+    uint32_t *point_tags;           /* Tags reading each point */
+    uint32_t *tag_offsets;          /* tag_count + 1 boundaries into tag_tags */
+    uint32_t *tag_tags;             /* Tags reading each tag */
+    uint8_t *dirty;                 /* Tags to re-evaluate */
+    double *stack;                  /* Evaluation stack */
+    size_t stack_size;              /* Deepest stack of any formula */
+
+    size_t error_tag;               /* Compile error: tag index */
+    size_t error_pos;               /* Compile error: offset in the formula */
+} modbus_calc_t;
+
+/**
+ * @brief Storage needed to compile a set of tags
+ * @param plan Plan providing the inputs
+ * @param tags Tag definitions
+ * @param tag_count Number of tags
+ * @return Size in bytes for modbus_calc_compile() (an upper bound)
+ */
+size_t modbus_calc_size(const modbus_plan_t *plan, const modbus_calc_tag_t *tags, size_t tag_count);
+
+/**
+ * @brief Compile tag formulas
+ * @details On a compile error, error_tag and error_pos locate it.
+ * @param calc Calculated tags to initialize
+ * @param plan Plan providing the inputs (must outlive calc)
+ * @param names Point names, one per plan point; NULL to refer to points as p0, p1, ...
+ * @param tags Tag definitions (only used during compilation)
+ * @param tag_count Number of tags
+ * @param storage Storage of at least modbus_calc_size() bytes
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_FRAME for a syntax error
+ *         or nesting deeper than MODBUS_CALC_MAX_NESTING,
+ *         MODBUS_CONV_ERR_INVALID_TYPE for an unknown name or a dependency cycle,
+ *         MODBUS_CONV_ERR_BUFFER if storage is too small
+ */
+int modbus_calc_compile(modbus_calc_t *calc,
+                        const modbus_plan_t *plan,
+                        const char *const *names,
+                        const modbus_calc_tag_t *tags,
+                        size_t tag_count,
+                        void *storage,
+                        size_t storage_size);
+
+/**
+ * @brief Evaluate the tags affected by changed points
+ * @details Pass changed = NULL to evaluate every tag (required the first time).
+ *          Changed point lists typically come from modbus_plan_changes().
+ * @param calc Compiled tags
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param changed Indices of changed points, or NULL for all
+ * @param change_count Number of changed points
+ * @param changed_tags Array of tag_count entries receiving the tags whose value
+ *        changed, in evaluation order; may be NULL
+ * @return Number of tags whose value changed
+ */
+size_t modbus_calc_eval(modbus_calc_t *calc,
+                        const modbus_value_t *values,
+                        const int *status,
+                        const uint32_t *changed,
+                        size_t change_count,
+                        uint32_t *changed_tags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_CALC_H */
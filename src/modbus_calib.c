@@ -0,0 +1,195 @@
+/**
+ * @file modbus_calib.c
+ * @brief Sensor calibration implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_calib.h"
+#include <string.h>
+
+/* Readings per chunk of the vectorized polynomial loop */
+#define POLY_CHUNK              64
+
+/* Helper function prototypes */
+static size_t eytzinger_fill(modbus_calib_t *calib, const double *x, size_t n, size_t slot, size_t rank);
+static double table_eval(const modbus_calib_t *calib, double x);
+static unsigned lsb_index(uint64_t value);
+
+size_t modbus_calib_table_size(size_t count)
+{
+    /* Keys and segment slots are 1-based with slot 0 as the "above all" result */
+    return (count + 1) * sizeof(double) +
+           ((count + 2) / 2) * sizeof(uint64_t) +
+           2 * (count ? count - 1 : 0) * sizeof(double);
+}
+
+int modbus_calib_table(modbus_calib_t *calib,
+                       const double *x,
+                       const double *y,
+                       size_t count,
+                       void *storage,
+                       size_t storage_size)
+{
+    uint64_t *p = (uint64_t *)storage;
+    size_t i;
+
+    if (!calib || !x || !y || !storage) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (count < 2 || count > UINT32_MAX) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    for (i = 1; i < count; i++) {
+        if (!(x[i] > x[i - 1])) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+    }
+    if (storage_size < modbus_calib_table_size(count)) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    memset(calib, 0, sizeof(*calib));
+    calib->kind = MODBUS_CALIB_TABLE;
+    calib->count = count;
+    calib->lo = x[0];
+    calib->hi = x[count - 1];
+
+    calib->keys = (double *)(void *)p;
+    p += count + 1;
+    calib->segment = (uint32_t *)(void *)p;
+    p += (count + 2) / 2;
+    calib->slope = (double *)(void *)p;
+    p += count - 1;
+    calib->intercept = (double *)(void *)p;
+
+    calib->keys[0] = 0.0;
+    calib->segment[0] = (uint32_t)(count - 2);
+    eytzinger_fill(calib, x, count, 1, 0);
+
+    for (i = 0; i + 1 < count; i++) {
+        calib->slope[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]);
+        calib->intercept[i] = y[i] - calib->slope[i] * x[i];
+    }
+    return MODBUS_CONV_OK;
+}
+
+int modbus_calib_poly(modbus_calib_t *calib, const double *coeffs, size_t count)
+{
+    if (!calib || !coeffs) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (count == 0) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    memset(calib, 0, sizeof(*calib));
+    calib->kind = MODBUS_CALIB_POLY;
+    calib->count = count;
+    calib->coeffs = coeffs;
+    return MODBUS_CONV_OK;
+}
+
+double modbus_calib_eval(const modbus_calib_t *calib, double x)
+{
+    if (calib->kind == MODBUS_CALIB_TABLE) {
+        return table_eval(calib, x);
+    }
+    if (calib->kind == MODBUS_CALIB_POLY) {
+        const double *c = calib->coeffs;
+        size_t k = calib->count - 1;
+        double acc = c[k];
+
+        while (k-- > 0) {
+            acc = acc * x + c[k];
+        }
+        return acc;
+    }
+    return x;
+}
+
+int modbus_calib_apply(const modbus_calib_t *calib, const double *in, double *out, size_t count)
+{
+    size_t base;
+
+    if (!calib || (!in && count) || (!out && count)) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    if (calib->kind != MODBUS_CALIB_POLY) {
+        for (base = 0; base < count; base++) {
+            out[base] = modbus_calib_eval(calib, in[base]);
+        }
+        return MODBUS_CONV_OK;
+    }
+
+    /* Horner across a chunk of readings per coefficient; the chunk keeps inputs when in == out */
+    for (base = 0; base < count; base += POLY_CHUNK) {
+        const double *c = calib->coeffs;
+        size_t n = count - base < POLY_CHUNK ? count - base : POLY_CHUNK;
+        double acc[POLY_CHUNK];
+        size_t k = calib->count - 1;
+        size_t j;
+
+        for (j = 0; j < n; j++) {
+            acc[j] = c[k];
+        }
+        while (k-- > 0) {
+            for (j = 0; j < n; j++) {
+                acc[j] = acc[j] * in[base + j] + c[k];
+            }
+        }
+        memcpy(out + base, acc, n * sizeof(double));
+    }
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+
+/* In-order walk of the implicit tree; returns the next rank to place */
+static size_t eytzinger_fill(modbus_calib_t *calib, const double *x, size_t n, size_t slot, size_t rank)
+{
+    if (slot > n) {
+        return rank;
+    }
+    rank = eytzinger_fill(calib, x, n, 2 * slot, rank);
+    calib->keys[slot] = x[rank];
+    /* The first breakpoint above x ends the segment x lies in */
+    calib->segment[slot] = (uint32_t)(rank == 0 ? 0 : rank - 1);
+    return eytzinger_fill(calib, x, n, 2 * slot + 1, rank + 1);
+}
+
+static double table_eval(const modbus_calib_t *calib, double x)
+{
+    const double *keys = calib->keys;
+    size_t n = calib->count;
+    size_t k = 1;
+    uint32_t s;
+
+    /* Clamp with compares rather than fmin/fmax so NaN passes through */
+    x = x < calib->lo ? calib->lo : x;
+    x = x > calib->hi ? calib->hi : x;
+
+    /* Descend the full depth; the comparison only picks the child */
+    while (k <= n) {
+        k = 2 * k + (keys[k] <= x);
+    }
+    /* Undo the right turns taken after the last left turn: the first key above x */
+    k >>= lsb_index(~(uint64_t)k) + 1;
+
+    s = calib->segment[k];
+    return calib->intercept[s] + calib->slope[s] * x;
+}
+
+static unsigned lsb_index(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(value);
+#else
+    unsigned n = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
@@ -0,0 +1,108 @@
+/**
+ * @file modbus_calib.h
+ * @brief Sensor calibration: lookup-table linearization and polynomials
+ * @details A calibration maps a converted (and scaled) value to its
+ *          engineering value, either by linear interpolation in a table of
+ *          breakpoints (thermocouple tables, tank strapping tables) or by a
+ *          polynomial. Table breakpoints are stored in Eytzinger (BFS) order
+ *          so the segment search is a fixed-depth loop without data-dependent
+ *          branches; polynomials are evaluated with Horner's scheme.
+ *
+ *          Calibrations are attached to points through modbus_point_t.calib
+ *          and applied during plan execution, or run directly over arrays of
+ *          readings with modbus_calib_apply().
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_CALIB_H
+#define MODBUS_CALIB_H
+
+#include "modbus_conversion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Calibration kinds */
+#define MODBUS_CALIB_TABLE              1
+#define MODBUS_CALIB_POLY               2
+
+/* Calibration; arrays in caller storage */
+typedef struct modbus_calib {
+    uint8_t kind;                   /* MODBUS_CALIB_* */
+    size_t count;                   /* Breakpoints, or polynomial coefficients */
+
+    /* Table */
+    double lo;                      /* First breakpoint: inputs are clamped to [lo, hi] */
+    double hi;                      /* Last breakpoint */
+    double *keys;                   /* Breakpoints in Eytzinger order, 1-based */
+    uint32_t *segment;              /* Segment ending at each Eytzinger slot */
+    double *slope;                  /* Per segment */
+    double *intercept;              /* Per segment */
+
+    /* Polynomial */
+    const double *coeffs;           /* c0 + c1 x + ... (not copied) */
+} modbus_calib_t;
+
+/**
+ * @brief Storage needed for a lookup table
+ * @param count Number of breakpoints
+ * @return Size in bytes for modbus_calib_table()
+ */
+size_t modbus_calib_table_size(size_t count);
+
+/**
+ * @brief Build a piecewise-linear calibration from a table
+ * @details Inputs outside the table are clamped to its first or last breakpoint.
+ * @param calib Calibration to initialize
+ * @param x Input breakpoints, strictly increasing
+ * @param y Output value at each breakpoint
+ * @param count Number of breakpoints (at least 2)
+ * @param storage Storage of at least modbus_calib_table_size() bytes, 8-byte aligned
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if x is not
+ *         strictly increasing or has fewer than 2 entries,
+ *         MODBUS_CONV_ERR_BUFFER if storage is too small
+ */
+int modbus_calib_table(modbus_calib_t *calib,
+                       const double *x,
+                       const double *y,
+                       size_t count,
+                       void *storage,
+                       size_t storage_size);
+
+/**
+ * @brief Build a polynomial calibration
+ * @param calib Calibration to initialize
+ * @param coeffs Coefficients c0, c1, ... in ascending order (must outlive calib)
+ * @param count Number of coefficients (degree + 1, at least 1)
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if count is 0
+ */
+int modbus_calib_poly(modbus_calib_t *calib, const double *coeffs, size_t count);
+
+/**
+ * @brief Calibrate one value
+ * @param calib Initialized calibration
+ * @param x Input value
+ * @return Calibrated value (NaN stays NaN)
+ */
+double modbus_calib_eval(const modbus_calib_t *calib, double x);
+
+/**
+ * @brief Calibrate an array of readings
+ * @details The polynomial loop runs across readings for each coefficient so
+ *          it vectorizes. in and out may be the same array.
+ * @param calib Initialized calibration
+ * @param in Input values
+ * @param out Array receiving the calibrated values
+ * @param count Number of values
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_NULL_PTR for NULL arguments
+ */
+int modbus_calib_apply(const modbus_calib_t *calib, const double *in, double *out, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_CALIB_H */
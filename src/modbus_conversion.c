@@ -492,6 +492,100 @@ int modbus_convert_float64(const uint16_t *registers,
     return MODBUS_CONV_OK;
 }
 
+/* Register count per data type */
+size_t modbus_type_reg_count(modbus_data_type_t data_type)
+{
+    if ((int)data_type < 0) {
+        return 0;
+    }
+    if (data_type <= MODBUS_INT16_UNSIGNED_BA) {
+        return 1;
+    }
+    if (data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        return 2;
+    }
+    if (data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        return 4;
+    }
+    if (data_type <= MODBUS_IEEE_FLOAT32_BADC) {
+        return 2;
+    }
+    if (data_type <= MODBUS_IEEE_FLOAT64_EFGHABCD) {
+        return 4;
+    }
+    return 0;
+}
+
+/* Widen result to double */
+double modbus_value_to_double(modbus_data_type_t data_type, const modbus_value_t *value)
+{
+    if (!value) {
+        return 0.0;
+    }
+
+    switch (data_type) {
+        case MODBUS_BIT_BOOLEAN:
+            return value->bool_val ? 1.0 : 0.0;
+        case MODBUS_INT8_SIGNED:
+            return value->i8;
+        case MODBUS_INT8_UNSIGNED:
+            return value->u8;
+        case MODBUS_INT16_SIGNED_AB:
+        case MODBUS_INT16_SIGNED_BA:
+            return value->i16;
+        case MODBUS_INT16_UNSIGNED_AB:
+        case MODBUS_INT16_UNSIGNED_BA:
+            return value->u16;
+        default:
+            break;
+    }
+
+    if (data_type >= MODBUS_INT32_SIGNED_ABCD && data_type <= MODBUS_INT32_SIGNED_CDAB) {
+        return value->i32;
+    }
+    if (data_type >= MODBUS_INT32_UNSIGNED_ABCD && data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        return value->u32;
+    }
+    if (data_type >= MODBUS_INT64_SIGNED_ABCDEFGH && data_type <= MODBUS_INT64_SIGNED_EFGHABCD) {
+        return (double)value->i64;
+    }
+    if (data_type >= MODBUS_INT64_UNSIGNED_ABCDEFGH && data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        return (double)value->u64;
+    }
+    if (data_type >= MODBUS_IEEE_FLOAT32_ABCD && data_type <= MODBUS_IEEE_FLOAT32_BADC) {
+        return value->f32;
+    }
+    if (data_type >= MODBUS_IEEE_FLOAT64_ABCDEFGH && data_type <= MODBUS_IEEE_FLOAT64_EFGHABCD) {
+        return value->f64;
+    }
+    return 0.0;
+}
+
+/* Data type names, indexed by modbus_data_type_t */
+static const char *const type_names[] = {
+    "BIT_BOOLEAN",
+    "INT8_SIGNED", "INT8_UNSIGNED",
+    "INT16_SIGNED_AB", "INT16_SIGNED_BA", "INT16_UNSIGNED_AB", "INT16_UNSIGNED_BA",
+    "INT32_SIGNED_ABCD", "INT32_SIGNED_DCBA", "INT32_SIGNED_BADC", "INT32_SIGNED_CDAB",
+    "INT32_UNSIGNED_ABCD", "INT32_UNSIGNED_DCBA", "INT32_UNSIGNED_BADC", "INT32_UNSIGNED_CDAB",
+    "INT64_SIGNED_ABCDEFGH", "INT64_SIGNED_HGFEDCBA", "INT64_SIGNED_BADCFEHG", "INT64_SIGNED_CDABGHEF",
+    "INT64_SIGNED_DCBAHGFE", "INT64_SIGNED_GHEFCDAB", "INT64_SIGNED_FEHGBADC", "INT64_SIGNED_EFGHABCD",
+    "INT64_UNSIGNED_ABCDEFGH", "INT64_UNSIGNED_HGFEDCBA", "INT64_UNSIGNED_BADCFEHG", "INT64_UNSIGNED_CDABGHEF",
+    "INT64_UNSIGNED_DCBAHGFE", "INT64_UNSIGNED_GHEFCDAB", "INT64_UNSIGNED_FEHGBADC", "INT64_UNSIGNED_EFGHABCD",
+    "IEEE_FLOAT32_ABCD", "IEEE_FLOAT32_CDAB", "IEEE_FLOAT32_DCBA", "IEEE_FLOAT32_BADC",
+    "IEEE_FLOAT64_ABCDEFGH", "IEEE_FLOAT64_HGFEDCBA", "IEEE_FLOAT64_BADCFEHG", "IEEE_FLOAT64_CDABGHEF",
+    "IEEE_FLOAT64_DCBAHGFE", "IEEE_FLOAT64_GHEFCDAB", "IEEE_FLOAT64_FEHGBADC", "IEEE_FLOAT64_EFGHABCD"
+};
+
+/* Get data type name */
+const char* modbus_type_name(modbus_data_type_t data_type)
+{
+    if ((int)data_type < 0 || (size_t)data_type >= sizeof(type_names) / sizeof(type_names[0])) {
+        return "INVALID";
+    }
+    return type_names[data_type];
+}
+
 /* Get error string */
 const char* modbus_conv_get_error_string(int error_code)
 {
@@ -508,6 +602,12 @@ const char* modbus_conv_get_error_string(int error_code)
             return "Insufficient registers for conversion";
         case MODBUS_CONV_ERR_UNKNOWN:
             return "Unknown error";
+        case MODBUS_CONV_ERR_FRAME:
+            return "Malformed Modbus frame";
+        case MODBUS_CONV_ERR_BUFFER:
+            return "Output buffer too small";
+        case MODBUS_CONV_ERR_SYSTEM:
+            return "System call failed (see errno)";
         default:
             return "Unrecognized error code";
     }
@@ -24,6 +24,9 @@ extern "C" {
 #define MODBUS_CONV_ERR_INVALID_BIT    -3
 #define MODBUS_CONV_ERR_INSUFF_REGS    -4
 #define MODBUS_CONV_ERR_UNKNOWN        -5
+#define MODBUS_CONV_ERR_FRAME          -6
+#define MODBUS_CONV_ERR_BUFFER         -7
+#define MODBUS_CONV_ERR_SYSTEM         -8
 
 /* Data type definitions */
 typedef enum {
@@ -226,6 +229,29 @@ int modbus_convert_float64(const uint16_t *registers,
                             double scaling_factor,
                             double *result);
 
+/**
+ * @brief Get number of registers occupied by a data type
+ * @param data_type Data type
+ * @return Register count (1, 2 or 4), 0 for an invalid type
+ */
+size_t modbus_type_reg_count(modbus_data_type_t data_type);
+
+/**
+ * @brief Widen a conversion result to double
+ * @param data_type Data type the value was converted with
+ * @param value Conversion result
+ * @return Value as double, 0.0 for an invalid type or NULL value
+ */
+double modbus_value_to_double(modbus_data_type_t data_type, const modbus_value_t *value);
+
+/**
+ * @brief Get the name of a data type
+ * @param data_type Data type
+ * @return Enumerator name without the MODBUS_ prefix (e.g. "IEEE_FLOAT32_ABCD"),
+ *         "INVALID" for an invalid type
+ */
+const char* modbus_type_name(modbus_data_type_t data_type);
+
 /**
  * @brief Get string description of error code
  * @param error_code Error code from conversion function
@@ -0,0 +1,114 @@
+/**
+ * @file modbus_counter.h
+ * @brief Counter points: wrap and reset handling, deltas and rates
+ * @details Energy and pulse counters are read as unsigned registers that
+ *          wrap at their width or restart from zero when the device resets.
+ *          A counter set turns successive readings of such points into
+ *          increments and per-second rates in engineering units (e.g. kWh and
+ *          kW). A reading below the previous one is taken as a wrap when it
+ *          is plausible, otherwise as a reset:
+ *
+ *          - with max_rate set, a wrap is plausible if the wrapped increment
+ *            does not exceed max_rate over the elapsed time;
+ *          - without it, if the previous reading was in the top quarter of
+ *            the range and the new one is in the bottom quarter.
+ *
+ *          After a reset the increment is the new reading itself. Counter
+ *          points must return raw counts (scaling factor 1.0, no value offset
+ *          or calibration); the counter's own scale converts counts to units.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_COUNTER_H
+#define MODBUS_COUNTER_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Result flags */
+#define MODBUS_COUNTER_WRAPPED          0x01    /* Counter wrapped since the last reading */
+#define MODBUS_COUNTER_RESET            0x02    /* Counter restarted since the last reading */
+#define MODBUS_COUNTER_FIRST            0x04    /* First reading, no increment yet */
+#define MODBUS_COUNTER_INVALID          0x08    /* Reading failed, state kept */
+
+/* Counter point definition */
+typedef struct {
+    uint32_t point;                 /* Point index in the plan */
+    uint8_t width;                  /* Counter width in bits, 0 = width of the data type */
+    double scale;                   /* Units per count, e.g. 0.001 for Wh counted in kWh */
+    double max_rate;                /* Largest plausible counts per second, 0 = unknown */
+} modbus_counter_def_t;
+
+/* Counter set for one plan; arrays in caller storage, one entry per counter */
+typedef struct {
+    const modbus_plan_t *plan;      /* Plan the counters belong to */
+    const modbus_counter_def_t *defs;
+    size_t count;                   /* Number of counters */
+    double ticks_per_second;        /* Timestamp units per second */
+
+    uint64_t *mask;                 /* Wrap mask (2^width - 1) */
+    double *scale;                  /* Units per count */
+    double *max_rate;               /* Plausible counts per second, 0 = unknown */
+    uint64_t *last;                 /* Previous reading */
+    uint64_t *last_timestamp;       /* Time of the previous reading */
+    uint64_t *current;              /* Readings being processed */
+    uint8_t *seen;                  /* A previous reading exists */
+
+    /* Results of the last update */
+    double *delta;                  /* Increment in units */
+    double *rate;                   /* Increment per second in units */
+    uint8_t *flags;                 /* MODBUS_COUNTER_* flags */
+} modbus_counter_set_t;
+
+/**
+ * @brief Storage needed for a counter set
+ * @param count Number of counters
+ * @return Size in bytes for modbus_counter_init()
+ */
+size_t modbus_counter_size(size_t count);
+
+/**
+ * @brief Initialize a counter set
+ * @param set Counter set
+ * @param plan Compiled plan (must outlive the set)
+ * @param defs Counter definitions (must outlive the set)
+ * @param count Number of counters
+ * @param ticks_per_second Timestamp units per second, e.g. 1000 for ms
+ * @param storage Storage of at least modbus_counter_size() bytes, 8-byte aligned
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if a point is out
+ *         of range, not an integer, scaled, offset or calibrated, or the
+ *         width is invalid,
+ *         MODBUS_CONV_ERR_BUFFER if storage is too small
+ */
+int modbus_counter_init(modbus_counter_set_t *set,
+                        const modbus_plan_t *plan,
+                        const modbus_counter_def_t *defs,
+                        size_t count,
+                        double ticks_per_second,
+                        void *storage,
+                        size_t storage_size);
+
+/**
+ * @brief Compute increments and rates from one plan execution
+ * @details Results are in set->delta, set->rate and set->flags.
+ * @param set Counter set
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Reading timestamp
+ * @return MODBUS_CONV_OK on success
+ */
+int modbus_counter_update(modbus_counter_set_t *set,
+                          const modbus_value_t *values,
+                          const int *status,
+                          uint64_t timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_COUNTER_H */
@@ -0,0 +1,387 @@
+/**
+ * @file modbus_delta.c
+ * @brief Binary delta encoding implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_delta.h"
+#include <string.h>
+
+/* Flags byte, device ID, timestamp and entry count varints */
+#define DELTA_MAX_HEADER        (1 + 5 + 10 + 10)
+
+/* Payload classes */
+enum {
+    CLASS_BOOL,
+    CLASS_SIGNED,
+    CLASS_UNSIGNED,
+    CLASS_FLOAT
+};
+
+/* Helper function prototypes */
+static int value_class(modbus_data_type_t data_type);
+static uint64_t load_bits(modbus_data_type_t data_type, const modbus_value_t *value);
+static void store_bits(modbus_data_type_t data_type, uint64_t bits, modbus_value_t *value);
+static size_t put_varint(uint8_t *dst, uint64_t value);
+static bool get_varint(const uint8_t *buf, size_t size, size_t *pos, uint64_t *value);
+static uint64_t zigzag(int64_t value);
+static int64_t unzigzag(uint64_t value);
+
+int modbus_delta_init(modbus_delta_state_t *state,
+                      const modbus_plan_t *plan,
+                      modbus_delta_slot_t *slots,
+                      uint32_t keyframe_interval)
+{
+    if (!state || !plan || (!slots && plan->point_count)) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    memset(state, 0, sizeof(*state));
+    memset(slots, 0, plan->point_count * sizeof(*slots));
+    state->plan = plan;
+    state->slots = slots;
+    state->keyframe_interval = keyframe_interval;
+    return MODBUS_CONV_OK;
+}
+
+void modbus_delta_keyframe(modbus_delta_state_t *state)
+{
+    if (state) {
+        state->synced = false;
+    }
+}
+
+int modbus_delta_encode(modbus_delta_state_t *state,
+                        uint8_t *buf,
+                        size_t size,
+                        size_t *len,
+                        const modbus_value_t *values,
+                        const int *status,
+                        uint64_t timestamp)
+{
+    const modbus_point_t *points;
+    uint8_t header[DELTA_MAX_HEADER];
+    size_t header_len = 0;
+    size_t pos = DELTA_MAX_HEADER;
+    size_t count = 0, next = 0;
+    bool keyframe;
+    size_t i;
+
+    if (!state || !buf || !len || !values) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (size < DELTA_MAX_HEADER) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    keyframe = !state->synced || (state->keyframe_interval && state->countdown <= 1);
+    points = state->plan->points;
+
+    /* Entries go after room for the header, which needs the entry count */
+    for (i = 0; i < state->plan->point_count; i++) {
+        const modbus_delta_slot_t *slot = &state->slots[i];
+        modbus_data_type_t type = points[i].data_type;
+        bool ok = !status || status[i] == MODBUS_CONV_OK;
+        bool was_valid = !keyframe && slot->valid;
+        uint64_t old_bits = keyframe ? 0 : load_bits(type, &slot->value);
+        uint64_t bits, payload = 0;
+        unsigned aux = 0;
+        bool has_payload = false;
+
+        if (!ok) {
+            if (!was_valid) {
+                continue;
+            }
+        } else {
+            bits = load_bits(type, &values[i]);
+            if (was_valid && bits == old_bits) {
+                continue;
+            }
+            switch (value_class(type)) {
+                case CLASS_BOOL:
+                    aux = bits ? 1 : 0;
+                    break;
+                case CLASS_FLOAT:
+                    /* XOR of neighbouring floats mostly has zero low bytes */
+                    payload = bits ^ old_bits;
+                    while (payload && aux < 7 && !(payload & 0xFF)) {
+                        payload >>= 8;
+                        aux++;
+                    }
+                    has_payload = true;
+                    break;
+                default:
+                    payload = zigzag((int64_t)(bits - old_bits));
+                    has_payload = true;
+                    break;
+            }
+        }
+
+        if (size - pos < MODBUS_DELTA_MAX_ENTRY) {
+            return MODBUS_CONV_ERR_BUFFER;
+        }
+        pos += put_varint(buf + pos, ((uint64_t)(i - next) << 4) | (aux << 1) | (ok ? 0u : 1u));
+        if (has_payload) {
+            pos += put_varint(buf + pos, payload);
+        }
+        next = i + 1;
+        count++;
+    }
+
+    header[header_len++] = MODBUS_DELTA_VERSION | (keyframe ? MODBUS_DELTA_KEYFRAME : 0);
+    header_len += put_varint(header + header_len, state->plan->device_id);
+    if (keyframe) {
+        header_len += put_varint(header + header_len, timestamp);
+    } else {
+        header_len += put_varint(header + header_len, zigzag((int64_t)(timestamp - state->timestamp)));
+    }
+    header_len += put_varint(header + header_len, count);
+
+    memmove(buf + header_len, buf + DELTA_MAX_HEADER, pos - DELTA_MAX_HEADER);
+    memcpy(buf, header, header_len);
+    *len = header_len + pos - DELTA_MAX_HEADER;
+
+    /* Commit the new state, mirroring what the decoder will hold */
+    for (i = 0; i < state->plan->point_count; i++) {
+        modbus_delta_slot_t *slot = &state->slots[i];
+        if (!status || status[i] == MODBUS_CONV_OK) {
+            slot->value = values[i];
+            slot->valid = 1;
+        } else {
+            if (keyframe) {
+                memset(&slot->value, 0, sizeof(slot->value));
+            }
+            slot->valid = 0;
+        }
+    }
+    state->countdown = keyframe ? state->keyframe_interval : state->countdown - 1;
+    state->timestamp = timestamp;
+    state->synced = true;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_delta_decode(modbus_delta_state_t *state,
+                        const uint8_t *buf,
+                        size_t size,
+                        size_t *consumed,
+                        uint32_t *changed,
+                        size_t max_changed,
+                        size_t *changed_count)
+{
+    const modbus_point_t *points;
+    uint64_t device, stamp, count, entry, payload;
+    size_t pos = 1, next = 0;
+    bool keyframe;
+    uint64_t n;
+
+    if (!state || !buf) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    if (size < 1 || (buf[0] & 0xF0) != MODBUS_DELTA_VERSION) {
+        goto malformed;
+    }
+    keyframe = (buf[0] & MODBUS_DELTA_KEYFRAME) != 0;
+    if (!get_varint(buf, size, &pos, &device) || !get_varint(buf, size, &pos, &stamp) ||
+        !get_varint(buf, size, &pos, &count)) {
+        goto malformed;
+    }
+    if (device != state->plan->device_id || count > state->plan->point_count ||
+        (!keyframe && !state->synced)) {
+        goto malformed;
+    }
+
+    if (keyframe) {
+        memset(state->slots, 0, state->plan->point_count * sizeof(*state->slots));
+        state->timestamp = stamp;
+    } else {
+        state->timestamp += (uint64_t)unzigzag(stamp);
+    }
+
+    points = state->plan->points;
+    for (n = 0; n < count; n++) {
+        modbus_delta_slot_t *slot;
+        modbus_data_type_t type;
+        unsigned aux;
+        uint64_t bits;
+        size_t index;
+
+        if (!get_varint(buf, size, &pos, &entry) ||
+            (entry >> 4) >= state->plan->point_count - next) {
+            goto malformed;
+        }
+        index = next + (size_t)(entry >> 4);
+        aux = (unsigned)(entry >> 1) & 7;
+        slot = &state->slots[index];
+        type = points[index].data_type;
+
+        if (entry & 1) {
+            slot->valid = 0;
+        } else {
+            bits = load_bits(type, &slot->value);
+            switch (value_class(type)) {
+                case CLASS_BOOL:
+                    bits = aux & 1;
+                    break;
+                case CLASS_FLOAT:
+                    if (!get_varint(buf, size, &pos, &payload)) {
+                        goto malformed;
+                    }
+                    bits ^= payload << (8 * aux);
+                    break;
+                default:
+                    if (!get_varint(buf, size, &pos, &payload)) {
+                        goto malformed;
+                    }
+                    bits += (uint64_t)unzigzag(payload);
+                    break;
+            }
+            store_bits(type, bits, &slot->value);
+            slot->valid = 1;
+        }
+
+        if (changed && n < max_changed) {
+            changed[n] = (uint32_t)index;
+        }
+        next = index + 1;
+    }
+
+    state->synced = true;
+    if (consumed) {
+        *consumed = pos;
+    }
+    if (changed_count) {
+        *changed_count = (size_t)count;
+    }
+    return MODBUS_CONV_OK;
+
+malformed:
+    /* Partially applied frames leave the table unusable until a keyframe */
+    state->synced = false;
+    return MODBUS_CONV_ERR_FRAME;
+}
+
+/* Helper function implementations */
+static int value_class(modbus_data_type_t data_type)
+{
+    switch (data_type) {
+        case MODBUS_BIT_BOOLEAN:
+            return CLASS_BOOL;
+        case MODBUS_INT8_SIGNED:
+        case MODBUS_INT16_SIGNED_AB:
+        case MODBUS_INT16_SIGNED_BA:
+            return CLASS_SIGNED;
+        case MODBUS_INT8_UNSIGNED:
+        case MODBUS_INT16_UNSIGNED_AB:
+        case MODBUS_INT16_UNSIGNED_BA:
+            return CLASS_UNSIGNED;
+        default:
+            break;
+    }
+
+    if (data_type <= MODBUS_INT32_SIGNED_CDAB) {
+        return CLASS_SIGNED;
+    }
+    if (data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        return CLASS_UNSIGNED;
+    }
+    if (data_type <= MODBUS_INT64_SIGNED_EFGHABCD) {
+        return CLASS_SIGNED;
+    }
+    if (data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        return CLASS_UNSIGNED;
+    }
+    return CLASS_FLOAT;
+}
+
+/* Value as 64 bits: integers widened, floats by bit pattern */
+static uint64_t load_bits(modbus_data_type_t data_type, const modbus_value_t *value)
+{
+    switch (modbus_type_reg_count(data_type)) {
+        case 1:
+            switch (data_type) {
+                case MODBUS_BIT_BOOLEAN:
+                    return value->bool_val ? 1 : 0;
+                case MODBUS_INT8_SIGNED:
+                    return (uint64_t)(int64_t)value->i8;
+                case MODBUS_INT8_UNSIGNED:
+                    return value->u8;
+                case MODBUS_INT16_SIGNED_AB:
+                case MODBUS_INT16_SIGNED_BA:
+                    return (uint64_t)(int64_t)value->i16;
+                default:
+                    return value->u16;
+            }
+        case 2:
+            if (value_class(data_type) == CLASS_SIGNED) {
+                return (uint64_t)(int64_t)value->i32;
+            }
+            return value->u32;
+        default:
+            return value->u64;
+    }
+}
+
+static void store_bits(modbus_data_type_t data_type, uint64_t bits, modbus_value_t *value)
+{
+    switch (modbus_type_reg_count(data_type)) {
+        case 1:
+            switch (data_type) {
+                case MODBUS_BIT_BOOLEAN:
+                    value->bool_val = bits != 0;
+                    break;
+                case MODBUS_INT8_SIGNED:
+                case MODBUS_INT8_UNSIGNED:
+                    value->u8 = (uint8_t)bits;
+                    break;
+                default:
+                    value->u16 = (uint16_t)bits;
+                    break;
+            }
+            break;
+        case 2:
+            value->u32 = (uint32_t)bits;
+            break;
+        default:
+            value->u64 = bits;
+            break;
+    }
+}
+
+static size_t put_varint(uint8_t *dst, uint64_t value)
+{
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        dst[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    dst[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool get_varint(const uint8_t *buf, size_t size, size_t *pos, uint64_t *value)
+{
+    uint64_t result = 0;
+    unsigned shift;
+
+    for (shift = 0; shift < 64 && *pos < size; shift += 7) {
+        uint8_t byte = buf[(*pos)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
@@ -0,0 +1,120 @@
+/**
+ * @file modbus_delta.h
+ * @brief Compact binary delta encoding of value updates
+ * @details Encoder and decoder keep the same per-point state (last value and
+ *          quality). Each encoded frame carries only the points whose value or
+ *          quality changed since the previous frame, found by comparing the
+ *          plan results against that state:
+ *
+ *          frame  := flags device_id zigzag(timestamp delta) count entry*
+ *          entry  := varint(gap << 4 | aux << 1 | invalid) payload
+ *
+ *          gap is the number of skipped point indices. Integers carry the
+ *          zigzag varint of the difference to the last value, floats the XOR
+ *          of their bit patterns with trailing zero bytes dropped (count in
+ *          aux), booleans their value in aux and no payload. Keyframes reset
+ *          the state and list every valid point. All varints are LEB128.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_DELTA_H
+#define MODBUS_DELTA_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Frame flags */
+#define MODBUS_DELTA_VERSION            0x10
+#define MODBUS_DELTA_KEYFRAME           0x01
+
+/* Largest encoded entry (header and payload varints) */
+#define MODBUS_DELTA_MAX_ENTRY          20
+
+/* Last known state of one point */
+typedef struct {
+    modbus_value_t value;           /* Last valid value */
+    uint8_t valid;                  /* Last conversion succeeded */
+} modbus_delta_slot_t;
+
+/* Encoder or decoder state for one plan */
+typedef struct {
+    const modbus_plan_t *plan;      /* Plan shared by both sides */
+    modbus_delta_slot_t *slots;     /* One slot per point (caller storage) */
+    uint64_t timestamp;             /* Timestamp of the last frame */
+    uint32_t keyframe_interval;     /* Encoder: frames between keyframes, 0 = first only */
+    uint32_t countdown;             /* Encoder: frames until the next keyframe */
+    bool synced;                    /* Encoder: keyframe sent; decoder: keyframe received */
+} modbus_delta_state_t;
+
+/**
+ * @brief Initialize encoder or decoder state
+ * @param state State to initialize
+ * @param plan Compiled plan (must outlive the state)
+ * @param slots Array of plan->point_count slots
+ * @param keyframe_interval Encoder: emit a keyframe every N frames (0 = only the first)
+ * @return MODBUS_CONV_OK on success
+ */
+int modbus_delta_init(modbus_delta_state_t *state,
+                      const modbus_plan_t *plan,
+                      modbus_delta_slot_t *slots,
+                      uint32_t keyframe_interval);
+
+/**
+ * @brief Make the next encoded frame a keyframe (e.g. for a new subscriber)
+ * @param state Encoder state
+ */
+void modbus_delta_keyframe(modbus_delta_state_t *state);
+
+/**
+ * @brief Encode the changes of one plan execution
+ * @param state Encoder state, updated on success
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ * @param len Pointer to store the frame length
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Frame timestamp
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf is too small
+ *         (state unchanged)
+ */
+int modbus_delta_encode(modbus_delta_state_t *state,
+                        uint8_t *buf,
+                        size_t size,
+                        size_t *len,
+                        const modbus_value_t *values,
+                        const int *status,
+                        uint64_t timestamp);
+
+/**
+ * @brief Decode one frame and apply it to the state
+ * @details The current value and quality of every point are read from
+ *          state->slots afterwards. Delta frames received before a keyframe,
+ *          or after a malformed frame, are rejected until the next keyframe.
+ * @param state Decoder state
+ * @param buf Encoded data
+ * @param size Bytes available in buf
+ * @param consumed Pointer to store the frame length, may be NULL
+ * @param changed Array receiving the indices of changed points, may be NULL
+ * @param max_changed Size of the changed array
+ * @param changed_count Pointer to store the number of changed points, may be NULL
+ *        (may exceed max_changed, only the first max_changed are stored)
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_FRAME if the frame is
+ *         malformed, belongs to another device or the decoder is not synced
+ */
+int modbus_delta_decode(modbus_delta_state_t *state,
+                        const uint8_t *buf,
+                        size_t size,
+                        size_t *consumed,
+                        uint32_t *changed,
+                        size_t max_changed,
+                        size_t *changed_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_DELTA_H */
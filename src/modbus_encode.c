@@ -0,0 +1,465 @@
+/**
+ * @file modbus_encode.c
+ * @brief Value to register encoding implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_encode.h"
+#include "modbus_frame.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+/* FC16 request header: function code, address, quantity, byte count */
+#define FC16_HEADER             6
+
+/*
+ * Wire position of each value byte, most significant first, mirroring the
+ * register reordering of the decoders in modbus_conversion.c.
+ */
+static const uint8_t byte_order[MODBUS_IEEE_FLOAT64_EFGHABCD + 1][8] = {
+    [MODBUS_INT8_SIGNED]              = { 0, 1 },
+    [MODBUS_INT8_UNSIGNED]            = { 0, 1 },
+    [MODBUS_INT16_SIGNED_AB]          = { 0, 1 },
+    [MODBUS_INT16_SIGNED_BA]          = { 1, 0 },
+    [MODBUS_INT16_UNSIGNED_AB]        = { 0, 1 },
+    [MODBUS_INT16_UNSIGNED_BA]        = { 1, 0 },
+    [MODBUS_INT32_SIGNED_ABCD]        = { 0, 1, 2, 3 },
+    [MODBUS_INT32_SIGNED_DCBA]        = { 1, 0, 3, 2 },
+    [MODBUS_INT32_SIGNED_BADC]        = { 1, 0, 3, 2 },
+    [MODBUS_INT32_SIGNED_CDAB]        = { 2, 3, 0, 1 },
+    [MODBUS_INT32_UNSIGNED_ABCD]      = { 0, 1, 2, 3 },
+    [MODBUS_INT32_UNSIGNED_DCBA]      = { 1, 0, 3, 2 },
+    [MODBUS_INT32_UNSIGNED_BADC]      = { 1, 0, 3, 2 },
+    [MODBUS_INT32_UNSIGNED_CDAB]      = { 2, 3, 0, 1 },
+    [MODBUS_INT64_SIGNED_ABCDEFGH]    = { 0, 1, 2, 3, 4, 5, 6, 7 },
+    [MODBUS_INT64_SIGNED_HGFEDCBA]    = { 1, 0, 3, 2, 5, 4, 7, 6 },
+    [MODBUS_INT64_SIGNED_BADCFEHG]    = { 1, 0, 3, 2, 5, 4, 7, 6 },
+    [MODBUS_INT64_SIGNED_CDABGHEF]    = { 2, 3, 0, 1, 6, 7, 4, 5 },
+    [MODBUS_INT64_SIGNED_DCBAHGFE]    = { 0, 1, 2, 3, 4, 5, 6, 7 },
+    [MODBUS_INT64_SIGNED_GHEFCDAB]    = { 1, 0, 3, 2, 5, 4, 7, 6 },
+    [MODBUS_INT64_SIGNED_FEHGBADC]    = { 3, 2, 1, 0, 7, 6, 5, 4 },
+    [MODBUS_INT64_SIGNED_EFGHABCD]    = { 2, 3, 0, 1, 6, 7, 4, 5 },
+    [MODBUS_INT64_UNSIGNED_ABCDEFGH]  = { 0, 1, 2, 3, 4, 5, 6, 7 },
+    [MODBUS_INT64_UNSIGNED_HGFEDCBA]  = { 1, 0, 3, 2, 5, 4, 7, 6 },
+    [MODBUS_INT64_UNSIGNED_BADCFEHG]  = { 1, 0, 3, 2, 5, 4, 7, 6 },
+    [MODBUS_INT64_UNSIGNED_CDABGHEF]  = { 2, 3, 0, 1, 6, 7, 4, 5 },
+    [MODBUS_INT64_UNSIGNED_DCBAHGFE]  = { 0, 1, 2, 3, 4, 5, 6, 7 },
+    [MODBUS_INT64_UNSIGNED_GHEFCDAB]  = { 1, 0, 3, 2, 5, 4, 7, 6 },
+    [MODBUS_INT64_UNSIGNED_FEHGBADC]  = { 3, 2, 1, 0, 7, 6, 5, 4 },
+    [MODBUS_INT64_UNSIGNED_EFGHABCD]  = { 2, 3, 0, 1, 6, 7, 4, 5 },
+    [MODBUS_IEEE_FLOAT32_ABCD]        = { 0, 1, 2, 3 },
+    [MODBUS_IEEE_FLOAT32_CDAB]        = { 2, 3, 0, 1 },
+    [MODBUS_IEEE_FLOAT32_DCBA]        = { 1, 0, 3, 2 },
+    [MODBUS_IEEE_FLOAT32_BADC]        = { 1, 0, 3, 2 },
+    [MODBUS_IEEE_FLOAT64_ABCDEFGH]    = { 0, 1, 2, 3, 4, 5, 6, 7 },
+    [MODBUS_IEEE_FLOAT64_HGFEDCBA]    = { 1, 0, 3, 2, 5, 4, 7, 6 },
+    [MODBUS_IEEE_FLOAT64_BADCFEHG]    = { 1, 0, 3, 2, 5, 4, 7, 6 },
+    [MODBUS_IEEE_FLOAT64_CDABGHEF]    = { 2, 3, 0, 1, 6, 7, 4, 5 },
+    [MODBUS_IEEE_FLOAT64_DCBAHGFE]    = { 0, 1, 2, 3, 4, 5, 6, 7 },
+    [MODBUS_IEEE_FLOAT64_GHEFCDAB]    = { 1, 0, 3, 2, 5, 4, 7, 6 },
+    [MODBUS_IEEE_FLOAT64_FEHGBADC]    = { 3, 2, 1, 0, 7, 6, 5, 4 },
+    [MODBUS_IEEE_FLOAT64_EFGHABCD]    = { 2, 3, 0, 1, 6, 7, 4, 5 },
+};
+
+/* Helper function prototypes */
+static int check_type(modbus_data_type_t data_type, uint8_t bit_pos, double scaling_factor);
+static uint64_t raw_bits(modbus_data_type_t data_type, double raw, bool *saturated);
+static uint64_t value_bits(modbus_data_type_t data_type, const modbus_value_t *value);
+static int64_t saturate_signed(double raw, unsigned bits, bool *saturated);
+static uint64_t saturate_unsigned(double raw, unsigned bits, bool *saturated);
+static void store_wire(modbus_data_type_t data_type, uint64_t bits, uint8_t *wire);
+static void store_registers(modbus_data_type_t data_type, uint64_t bits, uint16_t *registers);
+static int encode_point(const modbus_point_t *point, double value, uint8_t *wire);
+
+int modbus_encode(double value,
+                  modbus_data_type_t data_type,
+                  uint8_t bit_pos,
+                  double scaling_factor,
+                  uint16_t *registers,
+                  size_t reg_count,
+                  bool *saturated)
+{
+    bool sat = false;
+    int rc;
+
+    if (!registers) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    rc = check_type(data_type, bit_pos, scaling_factor);
+    if (rc != MODBUS_CONV_OK) {
+        return rc;
+    }
+    if (reg_count < modbus_type_reg_count(data_type)) {
+        return MODBUS_CONV_ERR_INSUFF_REGS;
+    }
+
+    if (data_type == MODBUS_BIT_BOOLEAN) {
+        uint16_t mask = (uint16_t)(1u << bit_pos);
+        registers[0] = value != 0.0 ? (uint16_t)(registers[0] | mask) : (uint16_t)(registers[0] & ~mask);
+    } else {
+        store_registers(data_type, raw_bits(data_type, value / scaling_factor, &sat), registers);
+    }
+    if (saturated) {
+        *saturated = sat;
+    }
+    return MODBUS_CONV_OK;
+}
+
+int modbus_encode_value(const modbus_value_t *value,
+                        modbus_data_type_t data_type,
+                        uint8_t bit_pos,
+                        uint16_t *registers,
+                        size_t reg_count)
+{
+    int rc;
+
+    if (!value || !registers) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    rc = check_type(data_type, bit_pos, 1.0);
+    if (rc != MODBUS_CONV_OK) {
+        return rc;
+    }
+    if (reg_count < modbus_type_reg_count(data_type)) {
+        return MODBUS_CONV_ERR_INSUFF_REGS;
+    }
+
+    if (data_type == MODBUS_BIT_BOOLEAN) {
+        uint16_t mask = (uint16_t)(1u << bit_pos);
+        registers[0] = value->bool_val ? (uint16_t)(registers[0] | mask) : (uint16_t)(registers[0] & ~mask);
+    } else {
+        store_registers(data_type, value_bits(data_type, value), registers);
+    }
+    return MODBUS_CONV_OK;
+}
+
+int modbus_encode_array(const double *values,
+                        size_t count,
+                        modbus_data_type_t data_type,
+                        double scaling_factor,
+                        uint16_t *registers,
+                        size_t reg_count,
+                        size_t *saturated)
+{
+    size_t width;
+    size_t clamped = 0;
+    size_t i;
+    int rc;
+
+    if ((!values || !registers) && count > 0) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (data_type == MODBUS_BIT_BOOLEAN) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    rc = check_type(data_type, 0, scaling_factor);
+    if (rc != MODBUS_CONV_OK) {
+        return rc;
+    }
+    width = modbus_type_reg_count(data_type);
+    if (reg_count / width < count) {
+        return MODBUS_CONV_ERR_INSUFF_REGS;
+    }
+
+    /* 16-bit AB types: round, clamp and narrow in one loop of selects that
+     * gcc vectorizes. Adding just under 0.5 away from zero and truncating is
+     * round() for the values that survive the clamp, without a libm call. */
+    if (data_type == MODBUS_INT16_SIGNED_AB || data_type == MODBUS_INT16_UNSIGNED_AB) {
+        double lo = data_type == MODBUS_INT16_SIGNED_AB ? -32768.0 : 0.0;
+        double hi = data_type == MODBUS_INT16_SIGNED_AB ? 32767.0 : 65535.0;
+
+        for (i = 0; i < count; i++) {
+            double v = values[i] / scaling_factor;
+            double r = v + (v < 0.0 ? -0.49999999999999994 : 0.49999999999999994);
+            double c = r < lo ? lo : r;
+
+            c = c > hi ? hi : c;
+            c = v == v ? c : 0.0;
+            clamped += (r <= lo - 1.0) | (r >= hi + 1.0) | (v != v);
+            registers[i] = (uint16_t)(int32_t)c;
+        }
+    } else {
+        for (i = 0; i < count; i++) {
+            bool sat = false;
+
+            store_registers(data_type, raw_bits(data_type, values[i] / scaling_factor, &sat),
+                            registers + i * width);
+            clamped += sat;
+        }
+    }
+    if (saturated) {
+        *saturated = clamped;
+    }
+    return MODBUS_CONV_OK;
+}
+
+int modbus_encode_plan(const modbus_plan_t *plan,
+                       const double *values,
+                       uint16_t *registers,
+                       size_t reg_count,
+                       int *status)
+{
+    int first_error = MODBUS_CONV_OK;
+    size_t i;
+
+    if (!plan || !values || !registers) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (reg_count < plan->reg_span) {
+        return MODBUS_CONV_ERR_INSUFF_REGS;
+    }
+
+    for (i = 0; i < plan->point_count; i++) {
+        const modbus_point_t *p = &plan->points[i];
+        uint16_t *regs = registers + p->offset;
+        uint8_t wire[8];
+        size_t width = modbus_type_reg_count(p->data_type);
+        size_t k;
+        int rc;
+
+        /* Boolean points modify one bit of the current register content */
+        for (k = 0; k < width; k++) {
+            wire[2 * k] = (uint8_t)(regs[k] >> 8);
+            wire[2 * k + 1] = (uint8_t)regs[k];
+        }
+        rc = encode_point(p, values[i], wire);
+        if (rc == MODBUS_CONV_OK) {
+            for (k = 0; k < width; k++) {
+                regs[k] = (uint16_t)((wire[2 * k] << 8) | wire[2 * k + 1]);
+            }
+        } else if (first_error == MODBUS_CONV_OK) {
+            first_error = rc;
+        }
+        if (status) {
+            status[i] = rc;
+        }
+    }
+    return first_error;
+}
+
+int modbus_encode_plan_fc16(const modbus_plan_t *plan,
+                            const double *values,
+                            uint16_t start_address,
+                            uint8_t *pdu,
+                            size_t pdu_size,
+                            size_t *pdu_len,
+                            int *status)
+{
+    int first_error = MODBUS_CONV_OK;
+    size_t span;
+    size_t i;
+
+    if (!plan || !values || !pdu || !pdu_len) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    span = plan->reg_span;
+    if (span == 0 || span > MODBUS_FRAME_MAX_WRITE_REGS) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    if (pdu_size < FC16_HEADER + 2 * span) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    pdu[0] = MODBUS_FC_WRITE_MULTIPLE_REGISTERS;
+    pdu[1] = (uint8_t)(start_address >> 8);
+    pdu[2] = (uint8_t)start_address;
+    pdu[3] = (uint8_t)(span >> 8);
+    pdu[4] = (uint8_t)span;
+    pdu[5] = (uint8_t)(2 * span);
+    memset(pdu + FC16_HEADER, 0, 2 * span);
+
+    /* The payload is big-endian registers, so points encode in place */
+    for (i = 0; i < plan->point_count; i++) {
+        const modbus_point_t *p = &plan->points[i];
+        int rc = encode_point(p, values[i], pdu + FC16_HEADER + 2 * (size_t)p->offset);
+
+        if (rc != MODBUS_CONV_OK && first_error == MODBUS_CONV_OK) {
+            first_error = rc;
+        }
+        if (status) {
+            status[i] = rc;
+        }
+    }
+    *pdu_len = FC16_HEADER + 2 * span;
+    return first_error;
+}
+
+/* Helper function implementations */
+static int check_type(modbus_data_type_t data_type, uint8_t bit_pos, double scaling_factor)
+{
+    if (modbus_type_reg_count(data_type) == 0) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    if (data_type == MODBUS_BIT_BOOLEAN) {
+        return bit_pos > 15 ? MODBUS_CONV_ERR_INVALID_BIT : MODBUS_CONV_OK;
+    }
+    /* A zero or non-finite scale has no inverse */
+    if (scaling_factor == 0.0 || scaling_factor - scaling_factor != 0.0) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    return MODBUS_CONV_OK;
+}
+
+/* Round, saturate and reinterpret an unscaled value as the bits of the type */
+static uint64_t raw_bits(modbus_data_type_t data_type, double raw, bool *saturated)
+{
+    float f;
+    uint32_t u32;
+    uint64_t u64;
+
+    switch (data_type) {
+        case MODBUS_INT8_SIGNED:
+            return (uint8_t)saturate_signed(raw, 8, saturated);
+        case MODBUS_INT8_UNSIGNED:
+            return saturate_unsigned(raw, 8, saturated);
+        case MODBUS_INT16_SIGNED_AB:
+        case MODBUS_INT16_SIGNED_BA:
+            return (uint16_t)saturate_signed(raw, 16, saturated);
+        case MODBUS_INT16_UNSIGNED_AB:
+        case MODBUS_INT16_UNSIGNED_BA:
+            return saturate_unsigned(raw, 16, saturated);
+        default:
+            break;
+    }
+    if (data_type <= MODBUS_INT32_SIGNED_CDAB) {
+        return (uint32_t)saturate_signed(raw, 32, saturated);
+    }
+    if (data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        return saturate_unsigned(raw, 32, saturated);
+    }
+    if (data_type <= MODBUS_INT64_SIGNED_EFGHABCD) {
+        return (uint64_t)saturate_signed(raw, 64, saturated);
+    }
+    if (data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        return saturate_unsigned(raw, 64, saturated);
+    }
+    if (data_type <= MODBUS_IEEE_FLOAT32_BADC) {
+        if (raw > FLT_MAX || raw < -FLT_MAX) {
+            raw = raw > 0.0 ? FLT_MAX : -FLT_MAX;
+            *saturated = true;
+        }
+        f = (float)raw;
+        memcpy(&u32, &f, sizeof(u32));
+        return u32;
+    }
+    memcpy(&u64, &raw, sizeof(u64));
+    return u64;
+}
+
+static uint64_t value_bits(modbus_data_type_t data_type, const modbus_value_t *value)
+{
+    uint32_t u32;
+
+    switch (data_type) {
+        case MODBUS_INT8_SIGNED:
+        case MODBUS_INT8_UNSIGNED:
+            return value->u8;
+        case MODBUS_INT16_SIGNED_AB:
+        case MODBUS_INT16_SIGNED_BA:
+        case MODBUS_INT16_UNSIGNED_AB:
+        case MODBUS_INT16_UNSIGNED_BA:
+            return value->u16;
+        default:
+            break;
+    }
+    if (data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        return value->u32;
+    }
+    if (data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        return value->u64;
+    }
+    if (data_type <= MODBUS_IEEE_FLOAT32_BADC) {
+        memcpy(&u32, &value->f32, sizeof(u32));
+        return u32;
+    }
+    return value->u64;
+}
+
+/* Nearest integer in [-2^(bits-1), 2^(bits-1) - 1]; NaN encodes as 0 */
+static int64_t saturate_signed(double raw, unsigned bits, bool *saturated)
+{
+    double limit = ldexp(1.0, (int)bits - 1);
+    double r = round(raw);
+
+    if (r != r) {
+        *saturated = true;
+        return 0;
+    }
+    if (r < -limit) {
+        *saturated = true;
+        return -(int64_t)(((uint64_t)1 << (bits - 1)) - 1) - 1;
+    }
+    if (r >= limit) {
+        *saturated = true;
+        return (int64_t)(((uint64_t)1 << (bits - 1)) - 1);
+    }
+    return (int64_t)r;
+}
+
+/* Nearest integer in [0, 2^bits - 1]; NaN encodes as 0 */
+static uint64_t saturate_unsigned(double raw, unsigned bits, bool *saturated)
+{
+    double r = round(raw);
+
+    if (r != r || r < 0.0) {
+        *saturated = true;
+        return 0;
+    }
+    if (r >= ldexp(1.0, (int)bits)) {
+        *saturated = true;
+        return bits >= 64 ? UINT64_MAX : ((uint64_t)1 << bits) - 1;
+    }
+    return (uint64_t)r;
+}
+
+/* Value bytes, most significant first, to their wire positions */
+static void store_wire(modbus_data_type_t data_type, uint64_t bits, uint8_t *wire)
+{
+    const uint8_t *order = byte_order[data_type];
+    size_t n = 2 * modbus_type_reg_count(data_type);
+    size_t k;
+
+    for (k = 0; k < n; k++) {
+        wire[order[k]] = (uint8_t)(bits >> (8 * (n - 1 - k)));
+    }
+}
+
+static void store_registers(modbus_data_type_t data_type, uint64_t bits, uint16_t *registers)
+{
+    uint8_t wire[8];
+    size_t n = modbus_type_reg_count(data_type);
+    size_t k;
+
+    store_wire(data_type, bits, wire);
+    for (k = 0; k < n; k++) {
+        registers[k] = (uint16_t)((wire[2 * k] << 8) | wire[2 * k + 1]);
+    }
+}
+
+/* Encode one plan point into big-endian register bytes */
+static int encode_point(const modbus_point_t *point, double value, uint8_t *wire)
+{
+    bool sat = false;
+    int rc;
+
+    if (point->calib) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    rc = check_type(point->data_type, point->bit_pos, point->scaling_factor);
+    if (rc != MODBUS_CONV_OK) {
+        return rc;
+    }
+
+    if (point->data_type == MODBUS_BIT_BOOLEAN) {
+        uint8_t *byte = &wire[point->bit_pos < 8 ? 1 : 0];
+        uint8_t mask = (uint8_t)(1u << (point->bit_pos & 7));
+
+        *byte = value != 0.0 ? (uint8_t)(*byte | mask) : (uint8_t)(*byte & ~mask);
+        return MODBUS_CONV_OK;
+    }
+    store_wire(point->data_type,
+               raw_bits(point->data_type, (value - point->value_offset) / point->scaling_factor, &sat),
+               wire);
+    return MODBUS_CONV_OK;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file modbus_encode.h
+ * @brief Value to register encoding for writes
+ * @details The inverse of modbus_convert(): engineering values are divided by
+ *          the scaling factor, rounded to the nearest integer for integer
+ *          types, saturated to the range of the data type and laid out in
+ *          the byte order of the data type, so that decoding the registers
+ *          returns the value. Encoders exist for single values, arrays of one
+ *          type, whole plans, and plans straight into an FC16 (write multiple
+ *          registers) request PDU.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_ENCODE_H
+#define MODBUS_ENCODE_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Encode one engineering value into registers
+ * @details A MODBUS_BIT_BOOLEAN value sets or clears bit_pos of registers[0]
+ *          (non-zero is true) and keeps the other bits.
+ * @param value Engineering value
+ * @param data_type Target data type
+ * @param bit_pos Bit position for MODBUS_BIT_BOOLEAN
+ * @param scaling_factor Scaling factor of the point (value = raw * scaling_factor)
+ * @param registers Array receiving the registers
+ * @param reg_count Capacity of the register array
+ * @param saturated Set to true if the value was clamped to the type range, may be NULL
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE for an invalid
+ *         type or a zero scaling factor, MODBUS_CONV_ERR_INVALID_BIT for a bad bit
+ *         position, MODBUS_CONV_ERR_INSUFF_REGS if reg_count is too small
+ */
+int modbus_encode(double value,
+                  modbus_data_type_t data_type,
+                  uint8_t bit_pos,
+                  double scaling_factor,
+                  uint16_t *registers,
+                  size_t reg_count,
+                  bool *saturated);
+
+/**
+ * @brief Encode a raw typed value into registers, without scaling
+ * @details Exact for 64-bit integers, which doubles cannot all represent.
+ * @param value Value in the union member of data_type
+ * @param data_type Target data type
+ * @param bit_pos Bit position for MODBUS_BIT_BOOLEAN
+ * @param registers Array receiving the registers
+ * @param reg_count Capacity of the register array
+ * @return MODBUS_CONV_OK on success, error code as for modbus_encode()
+ */
+int modbus_encode_value(const modbus_value_t *value,
+                        modbus_data_type_t data_type,
+                        uint8_t bit_pos,
+                        uint16_t *registers,
+                        size_t reg_count);
+
+/**
+ * @brief Encode an array of values of one type into consecutive registers
+ * @param values Engineering values
+ * @param count Number of values
+ * @param data_type Data type of every value (not MODBUS_BIT_BOOLEAN)
+ * @param scaling_factor Scaling factor of every value
+ * @param registers Array receiving count * modbus_type_reg_count(data_type) registers
+ * @param reg_count Capacity of the register array
+ * @param saturated Pointer to store the number of clamped values, may be NULL
+ * @return MODBUS_CONV_OK on success, error code as for modbus_encode()
+ */
+int modbus_encode_array(const double *values,
+                        size_t count,
+                        modbus_data_type_t data_type,
+                        double scaling_factor,
+                        uint16_t *registers,
+                        size_t reg_count,
+                        size_t *saturated);
+
+/**
+ * @brief Encode one engineering value per plan point into a register block
+ * @details Inverts scaling_factor and value_offset. Calibrated points cannot
+ *          be inverted and fail with MODBUS_CONV_ERR_INVALID_TYPE. Registers
+ *          not covered by a point are left as they are.
+ * @param plan Compiled plan
+ * @param values Engineering values, one per point
+ * @param registers Register block
+ * @param reg_count Number of registers in the block (at least plan->reg_span)
+ * @param status Array receiving one status per point, may be NULL
+ * @return MODBUS_CONV_OK if all points encoded, first point error code otherwise
+ */
+int modbus_encode_plan(const modbus_plan_t *plan,
+                       const double *values,
+                       uint16_t *registers,
+                       size_t reg_count,
+                       int *status);
+
+/**
+ * @brief Encode a plan straight into an FC16 request PDU
+ * @details Writes the request header for plan->reg_span registers starting at
+ *          start_address and encodes every point into the payload bytes;
+ *          registers not covered by a point are written as 0.
+ * @param plan Compiled plan (reg_span of 1 to 123 registers)
+ * @param values Engineering values, one per point
+ * @param start_address Address of the first register of the block
+ * @param pdu Buffer receiving the request PDU
+ * @param pdu_size Capacity of pdu (6 + 2 * plan->reg_span bytes)
+ * @param pdu_len Pointer to store the PDU length
+ * @param status Array receiving one status per point, may be NULL
+ * @return MODBUS_CONV_OK if all points encoded, first point error code otherwise,
+ *         MODBUS_CONV_ERR_BUFFER if pdu is too small,
+ *         MODBUS_CONV_ERR_INVALID_TYPE if the span does not fit one request
+ */
+int modbus_encode_plan_fc16(const modbus_plan_t *plan,
+                            const double *values,
+                            uint16_t start_address,
+                            uint8_t *pdu,
+                            size_t pdu_size,
+                            size_t *pdu_len,
+                            int *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_ENCODE_H */
@@ -0,0 +1,176 @@
+/**
+ * @file modbus_fanout.c
+ * @brief Subscription index implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_fanout.h"
+#include <string.h>
+
+/* Helper function prototypes */
+static size_t words_needed(uint32_t point_count, uint32_t consumer_count, size_t sub_count);
+
+size_t modbus_fanout_size(uint32_t point_count, uint32_t consumer_count, size_t sub_count)
+{
+    return words_needed(point_count, consumer_count, sub_count) * sizeof(uint32_t);
+}
+
+int modbus_fanout_build(modbus_fanout_t *index,
+                        uint32_t point_count,
+                        uint32_t consumer_count,
+                        const modbus_fanout_sub_t *subs,
+                        size_t sub_count,
+                        void *storage,
+                        size_t storage_size)
+{
+    uint32_t *words = (uint32_t *)storage;
+    uint32_t *order;
+    uint32_t sum, write;
+    uint32_t p;
+    size_t i;
+
+    if (!index || (!subs && sub_count) || !storage) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (sub_count > UINT32_MAX) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    if (storage_size < modbus_fanout_size(point_count, consumer_count, sub_count)) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    for (i = 0; i < sub_count; i++) {
+        if (subs[i].point >= point_count || subs[i].consumer >= consumer_count) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+    }
+
+    index->point_count = point_count;
+    index->consumer_count = consumer_count;
+    index->offsets = words;
+    index->consumers = index->offsets + point_count + 1;
+    index->counts = index->consumers + sub_count;
+    index->cursor = index->counts + consumer_count;
+    index->touched = index->cursor + consumer_count;
+    index->matches = index->touched + consumer_count;
+
+    /* Pass 1: order subscriptions by consumer (indices into subs) */
+    order = index->matches;
+    memset(index->cursor, 0, consumer_count * sizeof(uint32_t));
+    for (i = 0; i < sub_count; i++) {
+        index->cursor[subs[i].consumer]++;
+    }
+    sum = 0;
+    for (p = 0; p < consumer_count; p++) {
+        uint32_t n = index->cursor[p];
+        index->cursor[p] = sum;
+        sum += n;
+    }
+    for (i = 0; i < sub_count; i++) {
+        order[index->cursor[subs[i].consumer]++] = (uint32_t)i;
+    }
+
+    /* Pass 2: stable scatter by point, leaving every list sorted by consumer */
+    memset(index->offsets, 0, (point_count + (size_t)1) * sizeof(uint32_t));
+    for (i = 0; i < sub_count; i++) {
+        index->offsets[subs[i].point + 1]++;
+    }
+    for (p = 0; p < point_count; p++) {
+        index->offsets[p + 1] += index->offsets[p];
+    }
+    for (i = 0; i < sub_count; i++) {
+        const modbus_fanout_sub_t *s = &subs[order[i]];
+        index->consumers[index->offsets[s->point]++] = s->consumer;
+    }
+    /* The scatter advanced offsets[p] to the end of list p, i.e. the old offsets[p + 1] */
+    for (p = point_count; p > 0; p--) {
+        index->offsets[p] = index->offsets[p - 1];
+    }
+    index->offsets[0] = 0;
+
+    /* Merge duplicates, compacting the lists in place */
+    write = 0;
+    for (p = 0; p < point_count; p++) {
+        uint32_t start = index->offsets[p];
+        uint32_t end = index->offsets[p + 1];
+        uint32_t k;
+
+        index->offsets[p] = write;
+        for (k = start; k < end; k++) {
+            if (k == start || index->consumers[k] != index->consumers[k - 1]) {
+                index->consumers[write++] = index->consumers[k];
+            }
+        }
+    }
+    index->offsets[point_count] = write;
+    index->sub_count = write;
+
+    memset(index->counts, 0, consumer_count * sizeof(uint32_t));
+    return MODBUS_CONV_OK;
+}
+
+size_t modbus_fanout_dispatch(modbus_fanout_t *index,
+                              const uint32_t *changed,
+                              size_t change_count,
+                              modbus_fanout_fn fn,
+                              void *ctx)
+{
+    size_t touched = 0;
+    uint32_t pos = 0;
+    size_t i, t;
+
+    if (!index || !changed || !fn) {
+        return 0;
+    }
+
+    /* Count matches per consumer, remembering which consumers were hit */
+    for (i = 0; i < change_count; i++) {
+        uint32_t p = changed[i];
+        uint32_t k;
+
+        if (p >= index->point_count) {
+            continue;
+        }
+        for (k = index->offsets[p]; k < index->offsets[p + 1]; k++) {
+            uint32_t c = index->consumers[k];
+            if (index->counts[c]++ == 0) {
+                index->touched[touched++] = c;
+            }
+        }
+    }
+
+    /* Prefix sums over the touched consumers only */
+    for (t = 0; t < touched; t++) {
+        uint32_t c = index->touched[t];
+        index->cursor[c] = pos;
+        pos += index->counts[c];
+    }
+
+    /* Group the changed points per consumer */
+    for (i = 0; i < change_count; i++) {
+        uint32_t p = changed[i];
+        uint32_t k;
+
+        if (p >= index->point_count) {
+            continue;
+        }
+        for (k = index->offsets[p]; k < index->offsets[p + 1]; k++) {
+            index->matches[index->cursor[index->consumers[k]]++] = p;
+        }
+    }
+
+    for (t = 0; t < touched; t++) {
+        uint32_t c = index->touched[t];
+        uint32_t count = index->counts[c];
+
+        index->counts[c] = 0;
+        fn(ctx, c, index->matches + (index->cursor[c] - count), count);
+    }
+    return touched;
+}
+
+/* Helper function implementations */
+static size_t words_needed(uint32_t point_count, uint32_t consumer_count, size_t sub_count)
+{
+    /* offsets, consumer lists, three per-consumer arrays and the match buffer */
+    return (size_t)point_count + 1 + sub_count + 3 * (size_t)consumer_count + sub_count;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file modbus_fanout.h
+ * @brief Subscription index for value-change notifications
+ * @details Subscriptions (consumer, point) are compiled into inverted lists:
+ *          for every point, the sorted list of consumers interested in it.
+ *          Dispatching a set of changed points walks only the lists of those
+ *          points and groups the matches per consumer, so its cost follows
+ *          the number of changes and their subscribers, not the total number
+ *          of subscriptions. Changed sets typically come from
+ *          modbus_plan_changes().
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_FANOUT_H
+#define MODBUS_FANOUT_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One subscription */
+typedef struct {
+    uint32_t consumer;              /* Consumer index */
+    uint32_t point;                 /* Global point index */
+} modbus_fanout_sub_t;
+
+/**
+ * @brief Notification callback
+ * @param ctx User context passed to modbus_fanout_dispatch()
+ * @param consumer Consumer index
+ * @param points Changed points the consumer subscribed to, in input order
+ * @param count Number of points
+ */
+typedef void (*modbus_fanout_fn)(void *ctx, uint32_t consumer, const uint32_t *points, size_t count);
+
+/* Compiled subscription index, laid out in caller storage */
+typedef struct {
+    uint32_t point_count;           /* Points covered by the index */
+    uint32_t consumer_count;        /* Consumers covered by the index */
+    size_t sub_count;               /* Distinct subscriptions */
+    uint32_t *offsets;              /* point_count + 1 list boundaries */
+    uint32_t *consumers;            /* Consumer lists, one per point */
+
+    /* Dispatch scratch */
+    uint32_t *counts;               /* Matches per consumer */
+    uint32_t *cursor;               /* Output position per consumer */
+    uint32_t *touched;              /* Consumers with matches, in first-match order */
+    uint32_t *matches;              /* Changed points grouped per consumer */
+} modbus_fanout_t;
+
+/**
+ * @brief Storage needed for an index
+ * @param point_count Number of points
+ * @param consumer_count Number of consumers
+ * @param sub_count Number of subscriptions
+ * @return Size in bytes for modbus_fanout_build()
+ */
+size_t modbus_fanout_size(uint32_t point_count, uint32_t consumer_count, size_t sub_count);
+
+/**
+ * @brief Build the index from a list of subscriptions
+ * @details Duplicate subscriptions are merged. The subscription list is not
+ *          referenced afterwards.
+ * @param index Index to build
+ * @param point_count Number of points
+ * @param consumer_count Number of consumers
+ * @param subs Subscriptions
+ * @param sub_count Number of subscriptions
+ * @param storage Storage of at least modbus_fanout_size() bytes, suitably aligned for uint32_t
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if storage is too small,
+ *         MODBUS_CONV_ERR_INVALID_TYPE if a subscription is out of range
+ */
+int modbus_fanout_build(modbus_fanout_t *index,
+                        uint32_t point_count,
+                        uint32_t consumer_count,
+                        const modbus_fanout_sub_t *subs,
+                        size_t sub_count,
+                        void *storage,
+                        size_t storage_size);
+
+/**
+ * @brief Notify every consumer subscribed to at least one changed point
+ * @details Calls fn once per interested consumer with its changed points.
+ *          Points outside the index are ignored; changed must not contain
+ *          duplicates. Not reentrant for the same index.
+ * @param index Built index
+ * @param changed Changed point indices
+ * @param change_count Number of changed points
+ * @param fn Callback
+ * @param ctx User context for the callback
+ * @return Number of consumers notified
+ */
+size_t modbus_fanout_dispatch(modbus_fanout_t *index,
+                              const uint32_t *changed,
+                              size_t change_count,
+                              modbus_fanout_fn fn,
+                              void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_FANOUT_H */
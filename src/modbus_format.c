@@ -0,0 +1,863 @@
+/**
+ * @file modbus_format.c
+ * @brief Number to text formatting implementation
+ * @details Floating point values use Grisu3 (Loitsch, "Printing Floating-Point
+ *          Numbers Quickly and Accurately", PLDI 2010) with 64-bit cached
+ *          powers of ten. Grisu3 reports the few values (about 0.5%) it cannot
+ *          prove shortest; those take the exact free-format algorithm of
+ *          Burger and Dybvig on fixed-size big integers.
+ * @author Mouli Sai
+ */
+
+#include "modbus_format.h"
+#include <math.h>
+#include <string.h>
+
+/* Do-it-yourself floating point: f * 2^e */
+typedef struct {
+    uint64_t f;
+    int e;
+} diy_fp_t;
+
+/* Unsigned big integer, 32-bit words least significant first; 1280 bits hold
+ * the scaled value, boundaries and ten times the denominator of any double */
+#define BIGNUM_WORDS            40
+
+typedef struct {
+    uint32_t w[BIGNUM_WORDS];
+    int n;
+} bignum_t;
+
+/* Normalized 10^k for k = -348, -340, ..., 340 */
+static const uint64_t cached_f[] = {
+    0xfa8fd5a0081c0288, 0xbaaee17fa23ebf76, 0x8b16fb203055ac76,
+    0xcf42894a5dce35ea, 0x9a6bb0aa55653b2d, 0xe61acf033d1a45df,
+    0xab70fe17c79ac6ca, 0xff77b1fcbebcdc4f, 0xbe5691ef416bd60c,
+    0x8dd01fad907ffc3c, 0xd3515c2831559a83, 0x9d71ac8fada6c9b5,
+    0xea9c227723ee8bcb, 0xaecc49914078536d, 0x823c12795db6ce57,
+    0xc21094364dfb5637, 0x9096ea6f3848984f, 0xd77485cb25823ac7,
+    0xa086cfcd97bf97f4, 0xef340a98172aace5, 0xb23867fb2a35b28e,
+    0x84c8d4dfd2c63f3b, 0xc5dd44271ad3cdba, 0x936b9fcebb25c996,
+    0xdbac6c247d62a584, 0xa3ab66580d5fdaf6, 0xf3e2f893dec3f126,
+    0xb5b5ada8aaff80b8, 0x87625f056c7c4a8b, 0xc9bcff6034c13053,
+    0x964e858c91ba2655, 0xdff9772470297ebd, 0xa6dfbd9fb8e5b88f,
+    0xf8a95fcf88747d94, 0xb94470938fa89bcf, 0x8a08f0f8bf0f156b,
+    0xcdb02555653131b6, 0x993fe2c6d07b7fac, 0xe45c10c42a2b3b06,
+    0xaa242499697392d3, 0xfd87b5f28300ca0e, 0xbce5086492111aeb,
+    0x8cbccc096f5088cc, 0xd1b71758e219652c, 0x9c40000000000000,
+    0xe8d4a51000000000, 0xad78ebc5ac620000, 0x813f3978f8940984,
+    0xc097ce7bc90715b3, 0x8f7e32ce7bea5c70, 0xd5d238a4abe98068,
+    0x9f4f2726179a2245, 0xed63a231d4c4fb27, 0xb0de65388cc8ada8,
+    0x83c7088e1aab65db, 0xc45d1df942711d9a, 0x924d692ca61be758,
+    0xda01ee641a708dea, 0xa26da3999aef774a, 0xf209787bb47d6b85,
+    0xb454e4a179dd1877, 0x865b86925b9bc5c2, 0xc83553c5c8965d3d,
+    0x952ab45cfa97a0b3, 0xde469fbd99a05fe3, 0xa59bc234db398c25,
+    0xf6c69a72a3989f5c, 0xb7dcbf5354e9bece, 0x88fcf317f22241e2,
+    0xcc20ce9bd35c78a5, 0x98165af37b2153df, 0xe2a0b5dc971f303a,
+    0xa8d9d1535ce3b396, 0xfb9b7cd9a4a7443c, 0xbb764c4ca7a44410,
+    0x8bab8eefb6409c1a, 0xd01fef10a657842c, 0x9b10a4e5e9913129,
+    0xe7109bfba19c0c9d, 0xac2820d9623bf429, 0x80444b5e7aa7cf85,
+    0xbf21e44003acdd2d, 0x8e679c2f5e44ff8f, 0xd433179d9c8cb841,
+    0x9e19db92b4e31ba9, 0xeb96bf6ebadf77d9, 0xaf87023b9bf0ee6b
+};
+
+static const int16_t cached_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066
+};
+
+static const uint64_t pow10_u64[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+static const double pow10_f64[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Helper function prototypes */
+static diy_fp_t diy_mul(diy_fp_t a, diy_fp_t b);
+static diy_fp_t diy_normalize(diy_fp_t x);
+static diy_fp_t cached_power(int e, int *k);
+static bool round_weed(char *buf, int len, uint64_t too_high_w, uint64_t unsafe,
+                       uint64_t rest, uint64_t ten_kappa, uint64_t unit);
+static bool digit_gen(diy_fp_t low, diy_fp_t w, diy_fp_t high, char *buf, int *len, int *k);
+static int exact_digits(uint64_t f, int e, bool lower_closer, char *buf, int *k);
+static void bignum_set(bignum_t *b, uint64_t v);
+static void bignum_shl(bignum_t *b, int bits);
+static void bignum_mul(bignum_t *b, uint32_t m);
+static void bignum_mul_pow10(bignum_t *b, int k);
+static void bignum_add(bignum_t *sum, const bignum_t *a, const bignum_t *b);
+static void bignum_sub(bignum_t *a, const bignum_t *b);
+static int bignum_cmp(const bignum_t *a, const bignum_t *b);
+static size_t shortest(uint64_t f, int e, bool lower_closer, bool negative, char *buf);
+static size_t short_decimal(double a, bool negative, int ulp_exp, bool single,
+                            bool lower_closer, bool even, char *buf);
+static size_t short_integer(double a, bool negative, int ulp_exp,
+                            bool lower_closer, bool even, char *buf);
+static size_t put_decimal(uint64_t n, unsigned decimals, bool negative, char *buf);
+static size_t prettify(const char *digits, int len, int k, char *buf);
+static int count_digits_u32(uint32_t n);
+
+size_t modbus_format_u64(uint64_t value, char *buf)
+{
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+    size_t len;
+
+    while (value >= 100) {
+        unsigned idx = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[idx + 1];
+        *--p = digit_pairs[idx];
+    }
+    if (value >= 10) {
+        unsigned idx = (unsigned)value * 2;
+        *--p = digit_pairs[idx + 1];
+        *--p = digit_pairs[idx];
+    } else {
+        *--p = (char)('0' + value);
+    }
+
+    len = (size_t)(tmp + sizeof(tmp) - p);
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    return len;
+}
+
+size_t modbus_format_i64(int64_t value, char *buf)
+{
+    if (value < 0) {
+        buf[0] = '-';
+        return 1 + modbus_format_u64((uint64_t)0 - (uint64_t)value, buf + 1);
+    }
+    return modbus_format_u64((uint64_t)value, buf);
+}
+
+size_t modbus_format_double(double value, char *buf)
+{
+    size_t len;
+    uint64_t bits;
+    uint64_t frac;
+    int biased;
+
+    memcpy(&bits, &value, sizeof(bits));
+    biased = (int)((bits >> 52) & 0x7FF);
+    frac = bits & ((1ull << 52) - 1);
+
+    if (biased == 0x7FF) {
+        const char *s = frac ? "NaN" : ((bits >> 63) ? "-Infinity" : "Infinity");
+        len = strlen(s);
+        memcpy(buf, s, len + 1);
+        return len;
+    }
+    if (biased == 0) {
+        if (frac == 0) {
+            return (bits >> 63) ? (memcpy(buf, "-0", 3), 2) : (memcpy(buf, "0", 2), 1);
+        }
+        return shortest(frac, -1074, false, (bits >> 63) != 0, buf);
+    }
+    len = short_decimal(value < 0.0 ? -value : value, (bits >> 63) != 0, biased - 1075,
+                        false, frac == 0 && biased > 1, (frac & 1) == 0, buf);
+    if (len) {
+        return len;
+    }
+    return shortest(frac | (1ull << 52), biased - 1075, frac == 0 && biased > 1,
+                  (bits >> 63) != 0, buf);
+}
+
+size_t modbus_format_float(float value, char *buf)
+{
+    size_t len;
+    uint32_t bits;
+    uint32_t frac;
+    int biased;
+
+    memcpy(&bits, &value, sizeof(bits));
+    biased = (int)((bits >> 23) & 0xFF);
+    frac = bits & ((1u << 23) - 1);
+
+    /* Specials and zero read the same as their double counterparts */
+    if (biased == 0xFF || (biased == 0 && frac == 0)) {
+        return modbus_format_double((double)value, buf);
+    }
+    if (biased == 0) {
+        return shortest(frac, -149, false, (bits >> 31) != 0, buf);
+    }
+    len = short_decimal(value < 0.0f ? -(double)value : (double)value, (bits >> 31) != 0,
+                        biased - 150, true, frac == 0 && biased > 1, (frac & 1) == 0, buf);
+    if (len) {
+        return len;
+    }
+    return shortest(frac | (1u << 23), biased - 150, frac == 0 && biased > 1,
+                  (bits >> 31) != 0, buf);
+}
+
+size_t modbus_format_fixed(double value, unsigned decimals, char *buf)
+{
+    double scaled;
+
+    if (decimals > MODBUS_FORMAT_MAX_DECIMALS) {
+        decimals = MODBUS_FORMAT_MAX_DECIMALS;
+    }
+
+    scaled = (value < 0.0 ? -value : value) * pow10_f64[decimals];
+    /* NaN, infinities and values beyond integer precision keep shortest form */
+    if (!(scaled < 9007199254740992.0)) {
+        return modbus_format_double(value, buf);
+    }
+    return put_decimal((uint64_t)(scaled + 0.5), decimals, value < 0.0, buf);
+}
+
+unsigned modbus_scaling_decimals(double scaling_factor)
+{
+    double s = scaling_factor < 0.0 ? -scaling_factor : scaling_factor;
+    unsigned d;
+
+    if (!(s > 0.0) || s >= 9007199254740992.0) {
+        return 0;
+    }
+    for (d = 0; d < MODBUS_FORMAT_MAX_DECIMALS; d++) {
+        double m = s * pow10_f64[d];
+        double r = (double)(uint64_t)(m + 0.5);
+        if (m - r <= m * 1e-9 && r - m <= m * 1e-9) {
+            return d;
+        }
+    }
+    return MODBUS_FORMAT_MAX_DECIMALS;
+}
+
+size_t modbus_format_value_fixed(modbus_data_type_t data_type,
+                                 const modbus_value_t *value,
+                                 unsigned decimals,
+                                 char *buf)
+{
+    if (!value || !buf) {
+        return 0;
+    }
+    if (data_type >= MODBUS_IEEE_FLOAT32_ABCD && data_type <= MODBUS_IEEE_FLOAT32_BADC) {
+        return modbus_format_fixed(value->f32, decimals, buf);
+    }
+    if (data_type >= MODBUS_IEEE_FLOAT64_ABCDEFGH && data_type <= MODBUS_IEEE_FLOAT64_EFGHABCD) {
+        return modbus_format_fixed(value->f64, decimals, buf);
+    }
+    return modbus_format_value(data_type, value, buf);
+}
+
+size_t modbus_format_value(modbus_data_type_t data_type, const modbus_value_t *value, char *buf)
+{
+    if (!value || !buf) {
+        return 0;
+    }
+
+    switch (data_type) {
+        case MODBUS_BIT_BOOLEAN:
+            if (value->bool_val) {
+                memcpy(buf, "true", 5);
+                return 4;
+            }
+            memcpy(buf, "false", 6);
+            return 5;
+        case MODBUS_INT8_SIGNED:
+            return modbus_format_i64(value->i8, buf);
+        case MODBUS_INT8_UNSIGNED:
+            return modbus_format_u64(value->u8, buf);
+        case MODBUS_INT16_SIGNED_AB:
+        case MODBUS_INT16_SIGNED_BA:
+            return modbus_format_i64(value->i16, buf);
+        case MODBUS_INT16_UNSIGNED_AB:
+        case MODBUS_INT16_UNSIGNED_BA:
+            return modbus_format_u64(value->u16, buf);
+        default:
+            break;
+    }
+
+    if (data_type >= MODBUS_INT32_SIGNED_ABCD && data_type <= MODBUS_INT32_SIGNED_CDAB) {
+        return modbus_format_i64(value->i32, buf);
+    }
+    if (data_type >= MODBUS_INT32_UNSIGNED_ABCD && data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        return modbus_format_u64(value->u32, buf);
+    }
+    if (data_type >= MODBUS_INT64_SIGNED_ABCDEFGH && data_type <= MODBUS_INT64_SIGNED_EFGHABCD) {
+        return modbus_format_i64(value->i64, buf);
+    }
+    if (data_type >= MODBUS_INT64_UNSIGNED_ABCDEFGH && data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        return modbus_format_u64(value->u64, buf);
+    }
+    if (data_type >= MODBUS_IEEE_FLOAT32_ABCD && data_type <= MODBUS_IEEE_FLOAT32_BADC) {
+        return modbus_format_float(value->f32, buf);
+    }
+    if (data_type >= MODBUS_IEEE_FLOAT64_ABCDEFGH && data_type <= MODBUS_IEEE_FLOAT64_EFGHABCD) {
+        return modbus_format_double(value->f64, buf);
+    }
+
+    buf[0] = '\0';
+    return 0;
+}
+
+/* Helper function implementations */
+static diy_fp_t diy_mul(diy_fp_t a, diy_fp_t b)
+{
+    const uint64_t mask = 0xFFFFFFFFu;
+    uint64_t ah = a.f >> 32, al = a.f & mask;
+    uint64_t bh = b.f >> 32, bl = b.f & mask;
+    uint64_t hh = ah * bh, hl = ah * bl, lh = al * bh, ll = al * bl;
+    uint64_t mid = (ll >> 32) + (hl & mask) + (lh & mask) + (1ull << 31);
+    diy_fp_t r;
+
+    r.f = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+    r.e = a.e + b.e + 64;
+    return r;
+}
+
+static diy_fp_t diy_normalize(diy_fp_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    int shift = __builtin_clzll(x.f);
+    x.f <<= shift;
+    x.e -= shift;
+#else
+    while (!(x.f & (1ull << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+#endif
+    return x;
+}
+
+static diy_fp_t cached_power(int e, int *k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    unsigned index;
+    diy_fp_t r;
+
+    if (dk - ik > 0.0) {
+        ik++;
+    }
+    index = (unsigned)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+    r.f = cached_f[index];
+    r.e = cached_e[index];
+    return r;
+}
+
+static int count_digits_u32(uint32_t n)
+{
+    if (n < 10) return 1;
+    if (n < 100) return 2;
+    if (n < 1000) return 3;
+    if (n < 10000) return 4;
+    if (n < 100000) return 5;
+    if (n < 1000000) return 6;
+    if (n < 10000000) return 7;
+    if (n < 100000000) return 8;
+    if (n < 1000000000) return 9;
+    return 10;
+}
+
+/*
+ * Grisu3 rounding: moves the last digit towards w while it stays inside the
+ * unsafe interval, then fails unless the result is provably closest and
+ * inside the real interval despite the error of unit on each bound.
+ */
+static bool round_weed(char *buf, int len, uint64_t too_high_w, uint64_t unsafe,
+                       uint64_t rest, uint64_t ten_kappa, uint64_t unit)
+{
+    uint64_t small = too_high_w - unit;
+    uint64_t big = too_high_w + unit;
+
+    while (rest < small && unsafe - rest >= ten_kappa &&
+           (rest + ten_kappa < small || small - rest >= rest + ten_kappa - small)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big && unsafe - rest >= ten_kappa &&
+        (rest + ten_kappa < big || big - rest > rest + ten_kappa - big)) {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+/* Shortest digits inside (low, high) widened by one unit; false if unsure */
+static bool digit_gen(diy_fp_t low, diy_fp_t w, diy_fp_t high, char *buf, int *len, int *k)
+{
+    const int shift = -w.e;
+    const uint64_t one = 1ull << shift;
+    uint64_t unit = 1;
+    uint64_t too_high = high.f + unit;
+    uint64_t unsafe = too_high - (low.f - unit);
+    uint32_t p1 = (uint32_t)(too_high >> shift);
+    uint64_t p2 = too_high & (one - 1);
+    int kappa = count_digits_u32(p1);
+
+    *len = 0;
+    while (kappa > 0) {
+        uint32_t d;
+        uint64_t rest;
+
+        /* Constant divisors let the compiler replace division by multiplication */
+        switch (kappa) {
+            case 10: d = p1 / 1000000000; p1 %= 1000000000; break;
+            case 9:  d = p1 / 100000000;  p1 %= 100000000;  break;
+            case 8:  d = p1 / 10000000;   p1 %= 10000000;   break;
+            case 7:  d = p1 / 1000000;    p1 %= 1000000;    break;
+            case 6:  d = p1 / 100000;     p1 %= 100000;     break;
+            case 5:  d = p1 / 10000;      p1 %= 10000;      break;
+            case 4:  d = p1 / 1000;       p1 %= 1000;       break;
+            case 3:  d = p1 / 100;        p1 %= 100;        break;
+            case 2:  d = p1 / 10;         p1 %= 10;         break;
+            default: d = p1;              p1 = 0;           break;
+        }
+        if (d || *len) {
+            buf[(*len)++] = (char)('0' + d);
+        }
+        kappa--;
+        rest = ((uint64_t)p1 << shift) + p2;
+        if (rest < unsafe) {
+            *k += kappa;
+            return *len > 0 && round_weed(buf, *len, too_high - w.f, unsafe, rest,
+                                          pow10_u64[kappa] << shift, unit);
+        }
+    }
+
+    for (;;) {
+        char d;
+
+        p2 *= 10;
+        unit *= 10;
+        unsafe *= 10;
+        d = (char)(p2 >> shift);
+        if (d || *len) {
+            buf[(*len)++] = (char)('0' + d);
+        }
+        p2 &= one - 1;
+        kappa--;
+        if (p2 < unsafe) {
+            *k += kappa;
+            return *len > 0 && round_weed(buf, *len, (too_high - w.f) * unit, unsafe, p2,
+                                          one, unit);
+        }
+    }
+}
+
+/*
+ * Exact shortest digits of f * 2^e (Burger and Dybvig, "Printing
+ * Floating-Point Numbers Quickly and Accurately", PLDI 1996, free-format).
+ * The value is r / s and the rounding interval r +- m, all scaled by two so
+ * the boundaries stay integral; boundaries are included for even mantissas.
+ */
+static int exact_digits(uint64_t f, int e, bool lower_closer, char *buf, int *k)
+{
+    bignum_t r, s, mp, mm, t;
+    bool even = (f & 1) == 0;
+    int bits = 64;
+    int est, len = 0;
+
+    bignum_set(&r, f);
+    bignum_set(&s, 1);
+    bignum_set(&mp, 1);
+    bignum_set(&mm, 1);
+    if (e >= 0) {
+        bignum_shl(&r, e + 1 + lower_closer);
+        bignum_shl(&s, 1 + lower_closer);
+        bignum_shl(&mp, e + lower_closer);
+        bignum_shl(&mm, e);
+    } else {
+        bignum_shl(&r, 1 + lower_closer);
+        bignum_shl(&s, 1 + lower_closer - e);
+        bignum_shl(&mp, lower_closer);
+    }
+
+    /* Estimate of ceil(log10(v)), at most one too small */
+#if defined(__GNUC__) || defined(__clang__)
+    bits = 64 - __builtin_clzll(f);
+#else
+    while (!(f >> (bits - 1))) {
+        bits--;
+    }
+#endif
+    est = (int)ceil((e + bits - 1) * 0.30102999566398114 - 1e-10);
+    if (est >= 0) {
+        bignum_mul_pow10(&s, est);
+    } else {
+        bignum_mul_pow10(&r, -est);
+        bignum_mul_pow10(&mp, -est);
+        bignum_mul_pow10(&mm, -est);
+    }
+    bignum_add(&t, &r, &mp);
+    if (bignum_cmp(&t, &s) >= (even ? 0 : 1)) {
+        bignum_mul(&s, 10);
+        est++;
+    }
+
+    for (;;) {
+        int d = 0;
+        bool low, high;
+
+        bignum_mul(&r, 10);
+        bignum_mul(&mp, 10);
+        bignum_mul(&mm, 10);
+        while (bignum_cmp(&r, &s) >= 0) {
+            bignum_sub(&r, &s);
+            d++;
+        }
+        bignum_add(&t, &r, &mp);
+        low = bignum_cmp(&r, &mm) < (even ? 1 : 0);
+        high = bignum_cmp(&t, &s) > (even ? -1 : 0);
+        if (!low && !high) {
+            buf[len++] = (char)('0' + d);
+            continue;
+        }
+        if (low && high) {
+            /* Both neighbours qualify: take the nearer, upper on a tie */
+            bignum_add(&t, &r, &r);
+            high = bignum_cmp(&t, &s) >= 0;
+        }
+        buf[len++] = (char)('0' + d + high);
+        break;
+    }
+    *k = est - len;
+    return len;
+}
+
+static void bignum_set(bignum_t *b, uint64_t v)
+{
+    b->w[0] = (uint32_t)v;
+    b->w[1] = (uint32_t)(v >> 32);
+    b->n = b->w[1] ? 2 : 1;
+}
+
+static void bignum_shl(bignum_t *b, int bits)
+{
+    int words = bits / 32;
+    int rem = bits % 32;
+    int i;
+
+    if (rem) {
+        uint32_t carry = 0;
+
+        for (i = 0; i < b->n; i++) {
+            uint32_t w = b->w[i];
+            b->w[i] = (w << rem) | carry;
+            carry = w >> (32 - rem);
+        }
+        if (carry) {
+            b->w[b->n++] = carry;
+        }
+    }
+    if (words) {
+        for (i = b->n - 1; i >= 0; i--) {
+            b->w[i + words] = b->w[i];
+        }
+        memset(b->w, 0, (size_t)words * sizeof(uint32_t));
+        b->n += words;
+    }
+}
+
+static void bignum_mul(bignum_t *b, uint32_t m)
+{
+    uint64_t carry = 0;
+    int i;
+
+    for (i = 0; i < b->n; i++) {
+        uint64_t p = (uint64_t)b->w[i] * m + carry;
+        b->w[i] = (uint32_t)p;
+        carry = p >> 32;
+    }
+    if (carry) {
+        b->w[b->n++] = (uint32_t)carry;
+    }
+}
+
+static void bignum_mul_pow10(bignum_t *b, int k)
+{
+    for (; k >= 9; k -= 9) {
+        bignum_mul(b, 1000000000u);
+    }
+    if (k > 0) {
+        bignum_mul(b, (uint32_t)pow10_u64[k]);
+    }
+}
+
+static void bignum_add(bignum_t *sum, const bignum_t *a, const bignum_t *b)
+{
+    int n = a->n > b->n ? a->n : b->n;
+    uint64_t carry = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint64_t x = carry;
+
+        x += i < a->n ? a->w[i] : 0;
+        x += i < b->n ? b->w[i] : 0;
+        sum->w[i] = (uint32_t)x;
+        carry = x >> 32;
+    }
+    sum->n = n;
+    if (carry) {
+        sum->w[sum->n++] = (uint32_t)carry;
+    }
+}
+
+/* a -= b, a >= b */
+static void bignum_sub(bignum_t *a, const bignum_t *b)
+{
+    uint32_t borrow = 0;
+    int i;
+
+    for (i = 0; i < a->n; i++) {
+        uint64_t x = (uint64_t)a->w[i] - (i < b->n ? b->w[i] : 0) - borrow;
+        a->w[i] = (uint32_t)x;
+        borrow = (uint32_t)(x >> 63);
+    }
+    while (a->n > 1 && a->w[a->n - 1] == 0) {
+        a->n--;
+    }
+}
+
+static int bignum_cmp(const bignum_t *a, const bignum_t *b)
+{
+    int i;
+
+    if (a->n != b->n) {
+        return a->n < b->n ? -1 : 1;
+    }
+    for (i = a->n - 1; i >= 0; i--) {
+        if (a->w[i] != b->w[i]) {
+            return a->w[i] < b->w[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static size_t shortest(uint64_t f, int e, bool lower_closer, bool negative, char *buf)
+{
+    char digits[24];
+    diy_fp_t v, plus, minus, c, w, wp, wm;
+    int len, k;
+    size_t pos = 0;
+
+    /* Boundaries halfway to the neighbouring representable values */
+    v.f = f;
+    v.e = e;
+    plus.f = (f << 1) + 1;
+    plus.e = e - 1;
+    plus = diy_normalize(plus);
+    if (lower_closer) {
+        minus.f = (f << 2) - 1;
+        minus.e = e - 2;
+    } else {
+        minus.f = (f << 1) - 1;
+        minus.e = e - 1;
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    c = cached_power(plus.e, &k);
+    w = diy_mul(diy_normalize(v), c);
+    wp = diy_mul(plus, c);
+    wm = diy_mul(minus, c);
+    if (!digit_gen(wm, w, wp, digits, &len, &k)) {
+        len = exact_digits(f, e, lower_closer, digits, &k);
+    }
+
+    if (negative) {
+        buf[pos++] = '-';
+    }
+    return pos + prettify(digits, len, k, buf + pos);
+}
+
+/*
+ * Fast path for values with at most 6 decimals, as produced by scaled
+ * register readings. d is the largest decimal count (up to 6) whose grid is
+ * finer than the value's ulp, so the rounding interval holds at most one
+ * d-decimal number and, after stripping trailing zeros, it is the shortest
+ * representation. Doubles are verified with a correctly rounded division of
+ * exact operands, floats by comparing against the exact interval half-width.
+ * Returns 0 when the value does not qualify.
+ */
+static size_t short_decimal(double a, bool negative, int ulp_exp, bool single,
+                            bool lower_closer, bool even, char *buf)
+{
+    double scale, m, r;
+    int64_t n;
+    int d;
+
+    if (ulp_exp >= 0) {
+        return short_integer(a, negative, ulp_exp, lower_closer, even, buf);
+    }
+    if (ulp_exp < -1000) {
+        return 0;
+    }
+    d = (int)(-ulp_exp * 0.30102999566398114);
+    if (d > 6) {
+        d = 6;
+    }
+    scale = pow10_f64[d];
+    m = a * scale;
+    if (m >= 9007199254740992.0) {
+        return 0;
+    }
+    /* Signed conversions map to single instructions, m is below 2^53 */
+    n = (int64_t)(m + 0.5);
+    r = (double)n;
+    if (n == 0) {
+        return 0;
+    }
+
+    if (single) {
+        /* a * scale is exact for floats: 24 + 20 significant bits */
+        uint64_t hbits = (uint64_t)(ulp_exp - 1 + 1023) << 52;
+        double h, diff;
+
+        memcpy(&h, &hbits, sizeof(h));
+        h *= scale;
+        if (lower_closer && r < m) {
+            h *= 0.5;
+        }
+        diff = r > m ? r - m : m - r;
+        if (diff > h || (diff == h && !even)) {
+            return 0;
+        }
+    } else if (r / scale != a) {
+        return 0;
+    }
+
+    while (d > 0 && n % 10 == 0) {
+        n /= 10;
+        d--;
+    }
+    return put_decimal((uint64_t)n, (unsigned)d, negative, buf);
+}
+
+/*
+ * Integral values (ulp >= 1) below 2^64: pick the multiple of the largest
+ * power of ten inside the rounding interval, boundaries included for even
+ * mantissas. Cheaper than Grisu3, which gives up on most values whose
+ * boundary is a short decimal, as is common for large floats.
+ */
+static size_t short_integer(double a, bool negative, int ulp_exp,
+                            bool lower_closer, bool even, char *buf)
+{
+    uint64_t value, best, t;
+    uint64_t width;
+    int k;
+
+    if (a >= 18446744073709551616.0 || ulp_exp > 62) {
+        return 0;
+    }
+    value = (uint64_t)a;
+    best = value;
+    /* Interval widths in doubled units: |2 * (c - value)| must stay below 2^ulp_exp */
+    width = 1ull << ulp_exp;
+
+    for (k = 1, t = 10; k <= 19; k++, t *= 10) {
+        uint64_t c = (value / t) * t;
+        uint64_t up, dist, limit;
+
+        /* Nearest multiple of t, rounding half up */
+        if (value - c >= t - (value - c) && c <= UINT64_MAX - t) {
+            c += t;
+        }
+        up = c >= value;
+        dist = up ? c - value : value - c;
+        limit = (!up && lower_closer) ? width / 2 : width;
+        if (dist >= (1ull << 62) || 2 * dist > limit || (2 * dist == limit && !even)) {
+            break;
+        }
+        best = c;
+        if (t > UINT64_MAX / 10) {
+            break;
+        }
+    }
+
+    if (negative) {
+        buf[0] = '-';
+        return 1 + modbus_format_u64(best, buf + 1);
+    }
+    return modbus_format_u64(best, buf);
+}
+
+/* Writes n / 10^decimals in plain notation */
+static size_t put_decimal(uint64_t n, unsigned decimals, bool negative, char *buf)
+{
+    char digits[24];
+    size_t len = modbus_format_u64(n, digits);
+    size_t pos = 0;
+
+    if (negative && n != 0) {
+        buf[pos++] = '-';
+    }
+    if (decimals == 0) {
+        memcpy(buf + pos, digits, len + 1);
+        return pos + len;
+    }
+    if (len > decimals) {
+        memcpy(buf + pos, digits, len - decimals);
+        pos += len - decimals;
+    } else {
+        buf[pos++] = '0';
+    }
+    buf[pos++] = '.';
+    if (len < decimals) {
+        memset(buf + pos, '0', decimals - len);
+        pos += decimals - len;
+    }
+    memcpy(buf + pos, digits + (len > decimals ? len - decimals : 0),
+           len > decimals ? decimals : len);
+    pos += len > decimals ? decimals : len;
+    buf[pos] = '\0';
+    return pos;
+}
+
+/* Lays out digits * 10^k the way JavaScript's Number#toString does */
+static size_t prettify(const char *digits, int len, int k, char *buf)
+{
+    int n = len + k;
+    size_t pos = 0;
+
+    if (len <= n && n <= 21) {
+        memcpy(buf, digits, (size_t)len);
+        memset(buf + len, '0', (size_t)(n - len));
+        pos = (size_t)n;
+    } else if (0 < n && n <= 21) {
+        memcpy(buf, digits, (size_t)n);
+        buf[n] = '.';
+        memcpy(buf + n + 1, digits + n, (size_t)(len - n));
+        pos = (size_t)len + 1;
+    } else if (-6 < n && n <= 0) {
+        buf[0] = '0';
+        buf[1] = '.';
+        memset(buf + 2, '0', (size_t)-n);
+        memcpy(buf + 2 - n, digits, (size_t)len);
+        pos = (size_t)(2 - n + len);
+    } else {
+        int exp = n - 1;
+        buf[pos++] = digits[0];
+        if (len > 1) {
+            buf[pos++] = '.';
+            memcpy(buf + pos, digits + 1, (size_t)(len - 1));
+            pos += (size_t)(len - 1);
+        }
+        buf[pos++] = 'e';
+        buf[pos++] = exp < 0 ? '-' : '+';
+        pos += modbus_format_u64((uint64_t)(exp < 0 ? -exp : exp), buf + pos);
+    }
+
+    buf[pos] = '\0';
+    return pos;
+}
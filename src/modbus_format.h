@@ -0,0 +1,109 @@
+/**
+ * @file modbus_format.h
+ * @brief Locale-independent number to text formatting
+ * @details Shortest round-trip formatting of float/double results and fast
+ *          integer formatting, writing into caller buffers without allocation.
+ *          Output follows JavaScript number syntax: "25", "3.1415927",
+ *          "1e+21", "-1.5e-7", "NaN", "Infinity".
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_FORMAT_H
+#define MODBUS_FORMAT_H
+
+#include "modbus_conversion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Buffer size sufficient for any single formatted value, including terminator */
+#define MODBUS_FORMAT_MAX               32
+
+/* Largest number of decimals supported by fixed formatting */
+#define MODBUS_FORMAT_MAX_DECIMALS      9
+
+/**
+ * @brief Format a double with the shortest digits that read back exactly
+ * @param value Value to format
+ * @param buf Buffer of at least MODBUS_FORMAT_MAX bytes
+ * @return Number of characters written (excluding terminator)
+ */
+size_t modbus_format_double(double value, char *buf);
+
+/**
+ * @brief Format a float with the shortest digits that read back exactly as float
+ * @param value Value to format
+ * @param buf Buffer of at least MODBUS_FORMAT_MAX bytes
+ * @return Number of characters written (excluding terminator)
+ */
+size_t modbus_format_float(float value, char *buf);
+
+/**
+ * @brief Format a value with a fixed number of decimals
+ * @details Rounds half away from zero. NaN, infinities and values whose
+ *          scaled magnitude exceeds 2^53 are written in shortest form instead.
+ * @param value Value to format
+ * @param decimals Number of decimals (capped at MODBUS_FORMAT_MAX_DECIMALS)
+ * @param buf Buffer of at least MODBUS_FORMAT_MAX bytes
+ * @return Number of characters written (excluding terminator)
+ */
+size_t modbus_format_fixed(double value, unsigned decimals, char *buf);
+
+/**
+ * @brief Derive display decimals from a scaling factor
+ * @details 0.1 gives 1, 0.25 gives 2, 0.001 gives 3, 1.0 and 10.0 give 0.
+ * @param scaling_factor Point scaling factor
+ * @return Decimals needed to show one step of the scaled value
+ *         (at most MODBUS_FORMAT_MAX_DECIMALS)
+ */
+unsigned modbus_scaling_decimals(double scaling_factor);
+
+/**
+ * @brief Format an unsigned 64-bit integer
+ * @param value Value to format
+ * @param buf Buffer of at least MODBUS_FORMAT_MAX bytes
+ * @return Number of characters written (excluding terminator)
+ */
+size_t modbus_format_u64(uint64_t value, char *buf);
+
+/**
+ * @brief Format a signed 64-bit integer
+ * @param value Value to format
+ * @param buf Buffer of at least MODBUS_FORMAT_MAX bytes
+ * @return Number of characters written (excluding terminator)
+ */
+size_t modbus_format_i64(int64_t value, char *buf);
+
+/**
+ * @brief Format a conversion result according to its data type
+ * @details Booleans are written as "true"/"false", integers in decimal and
+ *          floats with shortest round-trip digits of their own precision.
+ * @param data_type Data type the value was converted with
+ * @param value Conversion result
+ * @param buf Buffer of at least MODBUS_FORMAT_MAX bytes
+ * @return Number of characters written (excluding terminator), 0 for an invalid type
+ */
+size_t modbus_format_value(modbus_data_type_t data_type, const modbus_value_t *value, char *buf);
+
+/**
+ * @brief Format a conversion result, floats with fixed decimals
+ * @details Typically called with modbus_scaling_decimals(point->scaling_factor).
+ *          Non-float types are formatted as by modbus_format_value().
+ * @param data_type Data type the value was converted with
+ * @param value Conversion result
+ * @param decimals Number of decimals for float types
+ * @param buf Buffer of at least MODBUS_FORMAT_MAX bytes
+ * @return Number of characters written (excluding terminator), 0 for an invalid type
+ */
+size_t modbus_format_value_fixed(modbus_data_type_t data_type,
+                                 const modbus_value_t *value,
+                                 unsigned decimals,
+                                 char *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_FORMAT_H */
@@ -0,0 +1,179 @@
+/**
+ * @file modbus_frame.c
+ * @brief Modbus response frame decoding implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_frame.h"
+#include "modbus_conversion.h"
+#include "modbus_probes.h"
+#include "modbus_stats.h"
+
+/* Helper function prototypes */
+static int parse_fail(const uint8_t *pdu, size_t pdu_len, int error_code);
+static void load_registers(const uint8_t *bytes, size_t count, uint16_t *registers);
+
+/* FC03/FC04 response decoding */
+int modbus_frame_read_registers(const uint8_t *pdu,
+                                size_t pdu_len,
+                                uint16_t *registers,
+                                size_t max_regs,
+                                size_t *reg_count)
+{
+    size_t byte_count;
+    size_t count;
+
+    if (!pdu || !registers || !reg_count) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    if (pdu_len < 2 ||
+        (pdu[0] != MODBUS_FC_READ_HOLDING_REGISTERS && pdu[0] != MODBUS_FC_READ_INPUT_REGISTERS)) {
+        return parse_fail(pdu, pdu_len, MODBUS_CONV_ERR_FRAME);
+    }
+
+    byte_count = pdu[1];
+    if ((byte_count & 1) || byte_count + 2 != pdu_len) {
+        return parse_fail(pdu, pdu_len, MODBUS_CONV_ERR_FRAME);
+    }
+
+    count = byte_count / 2;
+    if (count > max_regs) {
+        return parse_fail(pdu, pdu_len, MODBUS_CONV_ERR_INSUFF_REGS);
+    }
+
+    load_registers(pdu + 2, count, registers);
+    *reg_count = count;
+    MODBUS_STATS_ADD(modbus_stats_local(), frames_parsed, 1);
+    return MODBUS_CONV_OK;
+}
+
+/* FC20 response decoding */
+int modbus_frame_read_file_record(const uint8_t *pdu,
+                                  size_t pdu_len,
+                                  uint16_t *registers,
+                                  size_t max_regs,
+                                  size_t *reg_count)
+{
+    size_t count = 0;
+    size_t pos;
+
+    if (!pdu || !registers || !reg_count) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    if (pdu_len < 2 || pdu[0] != MODBUS_FC_READ_FILE_RECORD || (size_t)pdu[1] + 2 != pdu_len) {
+        return parse_fail(pdu, pdu_len, MODBUS_CONV_ERR_FRAME);
+    }
+
+    /* Validate every sub-response before writing any register */
+    for (pos = 2; pos < pdu_len; pos += 1 + pdu[pos]) {
+        size_t sub_len = pdu[pos];
+
+        if (!(sub_len & 1) || pos + 1 + sub_len > pdu_len ||
+            pdu[pos + 1] != MODBUS_FILE_REFERENCE_TYPE) {
+            return parse_fail(pdu, pdu_len, MODBUS_CONV_ERR_FRAME);
+        }
+        count += sub_len / 2;
+    }
+    if (count > max_regs) {
+        return parse_fail(pdu, pdu_len, MODBUS_CONV_ERR_INSUFF_REGS);
+    }
+
+    count = 0;
+    for (pos = 2; pos < pdu_len; pos += 1 + pdu[pos]) {
+        load_registers(pdu + pos + 2, pdu[pos] / 2, registers + count);
+        count += pdu[pos] / 2;
+    }
+    *reg_count = count;
+    MODBUS_STATS_ADD(modbus_stats_local(), frames_parsed, 1);
+    return MODBUS_CONV_OK;
+}
+
+/* FC24 response decoding */
+int modbus_frame_read_fifo(const uint8_t *pdu,
+                           size_t pdu_len,
+                           uint16_t *registers,
+                           size_t max_regs,
+                           size_t *reg_count)
+{
+    size_t byte_count;
+    size_t count;
+
+    if (!pdu || !registers || !reg_count) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    if (pdu_len < 5 || pdu[0] != MODBUS_FC_READ_FIFO_QUEUE) {
+        return parse_fail(pdu, pdu_len, MODBUS_CONV_ERR_FRAME);
+    }
+
+    /* Byte count covers the FIFO count field and the queued registers */
+    byte_count = ((size_t)pdu[1] << 8) | pdu[2];
+    count = ((size_t)pdu[3] << 8) | pdu[4];
+    if (byte_count + 3 != pdu_len || byte_count != 2 + 2 * count || count > 31) {
+        return parse_fail(pdu, pdu_len, MODBUS_CONV_ERR_FRAME);
+    }
+    if (count > max_regs) {
+        return parse_fail(pdu, pdu_len, MODBUS_CONV_ERR_INSUFF_REGS);
+    }
+
+    load_registers(pdu + 5, count, registers);
+    *reg_count = count;
+    MODBUS_STATS_ADD(modbus_stats_local(), frames_parsed, 1);
+    return MODBUS_CONV_OK;
+}
+
+/* FC16 request encoding */
+int modbus_frame_write_registers(uint16_t start_address,
+                                 const uint16_t *registers,
+                                 size_t reg_count,
+                                 uint8_t *pdu,
+                                 size_t pdu_size,
+                                 size_t *pdu_len)
+{
+    size_t i;
+
+    if (!registers || !pdu || !pdu_len) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (reg_count == 0 || reg_count > MODBUS_FRAME_MAX_WRITE_REGS) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    if (pdu_size < 6 + 2 * reg_count) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    pdu[0] = MODBUS_FC_WRITE_MULTIPLE_REGISTERS;
+    pdu[1] = (uint8_t)(start_address >> 8);
+    pdu[2] = (uint8_t)start_address;
+    pdu[3] = (uint8_t)(reg_count >> 8);
+    pdu[4] = (uint8_t)reg_count;
+    pdu[5] = (uint8_t)(2 * reg_count);
+    for (i = 0; i < reg_count; i++) {
+        pdu[6 + i * 2] = (uint8_t)(registers[i] >> 8);
+        pdu[7 + i * 2] = (uint8_t)registers[i];
+    }
+    *pdu_len = 6 + 2 * reg_count;
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+static int parse_fail(const uint8_t *pdu, size_t pdu_len, int error_code)
+{
+    MODBUS_PROBE3(frame__parse_fail, pdu_len ? pdu[0] : 0, pdu_len, error_code);
+    MODBUS_STATS_ADD(modbus_stats_local(), frame_errors, 1);
+    (void)pdu;
+    (void)pdu_len;
+    return error_code;
+}
+
+/* Big-endian register bytes to host order */
+static void load_registers(const uint8_t *bytes, size_t count, uint16_t *registers)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        registers[i] = (uint16_t)((bytes[i * 2] << 8) | bytes[i * 2 + 1]);
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file modbus_frame.h
+ * @brief Modbus response frame decoding
+ * @details Extracts register values from Modbus PDUs (function code onwards,
+ *          without RTU address/CRC or TCP MBAP header) and builds write
+ *          requests.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_FRAME_H
+#define MODBUS_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Function codes */
+#define MODBUS_FC_READ_HOLDING_REGISTERS    0x03
+#define MODBUS_FC_READ_INPUT_REGISTERS      0x04
+#define MODBUS_FC_READ_FILE_RECORD          0x14
+#define MODBUS_FC_WRITE_MULTIPLE_REGISTERS  0x10
+#define MODBUS_FC_READ_FIFO_QUEUE           0x18
+
+/* Reference type of FC20 sub-requests and sub-responses */
+#define MODBUS_FILE_REFERENCE_TYPE          0x06
+
+/* Most registers any supported response can carry */
+#define MODBUS_FRAME_MAX_REGS               125
+
+/* Most registers of one write multiple registers (FC16) request */
+#define MODBUS_FRAME_MAX_WRITE_REGS         123
+
+/**
+ * @brief Decode a read holding/input registers (FC03/FC04) response PDU
+ * @param pdu Response PDU bytes
+ * @param pdu_len Number of bytes in the PDU
+ * @param registers Array receiving the register values
+ * @param max_regs Capacity of the register array
+ * @param reg_count Pointer to store the number of decoded registers
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_FRAME for malformed or
+ *         exception responses, MODBUS_CONV_ERR_INSUFF_REGS if the array is too small
+ */
+int modbus_frame_read_registers(const uint8_t *pdu,
+                                size_t pdu_len,
+                                uint16_t *registers,
+                                size_t max_regs,
+                                size_t *reg_count);
+
+/**
+ * @brief Decode a read file record (FC20) response PDU
+ * @details The registers of all sub-responses are concatenated in order.
+ * @param pdu Response PDU bytes
+ * @param pdu_len Number of bytes in the PDU
+ * @param registers Array receiving the register values
+ * @param max_regs Capacity of the register array
+ * @param reg_count Pointer to store the number of decoded registers
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_FRAME for malformed or
+ *         exception responses, MODBUS_CONV_ERR_INSUFF_REGS if the array is too small
+ */
+int modbus_frame_read_file_record(const uint8_t *pdu,
+                                  size_t pdu_len,
+                                  uint16_t *registers,
+                                  size_t max_regs,
+                                  size_t *reg_count);
+
+/**
+ * @brief Decode a read FIFO queue (FC24) response PDU
+ * @param pdu Response PDU bytes
+ * @param pdu_len Number of bytes in the PDU
+ * @param registers Array receiving the queued register values
+ * @param max_regs Capacity of the register array
+ * @param reg_count Pointer to store the number of decoded registers
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_FRAME for malformed or
+ *         exception responses, MODBUS_CONV_ERR_INSUFF_REGS if the array is too small
+ */
+int modbus_frame_read_fifo(const uint8_t *pdu,
+                           size_t pdu_len,
+                           uint16_t *registers,
+                           size_t max_regs,
+                           size_t *reg_count);
+
+/**
+ * @brief Build a write multiple registers (FC16) request PDU
+ * @param start_address Address of the first register
+ * @param registers Register values, e.g. from modbus_encode_array()
+ * @param reg_count Number of registers (1 to MODBUS_FRAME_MAX_WRITE_REGS)
+ * @param pdu Buffer receiving the request PDU
+ * @param pdu_size Capacity of pdu (6 + 2 * reg_count bytes)
+ * @param pdu_len Pointer to store the PDU length
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE for a register
+ *         count out of range, MODBUS_CONV_ERR_BUFFER if pdu is too small
+ */
+int modbus_frame_write_registers(uint16_t start_address,
+                                 const uint16_t *registers,
+                                 size_t reg_count,
+                                 uint8_t *pdu,
+                                 size_t pdu_size,
+                                 size_t *pdu_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_FRAME_H */
@@ -0,0 +1,538 @@
+/**
+ * @file modbus_history.c
+ * @brief Memory-mapped columnar history file implementation
+ * @author Mouli Sai
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "modbus_history.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Block layout (all sections 8-byte aligned):
+ *   modbus_history_block_t
+ *   modbus_history_stats_t  x point_count
+ *   uint64_t timestamps     x block_rows
+ *   uint64_t values         x block_rows, one column per point
+ *   uint64_t validity       x ceil(block_rows / 64), one bitmap per point
+ */
+
+/* Blocks allocated by a new file */
+#define HISTORY_INITIAL_BLOCKS  4
+
+/* Counts are published with release stores after the data they cover */
+#define HISTORY_LOAD(p)             __atomic_load_n((p), __ATOMIC_RELAXED)
+#define HISTORY_LOAD_ACQUIRE(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define HISTORY_STORE(p, v)         __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define HISTORY_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/* Helper function prototypes */
+static size_t block_bytes(uint32_t point_count, uint32_t block_rows);
+static size_t data_offset(uint32_t point_count);
+static int map_file(modbus_history_t *history, size_t size);
+static int grow_file(modbus_history_t *history);
+static uint8_t *block_base(const modbus_history_t *history, uint64_t block);
+static modbus_history_stats_t *block_stats(const modbus_history_t *history, uint8_t *block);
+static uint64_t *timestamp_column(const modbus_history_t *history, uint8_t *block);
+static uint64_t *value_column(const modbus_history_t *history, uint8_t *block, uint32_t point);
+static uint64_t *validity_bitmap(const modbus_history_t *history, uint8_t *block, uint32_t point);
+static uint64_t first_block(const modbus_history_t *history, uint64_t from);
+static uint64_t visible_blocks(const modbus_history_t *history);
+static void stats_add(modbus_history_stats_t *stats, double value);
+static void stats_merge(modbus_history_stats_t *stats, const modbus_history_stats_t *other);
+static size_t value_width(modbus_data_type_t data_type);
+
+int modbus_history_create(modbus_history_t *history,
+                          const char *path,
+                          const modbus_plan_t *plan,
+                          uint32_t block_rows)
+{
+    modbus_history_header_t *header;
+    uint32_t *types;
+    size_t size;
+    size_t i;
+
+    if (!history || !path || !plan) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (block_rows == 0 || plan->point_count > UINT32_MAX) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    memset(history, 0, sizeof(*history));
+    history->point_count = (uint32_t)plan->point_count;
+    history->block_rows = block_rows;
+    history->block_size = block_bytes(history->point_count, block_rows);
+    history->writable = true;
+
+    size = data_offset(history->point_count) + HISTORY_INITIAL_BLOCKS * history->block_size;
+    history->fd = open(path, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (history->fd < 0) {
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+    if (ftruncate(history->fd, (off_t)size) != 0 || map_file(history, size) != 0) {
+        int saved = errno;
+        close(history->fd);
+        errno = saved;
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+
+    header = history->header;
+    header->version = MODBUS_HISTORY_VERSION;
+    header->point_count = history->point_count;
+    header->block_rows = block_rows;
+    header->block_size = history->block_size;
+    header->block_count = 0;
+    header->data_offset = data_offset(history->point_count);
+    types = (uint32_t *)(void *)(header + 1);
+    for (i = 0; i < plan->point_count; i++) {
+        types[i] = (uint32_t)plan->points[i].data_type;
+    }
+    header->magic = MODBUS_HISTORY_MAGIC;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_history_open(modbus_history_t *history, const char *path, bool writable)
+{
+    const modbus_history_header_t *header;
+    struct stat st;
+    uint64_t b;
+
+    if (!history || !path) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    memset(history, 0, sizeof(*history));
+    history->writable = writable;
+    history->fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if (history->fd < 0) {
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+    if (fstat(history->fd, &st) != 0 || (size_t)st.st_size < sizeof(modbus_history_header_t) ||
+        map_file(history, (size_t)st.st_size) != 0) {
+        int saved = errno;
+        close(history->fd);
+        errno = saved ? saved : EINVAL;
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+
+    header = history->header;
+    if (header->magic != MODBUS_HISTORY_MAGIC || header->version != MODBUS_HISTORY_VERSION ||
+        header->block_rows == 0 ||
+        header->block_size != block_bytes(header->point_count, header->block_rows) ||
+        header->data_offset != data_offset(header->point_count) ||
+        history->size < header->data_offset ||
+        header->block_count > (history->size - header->data_offset) / header->block_size) {
+        modbus_history_close(history);
+        errno = EINVAL;
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+
+    history->point_count = header->point_count;
+    history->block_rows = header->block_rows;
+    history->block_size = (size_t)header->block_size;
+    history->capacity = (history->size - header->data_offset) / header->block_size;
+
+    /* Row counts index the columns; a corrupt one would run past its block */
+    for (b = 0; b < header->block_count; b++) {
+        const modbus_history_block_t *block =
+            (const modbus_history_block_t *)(const void *)block_base(history, b);
+
+        if (block->row_count > header->block_rows) {
+            modbus_history_close(history);
+            errno = EINVAL;
+            return MODBUS_CONV_ERR_SYSTEM;
+        }
+    }
+    return MODBUS_CONV_OK;
+}
+
+void modbus_history_close(modbus_history_t *history)
+{
+    if (!history || !history->base) {
+        return;
+    }
+    munmap(history->base, history->size);
+    close(history->fd);
+    memset(history, 0, sizeof(*history));
+}
+
+int modbus_history_append(modbus_history_t *history,
+                          const modbus_plan_t *plan,
+                          const modbus_value_t *values,
+                          const int *status,
+                          uint64_t timestamp)
+{
+    modbus_history_header_t *header;
+    modbus_history_block_t *block;
+    modbus_history_stats_t *stats;
+    uint8_t *base;
+    uint64_t row;
+    uint32_t i;
+
+    if (!history || !history->base || !plan || !values) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (!history->writable || plan->point_count != history->point_count) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    for (i = 0; i < plan->point_count; i++) {
+        if ((uint32_t)plan->points[i].data_type != history->types[i]) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+    }
+
+    header = history->header;
+    if (header->block_count > 0) {
+        block = (modbus_history_block_t *)(void *)block_base(history, header->block_count - 1);
+        if (timestamp < block->last_timestamp) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+    }
+
+    /* Start a new block when there is none or the last one is full */
+    if (header->block_count == 0 ||
+        ((modbus_history_block_t *)(void *)block_base(history, header->block_count - 1))->row_count ==
+            history->block_rows) {
+        if (header->block_count == history->capacity && grow_file(history) != 0) {
+            return MODBUS_CONV_ERR_SYSTEM;
+        }
+        header = history->header;
+        memset(block_base(history, header->block_count), 0, history->block_size);
+        HISTORY_STORE_RELEASE(&header->block_count, header->block_count + 1);
+    }
+
+    base = block_base(history, header->block_count - 1);
+    block = (modbus_history_block_t *)(void *)base;
+    stats = block_stats(history, base);
+    row = block->row_count;
+
+    timestamp_column(history, base)[row] = timestamp;
+    for (i = 0; i < history->point_count; i++) {
+        modbus_data_type_t data_type = (modbus_data_type_t)history->types[i];
+        uint64_t bits = 0;
+        double value;
+
+        if (status && status[i] != MODBUS_CONV_OK) {
+            continue;
+        }
+        memcpy(&bits, &values[i], value_width(data_type));
+        value_column(history, base, i)[row] = bits;
+        validity_bitmap(history, base, i)[row / 64] |= (uint64_t)1 << (row % 64);
+
+        value = modbus_value_to_double(data_type, &values[i]);
+        if (isfinite(value)) {
+            stats_add(&stats[i], value);
+        }
+    }
+
+    /* The row becomes visible once counted */
+    if (row == 0) {
+        HISTORY_STORE(&block->first_timestamp, timestamp);
+    }
+    HISTORY_STORE(&block->last_timestamp, timestamp);
+    HISTORY_STORE_RELEASE(&block->row_count, row + 1);
+    return MODBUS_CONV_OK;
+}
+
+int modbus_history_sync(modbus_history_t *history)
+{
+    if (!history || !history->base) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    return msync(history->base, history->size, MS_SYNC) == 0 ? MODBUS_CONV_OK : MODBUS_CONV_ERR_SYSTEM;
+}
+
+int modbus_history_scan(const modbus_history_t *history,
+                        uint32_t point,
+                        uint64_t from,
+                        uint64_t to,
+                        modbus_history_cursor_t *cursor,
+                        uint64_t *timestamps,
+                        modbus_value_t *values,
+                        size_t max_samples,
+                        size_t *count)
+{
+    size_t width;
+    size_t n = 0;
+    uint64_t blocks;
+    uint64_t b;
+    uint64_t row;
+
+    if (!history || !history->base || !timestamps || !values || !count) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    *count = 0;
+    if (point >= history->point_count) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    width = value_width((modbus_data_type_t)history->types[point]);
+    blocks = visible_blocks(history);
+
+    /* Resume at the cursor unless the range starts further on */
+    b = first_block(history, from);
+    row = 0;
+    if (cursor && cursor->block >= b) {
+        b = cursor->block;
+        row = cursor->row;
+    }
+
+    for (; b < blocks; b++, row = 0) {
+        uint8_t *base = block_base(history, b);
+        modbus_history_block_t *block = (modbus_history_block_t *)(void *)base;
+        uint64_t rows = HISTORY_LOAD_ACQUIRE(&block->row_count);
+        const uint64_t *ts = timestamp_column(history, base);
+        const uint64_t *column = value_column(history, base, point);
+        const uint64_t *valid = validity_bitmap(history, base, point);
+
+        if (rows == 0 || HISTORY_LOAD(&block->first_timestamp) >= to) {
+            break;
+        }
+        for (; row < rows; row++) {
+            if (ts[row] >= to) {
+                break;
+            }
+            if (ts[row] < from || !(valid[row / 64] >> (row % 64) & 1)) {
+                continue;
+            }
+            if (n == max_samples) {
+                if (cursor) {
+                    cursor->block = b;
+                    cursor->row = row;
+                }
+                *count = n;
+                return MODBUS_CONV_ERR_BUFFER;
+            }
+            timestamps[n] = ts[row];
+            values[n].u64 = 0;
+            memcpy(&values[n], &column[row], width);
+            n++;
+        }
+        if (row < rows) {
+            break;
+        }
+    }
+
+    *count = n;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_history_aggregate(const modbus_history_t *history,
+                             uint32_t point,
+                             uint64_t from,
+                             uint64_t to,
+                             modbus_history_stats_t *out)
+{
+    modbus_data_type_t data_type;
+    size_t width;
+    uint64_t blocks;
+    uint64_t b;
+
+    if (!history || !history->base || !out) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    memset(out, 0, sizeof(*out));
+    if (point >= history->point_count) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    data_type = (modbus_data_type_t)history->types[point];
+    width = value_width(data_type);
+    blocks = visible_blocks(history);
+
+    for (b = first_block(history, from); b < blocks; b++) {
+        uint8_t *base = block_base(history, b);
+        modbus_history_block_t *block = (modbus_history_block_t *)(void *)base;
+        uint64_t rows = HISTORY_LOAD_ACQUIRE(&block->row_count);
+        const uint64_t *ts;
+        const uint64_t *column;
+        const uint64_t *valid;
+        uint64_t row;
+
+        if (rows == 0 || HISTORY_LOAD(&block->first_timestamp) >= to) {
+            break;
+        }
+        /* Only full blocks have final statistics; the one being written is read row by row */
+        if (rows == history->block_rows && HISTORY_LOAD(&block->first_timestamp) >= from &&
+            HISTORY_LOAD(&block->last_timestamp) < to) {
+            stats_merge(out, &block_stats(history, base)[point]);
+            continue;
+        }
+
+        ts = timestamp_column(history, base);
+        column = value_column(history, base, point);
+        valid = validity_bitmap(history, base, point);
+        for (row = 0; row < rows; row++) {
+            modbus_value_t value;
+            double d;
+
+            if (ts[row] >= to) {
+                break;
+            }
+            if (ts[row] < from || !(valid[row / 64] >> (row % 64) & 1)) {
+                continue;
+            }
+            value.u64 = 0;
+            memcpy(&value, &column[row], width);
+            d = modbus_value_to_double(data_type, &value);
+            if (isfinite(d)) {
+                stats_add(out, d);
+            }
+        }
+    }
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+static size_t block_bytes(uint32_t point_count, uint32_t block_rows)
+{
+    size_t words = ((size_t)block_rows + 63) / 64;
+
+    return sizeof(modbus_history_block_t) +
+           (size_t)point_count * sizeof(modbus_history_stats_t) +
+           (size_t)block_rows * sizeof(uint64_t) +
+           (size_t)point_count * block_rows * sizeof(uint64_t) +
+           (size_t)point_count * words * sizeof(uint64_t);
+}
+
+/* Header and type table, rounded up to a cache line */
+static size_t data_offset(uint32_t point_count)
+{
+    size_t end = sizeof(modbus_history_header_t) + (size_t)point_count * sizeof(uint32_t);
+    return (end + MODBUS_CACHE_LINE - 1) / MODBUS_CACHE_LINE * MODBUS_CACHE_LINE;
+}
+
+static int map_file(modbus_history_t *history, size_t size)
+{
+    int prot = history->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *base = mmap(NULL, size, prot, MAP_SHARED, history->fd, 0);
+
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    history->base = base;
+    history->size = size;
+    history->header = (modbus_history_header_t *)base;
+    history->types = (const uint32_t *)(const void *)(history->header + 1);
+    if (size >= sizeof(modbus_history_header_t) && history->block_size) {
+        history->capacity = (size - data_offset(history->point_count)) / history->block_size;
+    }
+    return 0;
+}
+
+/* Doubles the file; the old mapping is dropped only once the new one exists */
+static int grow_file(modbus_history_t *history)
+{
+    void *old_base = history->base;
+    size_t old_size = history->size;
+    size_t size = data_offset(history->point_count) + (size_t)history->capacity * 2 * history->block_size;
+
+    if (ftruncate(history->fd, (off_t)size) != 0 || map_file(history, size) != 0) {
+        return -1;
+    }
+    munmap(old_base, old_size);
+    return 0;
+}
+
+static uint8_t *block_base(const modbus_history_t *history, uint64_t block)
+{
+    return (uint8_t *)history->base + history->header->data_offset + block * history->block_size;
+}
+
+static modbus_history_stats_t *block_stats(const modbus_history_t *history, uint8_t *block)
+{
+    (void)history;
+    return (modbus_history_stats_t *)(void *)(block + sizeof(modbus_history_block_t));
+}
+
+static uint64_t *timestamp_column(const modbus_history_t *history, uint8_t *block)
+{
+    return (uint64_t *)(void *)(block_stats(history, block) + history->point_count);
+}
+
+static uint64_t *value_column(const modbus_history_t *history, uint8_t *block, uint32_t point)
+{
+    return timestamp_column(history, block) + (size_t)history->block_rows * (1 + (size_t)point);
+}
+
+static uint64_t *validity_bitmap(const modbus_history_t *history, uint8_t *block, uint32_t point)
+{
+    size_t words = ((size_t)history->block_rows + 63) / 64;
+    return value_column(history, block, history->point_count) + words * point;
+}
+
+/* First block whose last timestamp is not before from */
+static uint64_t first_block(const modbus_history_t *history, uint64_t from)
+{
+    uint64_t lo = 0;
+    uint64_t hi = visible_blocks(history);
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        modbus_history_block_t *block = (modbus_history_block_t *)(void *)block_base(history, mid);
+
+        if (HISTORY_LOAD(&block->last_timestamp) < from) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Blocks a reader can see: a writer may have grown the file past this mapping */
+static uint64_t visible_blocks(const modbus_history_t *history)
+{
+    uint64_t count = HISTORY_LOAD_ACQUIRE(&history->header->block_count);
+    return count < history->capacity ? count : history->capacity;
+}
+
+static void stats_add(modbus_history_stats_t *stats, double value)
+{
+    if (stats->count == 0 || value < stats->min) {
+        stats->min = value;
+    }
+    if (stats->count == 0 || value > stats->max) {
+        stats->max = value;
+    }
+    stats->sum += value;
+    stats->count++;
+}
+
+static void stats_merge(modbus_history_stats_t *stats, const modbus_history_stats_t *other)
+{
+    if (other->count == 0) {
+        return;
+    }
+    if (stats->count == 0 || other->min < stats->min) {
+        stats->min = other->min;
+    }
+    if (stats->count == 0 || other->max > stats->max) {
+        stats->max = other->max;
+    }
+    stats->sum += other->sum;
+    stats->count += other->count;
+}
+
+/* Bytes of modbus_value_t holding a value of the given type */
+static size_t value_width(modbus_data_type_t data_type)
+{
+    switch (data_type) {
+        case MODBUS_BIT_BOOLEAN:
+            return sizeof(bool);
+        case MODBUS_INT8_SIGNED:
+        case MODBUS_INT8_UNSIGNED:
+            return 1;
+        default:
+            break;
+    }
+    return 2 * modbus_type_reg_count(data_type);
+}
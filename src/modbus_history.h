@@ -0,0 +1,188 @@
+/**
+ * @file modbus_history.h
+ * @brief Memory-mapped columnar history file
+ * @details Append-only file of plan results, mapped into memory. Rows are
+ *          grouped into fixed-size blocks; inside a block every point has its
+ *          own value column and validity bitmap next to a shared timestamp
+ *          column. Each block header records its time range and per-point
+ *          min/max/sum/count, so range queries binary-search the first block
+ *          and aggregations read whole blocks from their statistics alone.
+ *          Values are stored in host byte order; the file is meant for local
+ *          persistence across restarts, not for exchange.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_HISTORY_H
+#define MODBUS_HISTORY_H
+
+#include "modbus_plan.h"
+#include "modbus_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* File identification */
+#define MODBUS_HISTORY_MAGIC            0x4D424846u    /* "MBHF" */
+#define MODBUS_HISTORY_VERSION          1
+
+/* File header, one cache line; followed by point_count uint32 data types */
+typedef struct {
+    uint32_t magic;                 /* MODBUS_HISTORY_MAGIC */
+    uint32_t version;               /* MODBUS_HISTORY_VERSION */
+    uint32_t point_count;           /* Value columns per block */
+    uint32_t block_rows;            /* Rows per block */
+    uint64_t block_size;            /* Bytes per block */
+    uint64_t block_count;           /* Blocks holding rows (the last may be partial) */
+    uint64_t data_offset;           /* File offset of the first block */
+    uint8_t reserved[MODBUS_CACHE_LINE - 40];
+} modbus_history_header_t;
+
+/* Block header */
+typedef struct {
+    uint64_t row_count;             /* Rows written to the block */
+    uint64_t first_timestamp;       /* Timestamp of the first row */
+    uint64_t last_timestamp;        /* Timestamp of the last row */
+    uint64_t reserved;
+} modbus_history_block_t;
+
+/* Per-point statistics of a block or a query, over valid finite values */
+typedef struct {
+    double min;
+    double max;
+    double sum;
+    uint64_t count;
+} modbus_history_stats_t;
+
+/* Scan position, zero-initialized for a new scan */
+typedef struct {
+    uint64_t block;                 /* Block of the next row */
+    uint64_t row;                   /* Next row in the block */
+} modbus_history_cursor_t;
+
+/* Open history file */
+typedef struct {
+    int fd;                         /* File descriptor */
+    bool writable;                  /* Opened for appending */
+    void *base;                     /* Mapping address */
+    size_t size;                    /* Mapping size */
+    modbus_history_header_t *header;
+    const uint32_t *types;          /* Data type of every point */
+    uint32_t point_count;
+    uint32_t block_rows;
+    size_t block_size;
+    uint64_t capacity;              /* Blocks that fit in the mapping */
+} modbus_history_t;
+
+/**
+ * @brief Create (or truncate) a history file for the points of a plan
+ * @param history Handle to initialize
+ * @param path File path
+ * @param plan Plan whose results will be appended
+ * @param block_rows Rows per block (e.g. 1024)
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if block_rows
+ *         is 0, MODBUS_CONV_ERR_SYSTEM on failure (errno is set)
+ */
+int modbus_history_create(modbus_history_t *history,
+                          const char *path,
+                          const modbus_plan_t *plan,
+                          uint32_t block_rows);
+
+/**
+ * @brief Open an existing history file
+ * @param history Handle to initialize
+ * @param path File path
+ * @param writable Open for appending
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_SYSTEM on failure or if the
+ *         file is not a valid history file, e.g. a block holds more rows than
+ *         block_rows (errno is set)
+ */
+int modbus_history_open(modbus_history_t *history, const char *path, bool writable);
+
+/**
+ * @brief Unmap and close a history file
+ * @param history Handle
+ */
+void modbus_history_close(modbus_history_t *history);
+
+/**
+ * @brief Append the results of one plan execution as a row
+ * @details Failed points are stored as nulls. The file grows as needed.
+ * @param history Writable handle
+ * @param plan Plan the values were produced with
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Row timestamp, not earlier than the previous row
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if the plan
+ *         point count or data types do not match the file or the timestamp
+ *         goes backwards,
+ *         MODBUS_CONV_ERR_SYSTEM if the file cannot grow (errno is set)
+ */
+int modbus_history_append(modbus_history_t *history,
+                          const modbus_plan_t *plan,
+                          const modbus_value_t *values,
+                          const int *status,
+                          uint64_t timestamp);
+
+/**
+ * @brief Flush appended rows to disk
+ * @param history Writable handle
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_SYSTEM on failure (errno is set)
+ */
+int modbus_history_sync(modbus_history_t *history);
+
+/**
+ * @brief Read the valid values of one point with from <= timestamp < to
+ * @details When more values match than fit, the first max_samples are
+ *          returned and cursor is set to the next row; scan again with the
+ *          same range and cursor to continue, rows sharing a timestamp
+ *          included. A reader sees the blocks that fit its mapping; reopen
+ *          the file to see blocks the writer added after growing it. Rows
+ *          appended by a writer in another process become visible once
+ *          complete.
+ * @param history Handle
+ * @param point Point index
+ * @param from First timestamp of the range
+ * @param to End of the range (exclusive)
+ * @param cursor Resume position, zero for a new scan; may be NULL
+ * @param timestamps Array receiving row timestamps
+ * @param values Array receiving values
+ * @param max_samples Capacity of both arrays
+ * @param count Pointer to store the number of values returned
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if more values
+ *         remain, MODBUS_CONV_ERR_INVALID_TYPE if point is out of range
+ */
+int modbus_history_scan(const modbus_history_t *history,
+                        uint32_t point,
+                        uint64_t from,
+                        uint64_t to,
+                        modbus_history_cursor_t *cursor,
+                        uint64_t *timestamps,
+                        modbus_value_t *values,
+                        size_t max_samples,
+                        size_t *count);
+
+/**
+ * @brief Aggregate one point over from <= timestamp < to
+ * @details Blocks entirely inside the range are answered from their
+ *          statistics; only the blocks at the range edges are read row by row.
+ *          Like modbus_history_scan(), only blocks inside the mapping are read.
+ * @param history Handle
+ * @param point Point index
+ * @param from First timestamp of the range
+ * @param to End of the range (exclusive)
+ * @param out Receives min, max, sum and count (all zero if no values match)
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if point is out of range
+ */
+int modbus_history_aggregate(const modbus_history_t *history,
+                             uint32_t point,
+                             uint64_t from,
+                             uint64_t to,
+                             modbus_history_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_HISTORY_H */
@@ -0,0 +1,120 @@
+/**
+ * @file modbus_json.c
+ * @brief JSON serialization implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_json.h"
+#include "modbus_format.h"
+#include <string.h>
+
+/* Helper function prototypes */
+static size_t put_raw(char *dst, const char *src, size_t n);
+static size_t put_string(char *dst, const char *s);
+static size_t put_value(char *dst, modbus_data_type_t data_type, const modbus_value_t *value);
+
+int modbus_json_write_batch(char *buf,
+                            size_t size,
+                            size_t *len,
+                            const modbus_plan_t *plan,
+                            const modbus_value_t *values,
+                            const int *status,
+                            const char *const *names,
+                            uint64_t timestamp)
+{
+    size_t pos = 0;
+    size_t i;
+
+    if (!buf || !len || !plan || !values) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    /* Header: {"device":<u32>,"ts":<u64>,"values":{ */
+    if (size < 64) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    pos += put_raw(buf + pos, "{\"device\":", 10);
+    pos += modbus_format_u64(plan->device_id, buf + pos);
+    if (timestamp) {
+        pos += put_raw(buf + pos, ",\"ts\":", 6);
+        pos += modbus_format_u64(timestamp, buf + pos);
+    }
+    pos += put_raw(buf + pos, ",\"values\":", 10);
+    buf[pos++] = names ? '{' : '[';
+
+    for (i = 0; i < plan->point_count; i++) {
+        /* Worst case: escaped name, quotes, colon, comma and the value */
+        size_t need = MODBUS_FORMAT_MAX + 4 + (names ? 6 * strlen(names[i]) : 0);
+        if (size - pos < need) {
+            return MODBUS_CONV_ERR_BUFFER;
+        }
+
+        if (i > 0) {
+            buf[pos++] = ',';
+        }
+        if (names) {
+            pos += put_string(buf + pos, names[i]);
+            buf[pos++] = ':';
+        }
+        if (status && status[i] != MODBUS_CONV_OK) {
+            pos += put_raw(buf + pos, "null", 4);
+        } else {
+            pos += put_value(buf + pos, plan->points[i].data_type, &values[i]);
+        }
+    }
+
+    /* Closing bracket, brace and terminator */
+    if (size - pos < 3) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    buf[pos++] = names ? '}' : ']';
+    buf[pos++] = '}';
+    buf[pos] = '\0';
+
+    *len = pos;
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+static size_t put_raw(char *dst, const char *src, size_t n)
+{
+    memcpy(dst, src, n);
+    return n;
+}
+
+static size_t put_string(char *dst, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t pos = 0;
+
+    dst[pos++] = '"';
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            dst[pos++] = (char)c;
+        } else if (c == '"' || c == '\\') {
+            dst[pos++] = '\\';
+            dst[pos++] = (char)c;
+        } else {
+            dst[pos++] = '\\';
+            dst[pos++] = 'u';
+            dst[pos++] = '0';
+            dst[pos++] = '0';
+            dst[pos++] = hex[c >> 4];
+            dst[pos++] = hex[c & 0xF];
+        }
+    }
+    dst[pos++] = '"';
+    return pos;
+}
+
+static size_t put_value(char *dst, modbus_data_type_t data_type, const modbus_value_t *value)
+{
+    size_t n = modbus_format_value(data_type, value, dst);
+
+    /* JSON has no NaN/Infinity literals */
+    if (n == 0 || dst[n - 1] == 'N' || dst[n - 1] == 'y') {
+        return put_raw(dst, "null", 4);
+    }
+    return n;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file modbus_json.h
+ * @brief JSON serialization of batch conversion results
+ * @details Writes plan execution results into a caller buffer in one pass
+ *          without allocation, using the shortest round-trip float formatting
+ *          and integer fast paths of modbus_format.h.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_JSON_H
+#define MODBUS_JSON_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Serialize the values of one plan execution as a JSON object
+ * @details Produces {"device":17,"ts":1700000000000,"values":{...}} with one
+ *          member per point when names are given, or a "values" array in point
+ *          order otherwise. Failed points and non-finite floats are written as
+ *          null; "ts" is omitted when timestamp is 0.
+ * @param buf Output buffer (NUL-terminated on success)
+ * @param size Size of the output buffer
+ * @param len Pointer to store the written length (excluding terminator)
+ * @param plan Plan the values were produced with
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param names Per-point member names, may be NULL
+ * @param timestamp Frame timestamp (e.g. Unix milliseconds), 0 to omit
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf is too small
+ */
+int modbus_json_write_batch(char *buf,
+                            size_t size,
+                            size_t *len,
+                            const modbus_plan_t *plan,
+                            const modbus_value_t *values,
+                            const int *status,
+                            const char *const *names,
+                            uint64_t timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_JSON_H */
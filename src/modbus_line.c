@@ -0,0 +1,325 @@
+/**
+ * @file modbus_line.c
+ * @brief InfluxDB line protocol and CSV writer implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_line.h"
+#include "modbus_format.h"
+#include <math.h>
+#include <string.h>
+
+/* Characters escaped with a backslash in line protocol */
+#define LP_MEASUREMENT_SPECIALS ", "
+#define LP_KEY_SPECIALS         ",= "
+
+/* Key storage cursor */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} line_keys_t;
+
+/* Helper function prototypes */
+static void keys_put(line_keys_t *k, const char *s, size_t n);
+static void keys_escaped(line_keys_t *k, const char *s, const char *specials);
+static void keys_csv(line_keys_t *k, const char *s);
+static void keys_name(line_keys_t *k, const char *const *names, size_t index, modbus_line_format_t format);
+static size_t put_field(char *dst, modbus_data_type_t data_type, const modbus_value_t *value);
+
+int modbus_line_init(modbus_line_writer_t *writer,
+                     modbus_line_format_t format,
+                     const modbus_plan_t *plan,
+                     const char *measurement,
+                     const modbus_line_tag_t *tags,
+                     size_t tag_count,
+                     const char *const *names,
+                     char *storage,
+                     size_t storage_size)
+{
+    line_keys_t k;
+    char device[MODBUS_FORMAT_MAX];
+    size_t device_len;
+    size_t i;
+
+    if (!writer || !plan || !storage || (tag_count && !tags) ||
+        (format == MODBUS_LINE_PROTOCOL && !measurement)) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (format != MODBUS_LINE_PROTOCOL && format != MODBUS_LINE_CSV) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    k.buf = storage;
+    k.size = storage_size;
+    k.len = 0;
+    k.overflow = false;
+    device_len = modbus_format_u64(plan->device_id, device);
+
+    /* Head: "measurement,a=1,device=17,z=2 " or "17,value,..."; the device
+     * tag goes before the first tag key that sorts after it */
+    if (format == MODBUS_LINE_PROTOCOL) {
+        bool device_done = false;
+
+        keys_escaped(&k, measurement, LP_MEASUREMENT_SPECIALS);
+        for (i = 0; i < tag_count; i++) {
+            if (!device_done && strcmp(tags[i].key, "device") > 0) {
+                keys_put(&k, ",device=", 8);
+                keys_put(&k, device, device_len);
+                device_done = true;
+            }
+            keys_put(&k, ",", 1);
+            keys_escaped(&k, tags[i].key, LP_KEY_SPECIALS);
+            keys_put(&k, "=", 1);
+            keys_escaped(&k, tags[i].value, LP_KEY_SPECIALS);
+        }
+        if (!device_done) {
+            keys_put(&k, ",device=", 8);
+            keys_put(&k, device, device_len);
+        }
+        keys_put(&k, " ", 1);
+    } else {
+        keys_put(&k, device, device_len);
+        for (i = 0; i < tag_count; i++) {
+            keys_put(&k, ",", 1);
+            keys_csv(&k, tags[i].value);
+        }
+    }
+    writer->head_len = k.len;
+
+    /* CSV tag columns for the header row */
+    if (format == MODBUS_LINE_CSV) {
+        keys_put(&k, "time,device", 11);
+        for (i = 0; i < tag_count; i++) {
+            keys_put(&k, ",", 1);
+            keys_csv(&k, tags[i].key);
+        }
+    }
+    writer->columns_len = k.len - writer->head_len;
+
+    /* Point keys: one length byte, then "name=" or the CSV column name */
+    for (i = 0; i < plan->point_count; i++) {
+        size_t at = k.len;
+        size_t key_len;
+
+        keys_put(&k, "", 1);
+        keys_name(&k, names, i, format);
+        if (format == MODBUS_LINE_PROTOCOL) {
+            keys_put(&k, "=", 1);
+        }
+        if (k.overflow) {
+            break;
+        }
+        key_len = k.len - at - 1;
+        if (key_len > MODBUS_LINE_MAX_KEY) {
+            return MODBUS_CONV_ERR_BUFFER;
+        }
+        storage[at] = (char)key_len;
+    }
+
+    if (k.overflow) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    writer->plan = plan;
+    writer->format = format;
+    writer->keys = storage;
+    writer->keys_len = k.len;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_line_header(const modbus_line_writer_t *writer, char *buf, size_t size, size_t *len)
+{
+    const char *key;
+    size_t pos;
+    size_t i;
+
+    if (!writer || !buf || !len) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (writer->format != MODBUS_LINE_CSV) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    pos = *len;
+    if (pos > size || size - pos < writer->keys_len + 2) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    memcpy(buf + pos, writer->keys + writer->head_len, writer->columns_len);
+    pos += writer->columns_len;
+    key = writer->keys + writer->head_len + writer->columns_len;
+    for (i = 0; i < writer->plan->point_count; i++) {
+        size_t key_len = (unsigned char)*key++;
+        buf[pos++] = ',';
+        memcpy(buf + pos, key, key_len);
+        pos += key_len;
+        key += key_len;
+    }
+    buf[pos++] = '\n';
+    buf[pos] = '\0';
+
+    *len = pos;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_line_write(const modbus_line_writer_t *writer,
+                      char *buf,
+                      size_t size,
+                      size_t *len,
+                      const modbus_value_t *values,
+                      const int *status,
+                      uint64_t timestamp)
+{
+    const modbus_point_t *points;
+    const char *key;
+    size_t fields = 0;
+    size_t pos;
+    size_t i;
+
+    if (!writer || !buf || !len || !values) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    pos = *len;
+    /* Head plus, for CSV, the leading timestamp column */
+    if (pos > size || size - pos < writer->head_len + MODBUS_FORMAT_MAX + 1) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    if (writer->format == MODBUS_LINE_CSV) {
+        pos += modbus_format_u64(timestamp, buf + pos);
+        buf[pos++] = ',';
+    }
+    memcpy(buf + pos, writer->keys, writer->head_len);
+    pos += writer->head_len;
+
+    points = writer->plan->points;
+    key = writer->keys + writer->head_len + writer->columns_len;
+    for (i = 0; i < writer->plan->point_count; i++) {
+        size_t key_len = (unsigned char)*key++;
+        bool ok = !status || status[i] == MODBUS_CONV_OK;
+
+        /* Worst case: separator, key, value, integer suffix */
+        if (size - pos < key_len + MODBUS_FORMAT_MAX + 2) {
+            buf[*len] = '\0';
+            return MODBUS_CONV_ERR_BUFFER;
+        }
+
+        if (writer->format == MODBUS_LINE_CSV) {
+            buf[pos++] = ',';
+            if (ok) {
+                pos += modbus_format_value(points[i].data_type, &values[i], buf + pos);
+            }
+        } else if (ok) {
+            /* Format the value in place first, the key goes in front of it */
+            size_t sep = fields ? 1 : 0;
+            size_t n = put_field(buf + pos + sep + key_len, points[i].data_type, &values[i]);
+            if (n > 0) {
+                if (sep) {
+                    buf[pos] = ',';
+                }
+                memcpy(buf + pos + sep, key, key_len);
+                pos += sep + key_len + n;
+                fields++;
+            }
+        }
+        key += key_len;
+    }
+
+    /* Line protocol requires at least one field; the partial line is dropped */
+    if (writer->format == MODBUS_LINE_PROTOCOL && fields == 0) {
+        buf[*len] = '\0';
+        return MODBUS_CONV_OK;
+    }
+
+    /* Timestamp, newline and terminator */
+    if (size - pos < MODBUS_FORMAT_MAX + 2) {
+        buf[*len] = '\0';
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    if (writer->format == MODBUS_LINE_PROTOCOL && timestamp) {
+        buf[pos++] = ' ';
+        pos += modbus_format_u64(timestamp, buf + pos);
+    }
+    buf[pos++] = '\n';
+    buf[pos] = '\0';
+
+    *len = pos;
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+static void keys_put(line_keys_t *k, const char *s, size_t n)
+{
+    if (k->overflow || k->size - k->len < n) {
+        k->overflow = true;
+        return;
+    }
+    memcpy(k->buf + k->len, s, n);
+    k->len += n;
+}
+
+static void keys_escaped(line_keys_t *k, const char *s, const char *specials)
+{
+    for (; *s; s++) {
+        if (strchr(specials, *s)) {
+            keys_put(k, "\\", 1);
+        }
+        keys_put(k, s, 1);
+    }
+}
+
+static void keys_csv(line_keys_t *k, const char *s)
+{
+    if (!s[strcspn(s, ",\"\r\n")]) {
+        keys_put(k, s, strlen(s));
+        return;
+    }
+    keys_put(k, "\"", 1);
+    for (; *s; s++) {
+        if (*s == '"') {
+            keys_put(k, "\"", 1);
+        }
+        keys_put(k, s, 1);
+    }
+    keys_put(k, "\"", 1);
+}
+
+static void keys_name(line_keys_t *k, const char *const *names, size_t index, modbus_line_format_t format)
+{
+    char generated[MODBUS_FORMAT_MAX + 1];
+
+    if (names) {
+        if (format == MODBUS_LINE_PROTOCOL) {
+            keys_escaped(k, names[index], LP_KEY_SPECIALS);
+        } else {
+            keys_csv(k, names[index]);
+        }
+        return;
+    }
+    generated[0] = 'p';
+    keys_put(k, generated, 1 + modbus_format_u64(index, generated + 1));
+}
+
+/* Line protocol field value; 0 when the value cannot be represented */
+static size_t put_field(char *dst, modbus_data_type_t data_type, const modbus_value_t *value)
+{
+    size_t n;
+
+    if (data_type >= MODBUS_IEEE_FLOAT32_ABCD) {
+        double v = modbus_value_to_double(data_type, value);
+        if (isnan(v) || isinf(v)) {
+            return 0;
+        }
+        return modbus_format_value(data_type, value, dst);
+    }
+
+    n = modbus_format_value(data_type, value, dst);
+    if (n == 0 || data_type == MODBUS_BIT_BOOLEAN) {
+        return n;
+    }
+    dst[n++] = (data_type >= MODBUS_INT64_UNSIGNED_ABCDEFGH) ? 'u' : 'i';
+    return n;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file modbus_line.h
+ * @brief Streaming InfluxDB line protocol and CSV writers
+ * @details A writer is prepared once per plan: measurement, tag set, device
+ *          ID and point names are escaped and stored as ready-to-copy key
+ *          prefixes. Each frame is then appended to a reusable caller buffer
+ *          as one line (one timestamp per frame) in a single pass, without
+ *          allocation and without re-formatting any key.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_LINE_H
+#define MODBUS_LINE_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest escaped point name that can be stored */
+#define MODBUS_LINE_MAX_KEY             255
+
+/* Output formats */
+typedef enum {
+    MODBUS_LINE_PROTOCOL,           /* measurement,tags fields timestamp */
+    MODBUS_LINE_CSV                 /* time,device,tag values...,point values... */
+} modbus_line_format_t;
+
+/* Tag shared by every line of a writer */
+typedef struct {
+    const char *key;
+    const char *value;
+} modbus_line_tag_t;
+
+/* Prepared writer for one plan */
+typedef struct {
+    const modbus_plan_t *plan;      /* Plan the values are produced with */
+    modbus_line_format_t format;    /* Output format */
+    const char *keys;               /* Line head, CSV tag columns, then
+                                       length-prefixed point keys */
+    size_t head_len;                /* Length of the line head */
+    size_t columns_len;             /* Length of the CSV tag columns (0 for line protocol) */
+    size_t keys_len;                /* Total length of keys */
+} modbus_line_writer_t;
+
+/**
+ * @brief Prepare a writer and precompute its keys
+ * @details Line protocol lines start with "measurement,tag=value,...,device=17 "
+ *          and use "name=" per field; CSV rows start with the timestamp, device
+ *          ID and tag values. A device tag is always added from plan->device_id;
+ *          pass tags sorted by key (byte order, without a "device" key) for
+ *          best InfluxDB ingest performance, the device tag is placed in
+ *          order among them.
+ * @param writer Writer to initialize
+ * @param format Output format
+ * @param plan Compiled plan (must outlive the writer)
+ * @param measurement Measurement name (line protocol only, may be NULL for CSV)
+ * @param tags Tag set, may be NULL
+ * @param tag_count Number of tags
+ * @param names Per-point field/column names, NULL for "p0", "p1", ...
+ * @param storage Buffer receiving the precomputed keys (must outlive the writer)
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if storage is too
+ *         small or a name exceeds MODBUS_LINE_MAX_KEY once escaped
+ */
+int modbus_line_init(modbus_line_writer_t *writer,
+                     modbus_line_format_t format,
+                     const modbus_plan_t *plan,
+                     const char *measurement,
+                     const modbus_line_tag_t *tags,
+                     size_t tag_count,
+                     const char *const *names,
+                     char *storage,
+                     size_t storage_size);
+
+/**
+ * @brief Append the CSV header row ("time,device,<tag keys>,<names>")
+ * @param writer CSV writer
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ * @param len In: bytes already used in buf; out: bytes used after appending
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf is too small
+ *         (*len is left unchanged), MODBUS_CONV_ERR_INVALID_TYPE for
+ *         a line protocol writer
+ */
+int modbus_line_header(const modbus_line_writer_t *writer, char *buf, size_t size, size_t *len);
+
+/**
+ * @brief Append the values of one plan execution as one line
+ * @details Line protocol writes integers with an "i" suffix (64-bit unsigned
+ *          types with "u") and omits failed points and non-finite floats; no
+ *          line is written when no field remains, and the timestamp is omitted
+ *          when 0. CSV leaves failed points empty. Lines end with '\n' and buf
+ *          stays NUL-terminated.
+ * @param writer Prepared writer
+ * @param buf Output buffer, reused across frames
+ * @param size Size of the output buffer
+ * @param len In: bytes already used in buf; out: bytes used after appending
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Frame timestamp (line protocol: nanoseconds unless the
+ *        write precision says otherwise)
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if the line does
+ *         not fit (*len is left unchanged so the caller can flush and
+ *         retry)
+ */
+int modbus_line_write(const modbus_line_writer_t *writer,
+                      char *buf,
+                      size_t size,
+                      size_t *len,
+                      const modbus_value_t *values,
+                      const int *status,
+                      uint64_t timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_LINE_H */
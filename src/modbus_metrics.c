@@ -0,0 +1,164 @@
+/**
+ * @file modbus_metrics.c
+ * @brief OpenMetrics text exposition implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_metrics.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+/* Output cursor */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} metrics_out_t;
+
+/* Error code names, indexed by -error_code */
+static const char *const error_names[MODBUS_STATS_ERRORS] = {
+    "OK", "NULL_PTR", "INVALID_TYPE", "INVALID_BIT", "INSUFF_REGS", "UNKNOWN", "FRAME", "BUFFER",
+    "SYSTEM"
+};
+
+static const char *const span_names[MODBUS_TRACE_SPAN_COUNT] = {
+    "parse", "convert", "publish", "total"
+};
+
+static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+/* Helper function prototypes */
+static void out_printf(metrics_out_t *out, const char *fmt, ...);
+static void render_stats(metrics_out_t *out, const modbus_stats_t *stats);
+static void render_latency(metrics_out_t *out, const modbus_trace_recorder_t *latency);
+
+int modbus_metrics_render(char *buf,
+                          size_t size,
+                          size_t *len,
+                          const modbus_stats_t *stats,
+                          const modbus_trace_recorder_t *latency,
+                          const modbus_metrics_gauge_t *gauges,
+                          size_t gauge_count)
+{
+    metrics_out_t out;
+    size_t i;
+
+    if (!buf || !len || (!gauges && gauge_count > 0)) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    out.buf = buf;
+    out.size = size;
+    out.len = 0;
+    out.overflow = false;
+
+    if (stats) {
+        render_stats(&out, stats);
+    }
+    if (latency) {
+        render_latency(&out, latency);
+    }
+    for (i = 0; i < gauge_count; i++) {
+        out_printf(&out, "# TYPE %s gauge\n", gauges[i].name);
+        if (gauges[i].help) {
+            out_printf(&out, "# HELP %s %s\n", gauges[i].name, gauges[i].help);
+        }
+        if (isfinite(gauges[i].value)) {
+            out_printf(&out, "%s %.17g\n", gauges[i].name, gauges[i].value);
+        } else {
+            /* OpenMetrics spells non-finite values NaN, +Inf and -Inf */
+            out_printf(&out, "%s %s\n", gauges[i].name,
+                       isnan(gauges[i].value) ? "NaN" : gauges[i].value > 0 ? "+Inf" : "-Inf");
+        }
+    }
+    out_printf(&out, "# EOF\n");
+
+    if (out.overflow) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    *len = out.len;
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+static void out_printf(metrics_out_t *out, const char *fmt, ...)
+{
+    va_list args;
+    int n;
+
+    if (out->overflow) {
+        return;
+    }
+
+    va_start(args, fmt);
+    n = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+    va_end(args);
+
+    if (n < 0 || (size_t)n >= out->size - out->len) {
+        out->overflow = true;
+        return;
+    }
+    out->len += (size_t)n;
+}
+
+static void render_stats(metrics_out_t *out, const modbus_stats_t *stats)
+{
+    size_t i;
+
+    out_printf(out, "# TYPE modbus_conv_conversions counter\n"
+                    "# HELP modbus_conv_conversions Successful conversions per data type.\n");
+    for (i = 0; i < MODBUS_STATS_TYPES; i++) {
+        out_printf(out, "modbus_conv_conversions_total{type=\"%s\"} %llu\n",
+                   modbus_type_name((modbus_data_type_t)i),
+                   (unsigned long long)stats->conversions[i]);
+    }
+
+    out_printf(out, "# TYPE modbus_conv_errors counter\n"
+                    "# HELP modbus_conv_errors Failed conversions per MODBUS_CONV_ERR_* code.\n");
+    for (i = 1; i < MODBUS_STATS_ERRORS; i++) {
+        out_printf(out, "modbus_conv_errors_total{code=\"%s\"} %llu\n",
+                   error_names[i], (unsigned long long)stats->errors[i]);
+    }
+
+    out_printf(out, "# TYPE modbus_conv_scaling_overflows counter\n"
+                    "# HELP modbus_conv_scaling_overflows Scaled values saturated to the type range.\n"
+                    "modbus_conv_scaling_overflows_total %llu\n",
+               (unsigned long long)stats->scaling_overflows);
+    out_printf(out, "# TYPE modbus_conv_plans_executed counter\n"
+                    "# HELP modbus_conv_plans_executed Conversion plan executions.\n"
+                    "modbus_conv_plans_executed_total %llu\n",
+               (unsigned long long)stats->plans_executed);
+    out_printf(out, "# TYPE modbus_conv_frames_parsed counter\n"
+                    "# HELP modbus_conv_frames_parsed Frames decoded successfully.\n"
+                    "modbus_conv_frames_parsed_total %llu\n",
+               (unsigned long long)stats->frames_parsed);
+    out_printf(out, "# TYPE modbus_conv_frame_errors counter\n"
+                    "# HELP modbus_conv_frame_errors Frames rejected by the decoder.\n"
+                    "modbus_conv_frame_errors_total %llu\n",
+               (unsigned long long)stats->frame_errors);
+}
+
+static void render_latency(metrics_out_t *out, const modbus_trace_recorder_t *latency)
+{
+    size_t q;
+    int span;
+
+    out_printf(out, "# TYPE modbus_conv_latency_seconds summary\n"
+                    "# UNIT modbus_conv_latency_seconds seconds\n"
+                    "# HELP modbus_conv_latency_seconds Frame processing latency per stage.\n");
+    for (span = 0; span < MODBUS_TRACE_SPAN_COUNT; span++) {
+        const modbus_trace_hist_t *hist = &latency->spans[span];
+        for (q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            uint64_t ns = modbus_trace_percentile(latency, (modbus_trace_span_t)span,
+                                                  quantiles[q] * 100.0);
+            out_printf(out, "modbus_conv_latency_seconds{stage=\"%s\",quantile=\"%g\"} %.9g\n",
+                       span_names[span], quantiles[q], (double)ns * 1e-9);
+        }
+        out_printf(out, "modbus_conv_latency_seconds_sum{stage=\"%s\"} %.9g\n",
+                   span_names[span], (double)hist->sum * 1e-9);
+        out_printf(out, "modbus_conv_latency_seconds_count{stage=\"%s\"} %llu\n",
+                   span_names[span], (unsigned long long)hist->total);
+    }
+}
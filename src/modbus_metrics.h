@@ -0,0 +1,56 @@
+/**
+ * @file modbus_metrics.h
+ * @brief OpenMetrics (Prometheus) text exposition of library metrics
+ * @details Renders a stats snapshot, merged latency histograms and
+ *          application gauges into a caller buffer, ready to be served on a
+ *          /metrics endpoint. Rendering works on snapshots only and never
+ *          blocks converting threads.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_METRICS_H
+#define MODBUS_METRICS_H
+
+#include "modbus_stats.h"
+#include "modbus_trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Content type to serve the rendered text with */
+#define MODBUS_METRICS_CONTENT_TYPE \
+    "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+/* Application gauge (e.g. poll queue depth) */
+typedef struct {
+    const char *name;               /* Metric name, e.g. "modbus_poll_queue_depth" */
+    const char *help;               /* Help text, may be NULL */
+    double value;                   /* Current value */
+} modbus_metrics_gauge_t;
+
+/**
+ * @brief Render metrics in OpenMetrics text format
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ * @param len Pointer to store the rendered length (excluding terminator)
+ * @param stats Stats snapshot from modbus_stats_snapshot(), may be NULL
+ * @param latency Merged latency recorder from modbus_trace_merge(), may be NULL
+ * @param gauges Application gauges, may be NULL
+ * @param gauge_count Number of gauges
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf is too small
+ */
+int modbus_metrics_render(char *buf,
+                          size_t size,
+                          size_t *len,
+                          const modbus_stats_t *stats,
+                          const modbus_trace_recorder_t *latency,
+                          const modbus_metrics_gauge_t *gauges,
+                          size_t gauge_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_METRICS_H */
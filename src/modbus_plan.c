@@ -0,0 +1,393 @@
+/**
+ * @file modbus_plan.c
+ * @brief Batch conversion implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_plan.h"
+#include "modbus_trace.h"
+#include "modbus_probes.h"
+#include "modbus_stats.h"
+#include "modbus_profile.h"
+#include "modbus_agg.h"
+#include "modbus_calib.h"
+#include "modbus_units.h"
+#include <float.h>
+#include <string.h>
+
+#ifdef MODBUS_CONV_USDT
+/* Probe semaphores, incremented by the tracer while a probe is attached */
+#define PROBE_SEMAPHORE(name) \
+    __extension__ unsigned short modbus_conv_##name##_semaphore \
+    __attribute__((unused)) __attribute__((section(".probes")))
+PROBE_SEMAPHORE(batch__start);
+PROBE_SEMAPHORE(batch__end);
+PROBE_SEMAPHORE(plan__exec);
+PROBE_SEMAPHORE(conv__error);
+PROBE_SEMAPHORE(frame__parse_fail);
+#endif
+
+/* Helper function prototypes */
+static size_t plan_run(const modbus_plan_t *plan,
+                       const uint16_t *registers,
+                       modbus_value_t *values,
+                       int *status,
+                       modbus_agg_t *agg,
+                       uint64_t timestamp,
+                       int *first_error);
+static int convert_point(const modbus_point_t *point,
+                         const uint16_t *registers,
+                         modbus_value_t *value,
+                         bool *overflow);
+static uint8_t post_flags(const modbus_point_t *point);
+static bool store_saturated(modbus_data_type_t data_type, double scaled, modbus_value_t *value);
+static size_t value_width(modbus_data_type_t data_type);
+
+/* Plan compilation */
+int modbus_plan_compile(modbus_plan_t *plan,
+                        const modbus_point_t *points,
+                        size_t point_count,
+                        uint32_t device_id)
+{
+    size_t span = 0;
+    size_t i;
+
+    if (!plan || (!points && point_count > 0)) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    for (i = 0; i < point_count; i++) {
+        size_t width = modbus_type_reg_count(points[i].data_type);
+        if (width == 0) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+        if (points[i].data_type == MODBUS_BIT_BOOLEAN && points[i].bit_pos > 15) {
+            return MODBUS_CONV_ERR_INVALID_BIT;
+        }
+        if (points[i].calib && (points[i].data_type == MODBUS_BIT_BOOLEAN ||
+                                (points[i].calib->kind != MODBUS_CALIB_TABLE &&
+                                 points[i].calib->kind != MODBUS_CALIB_POLY))) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+        if (points[i].target_unit != MODBUS_UNIT_NONE && points[i].unit != points[i].target_unit) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+        if ((size_t)points[i].offset + width > span) {
+            span = (size_t)points[i].offset + width;
+        }
+    }
+
+    plan->points = points;
+    plan->point_count = point_count;
+    plan->reg_span = span;
+    plan->device_id = device_id;
+    return MODBUS_CONV_OK;
+}
+
+/* Plan execution */
+int modbus_plan_execute(const modbus_plan_t *plan,
+                        const uint16_t *registers,
+                        size_t reg_count,
+                        modbus_value_t *values,
+                        int *status)
+{
+    return modbus_plan_execute_agg(plan, registers, reg_count, values, status, NULL, 0);
+}
+
+int modbus_plan_execute_agg(const modbus_plan_t *plan,
+                            const uint16_t *registers,
+                            size_t reg_count,
+                            modbus_value_t *values,
+                            int *status,
+                            modbus_agg_t *agg,
+                            uint64_t timestamp)
+{
+    uint64_t start = 0;
+    bool traced;
+    size_t errors;
+    int first_error = MODBUS_CONV_OK;
+
+    if (!plan || !registers || !values) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (reg_count < plan->reg_span) {
+        MODBUS_STATS_ADD(modbus_stats_local(), errors[-MODBUS_CONV_ERR_INSUFF_REGS], 1);
+        return MODBUS_CONV_ERR_INSUFF_REGS;
+    }
+    if (agg && agg->point_count < plan->point_count) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    /* Read once: a tracer attaching mid-call must not see a zero start */
+    traced = MODBUS_PROBE_ENABLED(plan__exec);
+    if (traced) {
+        start = modbus_trace_now();
+    }
+
+    if (agg) {
+        modbus_agg_begin(agg, timestamp);
+    }
+    errors = plan_run(plan, registers, values, status, agg, timestamp, &first_error);
+
+    if (traced) {
+        MODBUS_PROBE4(plan__exec, plan->device_id, plan->point_count, errors,
+                      modbus_trace_now() - start);
+    }
+    (void)start;
+    (void)errors;
+
+    return first_error;
+}
+
+/* Batch execution */
+int modbus_batch_execute(modbus_batch_item_t *items, size_t item_count)
+{
+    uint64_t start = 0;
+    bool traced;
+    size_t errors = 0;
+    int first_error = MODBUS_CONV_OK;
+    size_t i;
+
+    if (!items) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    if (MODBUS_PROBE_ENABLED(batch__start)) {
+        size_t points = 0;
+        for (i = 0; i < item_count; i++) {
+            points += items[i].plan ? items[i].plan->point_count : 0;
+        }
+        MODBUS_PROBE2(batch__start, item_count, points);
+    }
+    traced = MODBUS_PROBE_ENABLED(batch__end);
+    if (traced) {
+        start = modbus_trace_now();
+    }
+
+    for (i = 0; i < item_count; i++) {
+        items[i].result = modbus_plan_execute_agg(items[i].plan, items[i].registers,
+                                                  items[i].reg_count, items[i].values,
+                                                  items[i].status, items[i].agg,
+                                                  items[i].timestamp);
+        if (items[i].result != MODBUS_CONV_OK) {
+            errors++;
+            if (first_error == MODBUS_CONV_OK) {
+                first_error = items[i].result;
+            }
+        }
+    }
+
+    if (traced) {
+        MODBUS_PROBE3(batch__end, item_count, errors, modbus_trace_now() - start);
+    }
+    (void)start;
+    (void)errors;
+
+    return first_error;
+}
+
+/* Change detection */
+size_t modbus_plan_changes(const modbus_plan_t *plan,
+                           modbus_value_t *last,
+                           int *last_status,
+                           const modbus_value_t *values,
+                           const int *status,
+                           uint32_t first,
+                           uint32_t *changed)
+{
+    size_t count = 0;
+    size_t i;
+
+    if (!plan || !last || !last_status || !values || !changed) {
+        return 0;
+    }
+
+    for (i = 0; i < plan->point_count; i++) {
+        int st = status ? status[i] : MODBUS_CONV_OK;
+
+        if (st == last_status[i] &&
+            (st != MODBUS_CONV_OK ||
+             memcmp(&values[i], &last[i], value_width(plan->points[i].data_type)) == 0)) {
+            continue;
+        }
+        last[i] = values[i];
+        last_status[i] = st;
+        changed[count++] = first + (uint32_t)i;
+    }
+    return count;
+}
+
+/* Helper function implementations */
+static size_t plan_run(const modbus_plan_t *plan,
+                       const uint16_t *registers,
+                       modbus_value_t *values,
+                       int *status,
+                       modbus_agg_t *agg,
+                       uint64_t timestamp,
+                       int *first_error)
+{
+    const modbus_point_t *p = plan->points;
+    modbus_stats_t *stats = modbus_stats_local();
+    modbus_profile_t *prof = modbus_profile_local();
+    size_t errors = 0;
+    size_t i;
+
+    for (i = 0; i < plan->point_count; i++) {
+        bool overflow = false;
+        int rc;
+
+        if (prof && --prof->countdown == 0) {
+            uint64_t t0 = modbus_profile_ticks();
+            rc = convert_point(&p[i], registers + p[i].offset, &values[i], &overflow);
+            modbus_profile_add(prof, plan->device_id, &p[i], post_flags(&p[i]), modbus_profile_ticks() - t0);
+            prof->countdown = prof->interval;
+        } else {
+            rc = convert_point(&p[i], registers + p[i].offset, &values[i], &overflow);
+        }
+        if (status) {
+            status[i] = rc;
+        }
+        if (rc == MODBUS_CONV_OK) {
+            MODBUS_STATS_ADD(stats, conversions[p[i].data_type], 1);
+            if (overflow) {
+                MODBUS_STATS_ADD(stats, scaling_overflows, 1);
+            }
+            if (agg) {
+                modbus_agg_add(agg, i, modbus_value_to_double(p[i].data_type, &values[i]), timestamp);
+            }
+        } else {
+            MODBUS_PROBE4(conv__error, plan->device_id, i, p[i].data_type, rc);
+            MODBUS_STATS_ADD(stats, errors[-rc], 1);
+            if (errors++ == 0) {
+                *first_error = rc;
+            }
+        }
+    }
+    MODBUS_STATS_ADD(stats, plans_executed, 1);
+    (void)stats;
+
+    return errors;
+}
+
+static int convert_point(const modbus_point_t *point,
+                         const uint16_t *registers,
+                         modbus_value_t *value,
+                         bool *overflow)
+{
+    modbus_data_type_t type = point->data_type;
+    double scale = point->scaling_factor;
+    double result;
+    int rc;
+
+    /* Only magnifying or sign-flipping scales can leave the type range */
+    if (!point->calib && point->value_offset == 0.0 &&
+        ((scale <= 1.0 && scale >= 0.0) || type == MODBUS_BIT_BOOLEAN ||
+         type >= MODBUS_IEEE_FLOAT64_ABCDEFGH)) {
+        return modbus_convert(registers, modbus_type_reg_count(type), type,
+                              point->bit_pos, scale, value);
+    }
+
+    rc = modbus_convert(registers, modbus_type_reg_count(type), type,
+                        point->bit_pos, 1.0, value);
+    if (rc != MODBUS_CONV_OK) {
+        return rc;
+    }
+    result = modbus_value_to_double(type, value) * scale + point->value_offset;
+    if (point->calib) {
+        result = modbus_calib_eval(point->calib, result);
+    }
+    if (type >= MODBUS_IEEE_FLOAT64_ABCDEFGH) {
+        value->f64 = result;
+    } else {
+        *overflow = store_saturated(type, result, value);
+    }
+    return rc;
+}
+
+/* Post-processing stages run by convert_point(), for the profiler */
+static uint8_t post_flags(const modbus_point_t *point)
+{
+    uint8_t post = 0;
+
+    if (point->calib) {
+        post |= point->calib->kind == MODBUS_CALIB_TABLE ? MODBUS_PROFILE_POST_CALIB_TABLE
+                                                         : MODBUS_PROFILE_POST_CALIB_POLY;
+    }
+    if (point->value_offset != 0.0) {
+        post |= MODBUS_PROFILE_POST_OFFSET;
+    }
+    return post;
+}
+
+static bool store_saturated(modbus_data_type_t data_type, double scaled, modbus_value_t *value)
+{
+    /* Casts truncate toward zero, so the bounds are exclusive: (min - 1, max + 1) */
+#define SATURATE(field, ctype, min, max, lo_ex, hi_ex)      \
+    do {                                                    \
+        if (scaled != scaled) {                             \
+            value->field = 0;                               \
+            return true;                                    \
+        }                                                   \
+        if (scaled <= (lo_ex)) {                            \
+            value->field = (min);                           \
+            return true;                                    \
+        }                                                   \
+        if (scaled >= (hi_ex)) {                            \
+            value->field = (max);                           \
+            return true;                                    \
+        }                                                   \
+        value->field = (ctype)scaled;                       \
+        return false;                                       \
+    } while (0)
+
+    if (data_type == MODBUS_INT8_SIGNED) {
+        SATURATE(i8, int8_t, INT8_MIN, INT8_MAX, -129.0, 128.0);
+    }
+    if (data_type == MODBUS_INT8_UNSIGNED) {
+        SATURATE(u8, uint8_t, 0, UINT8_MAX, -1.0, 256.0);
+    }
+    if (data_type == MODBUS_INT16_SIGNED_AB || data_type == MODBUS_INT16_SIGNED_BA) {
+        SATURATE(i16, int16_t, INT16_MIN, INT16_MAX, -32769.0, 32768.0);
+    }
+    if (data_type == MODBUS_INT16_UNSIGNED_AB || data_type == MODBUS_INT16_UNSIGNED_BA) {
+        SATURATE(u16, uint16_t, 0, UINT16_MAX, -1.0, 65536.0);
+    }
+    if (data_type <= MODBUS_INT32_SIGNED_CDAB) {
+        SATURATE(i32, int32_t, INT32_MIN, INT32_MAX, -2147483649.0, 2147483648.0);
+    }
+    if (data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        SATURATE(u32, uint32_t, 0, UINT32_MAX, -1.0, 4294967296.0);
+    }
+    if (data_type <= MODBUS_INT64_SIGNED_EFGHABCD) {
+        /* No double lies strictly between -2^63 - 2048 and -2^63 */
+        SATURATE(i64, int64_t, INT64_MIN, INT64_MAX,
+                 -9223372036854777856.0, 9223372036854775808.0);
+    }
+    if (data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        SATURATE(u64, uint64_t, 0, UINT64_MAX, -1.0, 18446744073709551616.0);
+    }
+#undef SATURATE
+
+    if (scaled > FLT_MAX || scaled < -FLT_MAX) {
+        value->f32 = scaled > 0.0 ? FLT_MAX : -FLT_MAX;
+        return true;
+    }
+    value->f32 = (float)scaled;
+    return false;
+}
+
+/* Bytes of modbus_value_t holding a value of the given type */
+static size_t value_width(modbus_data_type_t data_type)
+{
+    switch (data_type) {
+        case MODBUS_BIT_BOOLEAN:
+            return sizeof(bool);
+        case MODBUS_INT8_SIGNED:
+        case MODBUS_INT8_UNSIGNED:
+            return 1;
+        default:
+            break;
+    }
+    /* Remaining types occupy two bytes per register */
+    return 2 * modbus_type_reg_count(data_type);
+}
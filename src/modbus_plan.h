@@ -0,0 +1,150 @@
+/**
+ * @file modbus_plan.h
+ * @brief Batch conversion of register blocks through point plans
+ * @details A plan describes every point of a device register block (offset,
+ *          data type, bit position, scaling, value offset). Plans are
+ *          validated once by modbus_plan_compile() and then executed against
+ *          each polled block.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_PLAN_H
+#define MODBUS_PLAN_H
+
+#include "modbus_conversion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sensor calibration, see modbus_calib.h */
+struct modbus_calib;
+
+/* Point descriptor: one value inside a register block */
+typedef struct {
+    uint16_t offset;                /* First register of the point within the block */
+    modbus_data_type_t data_type;   /* Type of conversion to perform */
+    uint8_t bit_pos;                /* Bit position for MODBUS_BIT_BOOLEAN */
+    double scaling_factor;          /* Multiplier to apply after conversion */
+    const struct modbus_calib *calib; /* Calibration applied after scaling (optional) */
+    double value_offset;            /* Added after scaling, before calibration */
+    uint8_t unit;                   /* modbus_unit_t of the scaled value, see modbus_units.h */
+    uint8_t target_unit;            /* Unit wanted, folded by modbus_units_fold(); 0 keeps unit */
+} modbus_point_t;
+
+/* Compiled conversion plan for one device block */
+typedef struct {
+    const modbus_point_t *points;   /* Point descriptors (not copied) */
+    size_t point_count;             /* Number of points */
+    size_t reg_span;                /* Registers required to execute the plan */
+    uint32_t device_id;             /* Device identifier used in diagnostics */
+} modbus_plan_t;
+
+/* Streaming aggregator, see modbus_agg.h */
+struct modbus_agg;
+
+/* One plan execution within a batch */
+typedef struct {
+    const modbus_plan_t *plan;      /* Plan to execute */
+    const uint16_t *registers;      /* Register block */
+    size_t reg_count;               /* Registers in the block */
+    modbus_value_t *values;         /* Output: one value per point */
+    int *status;                    /* Output: one status per point (optional) */
+    int result;                     /* Output: result of modbus_plan_execute() */
+    struct modbus_agg *agg;         /* Window aggregates updated in the pass (optional) */
+    uint64_t timestamp;             /* Sample timestamp for agg */
+} modbus_batch_item_t;
+
+/**
+ * @brief Validate point descriptors and build a plan
+ * @param plan Plan to initialize
+ * @param points Array of point descriptors (must outlive the plan)
+ * @param point_count Number of points
+ * @param device_id Device identifier
+ * @return MODBUS_CONV_OK on success, error code of the first invalid point otherwise
+ *         (MODBUS_CONV_ERR_INVALID_TYPE for a calibrated boolean or units
+ *         not yet folded by modbus_units_fold())
+ */
+int modbus_plan_compile(modbus_plan_t *plan,
+                        const modbus_point_t *points,
+                        size_t point_count,
+                        uint32_t device_id);
+
+/**
+ * @brief Convert every point of a plan from a register block
+ * @details Points that fail are reported in status and do not stop the batch.
+ *          Scaled (and calibrated) integer and float32 values outside the
+ *          type range are saturated and counted as scaling overflows.
+ * @param plan Compiled plan
+ * @param registers Register block
+ * @param reg_count Number of registers in the block (at least plan->reg_span)
+ * @param values Array receiving one value per point
+ * @param status Array receiving one status per point, may be NULL
+ * @return MODBUS_CONV_OK if all points converted, first point error code otherwise
+ */
+int modbus_plan_execute(const modbus_plan_t *plan,
+                        const uint16_t *registers,
+                        size_t reg_count,
+                        modbus_value_t *values,
+                        int *status);
+
+/**
+ * @brief Convert every point and update window aggregates in the same pass
+ * @details Like modbus_plan_execute(); each converted value is also added to
+ *          agg, so the aggregates cost no second pass over the results.
+ *          Records of a window closed by this timestamp are in agg->records.
+ * @param plan Compiled plan
+ * @param registers Register block
+ * @param reg_count Number of registers in the block (at least plan->reg_span)
+ * @param values Array receiving one value per point
+ * @param status Array receiving one status per point, may be NULL
+ * @param agg Aggregator with at least plan->point_count points, may be NULL
+ * @param timestamp Sample timestamp
+ * @return MODBUS_CONV_OK if all points converted, first point error code otherwise
+ */
+int modbus_plan_execute_agg(const modbus_plan_t *plan,
+                            const uint16_t *registers,
+                            size_t reg_count,
+                            modbus_value_t *values,
+                            int *status,
+                            struct modbus_agg *agg,
+                            uint64_t timestamp);
+
+/**
+ * @brief Execute several plans as one batch
+ * @details Items with an aggregator are run through modbus_plan_execute_agg().
+ * @param items Batch items; each item's result field is set
+ * @param item_count Number of items
+ * @return MODBUS_CONV_OK if all items succeeded, first item error code otherwise
+ */
+int modbus_batch_execute(modbus_batch_item_t *items, size_t item_count);
+
+/**
+ * @brief Find the points whose value or status changed since the last call
+ * @details Values are compared bit for bit within the width of their type;
+ *          a status change counts as a change. last and last_status are
+ *          updated to the new results.
+ * @param plan Compiled plan
+ * @param last Values of the previous execution (updated)
+ * @param last_status Status of the previous execution (updated)
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param first Number added to each reported point index (e.g. table base)
+ * @param changed Array of at least plan->point_count entries receiving the
+ *        indices of changed points in ascending order
+ * @return Number of changed points
+ */
+size_t modbus_plan_changes(const modbus_plan_t *plan,
+                           modbus_value_t *last,
+                           int *last_status,
+                           const modbus_value_t *values,
+                           const int *status,
+                           uint32_t first,
+                           uint32_t *changed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_PLAN_H */
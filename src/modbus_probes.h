@@ -0,0 +1,58 @@
+/**
+ * @file modbus_probes.h
+ * @brief USDT static tracepoints for the conversion hot paths
+ * @details Build with -DMODBUS_CONV_USDT (requires <sys/sdt.h> from systemtap)
+ *          to emit probes under the "modbus_conv" provider. Without the define
+ *          every probe compiles to nothing. Probe arguments that cost time to
+ *          compute (durations) are guarded by MODBUS_PROBE_ENABLED() so they are
+ *          only gathered while a tracer is attached.
+ *
+ *          Probes:
+ *            batch__start(items, points)
+ *            batch__end(items, errors, duration_ns)
+ *            plan__exec(device_id, points, errors, duration_ns)
+ *            conv__error(device_id, point_index, data_type, error_code)
+ *            frame__parse_fail(function_code, pdu_len, error_code)
+ *
+ *          Example: bpftrace -e 'usdt:./app:modbus_conv:plan__exec { @[arg0] = hist(arg3); }'
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_PROBES_H
+#define MODBUS_PROBES_H
+
+#ifdef MODBUS_CONV_USDT
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define MODBUS_PROBE_SEMAPHORE(name) \
+    __extension__ extern unsigned short modbus_conv_##name##_semaphore
+
+#define MODBUS_PROBE_ENABLED(name) \
+    __builtin_expect(modbus_conv_##name##_semaphore != 0, 0)
+
+#define MODBUS_PROBE2(name, a1, a2) \
+    STAP_PROBE2(modbus_conv, name, a1, a2)
+#define MODBUS_PROBE3(name, a1, a2, a3) \
+    STAP_PROBE3(modbus_conv, name, a1, a2, a3)
+#define MODBUS_PROBE4(name, a1, a2, a3, a4) \
+    STAP_PROBE4(modbus_conv, name, a1, a2, a3, a4)
+
+MODBUS_PROBE_SEMAPHORE(batch__start);
+MODBUS_PROBE_SEMAPHORE(batch__end);
+MODBUS_PROBE_SEMAPHORE(plan__exec);
+MODBUS_PROBE_SEMAPHORE(conv__error);
+MODBUS_PROBE_SEMAPHORE(frame__parse_fail);
+
+#else
+
+#define MODBUS_PROBE_ENABLED(name)                  0
+#define MODBUS_PROBE2(name, a1, a2)                 do { } while (0)
+#define MODBUS_PROBE3(name, a1, a2, a3)             do { } while (0)
+#define MODBUS_PROBE4(name, a1, a2, a3, a4)         do { } while (0)
+
+#endif /* MODBUS_CONV_USDT */
+
+#endif /* MODBUS_PROBES_H */
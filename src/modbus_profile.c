@@ -0,0 +1,276 @@
+/**
+ * @file modbus_profile.c
+ * @brief Sampling cost profiler implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_profile.h"
+#include "modbus_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PROFILE_TLS         __thread
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define PROFILE_TLS         _Thread_local
+#else
+#define PROFILE_TLS
+#endif
+
+static PROFILE_TLS modbus_profile_t *local_profile;
+
+static const char *const scale_names[] = { "unscaled", "linear", "checked" };
+
+/* MODBUS_PROFILE_POST_* names by bit position */
+static const char *const post_names[] = { "calib_table", "calib_poly", "offset" };
+
+/* Output cursor */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} profile_out_t;
+
+/* Helper function prototypes */
+static modbus_profile_scale_t scale_mode(const modbus_point_t *point);
+static void out_printf(profile_out_t *out, const char *fmt, ...);
+static void out_kind(profile_out_t *out, const modbus_profile_entry_t *e, char sep);
+static int compare_cost(const void *a, const void *b);
+
+void modbus_profile_init(modbus_profile_t *prof, uint32_t interval)
+{
+    if (!prof) {
+        return;
+    }
+    memset(prof, 0, sizeof(*prof));
+    prof->interval = interval ? interval : 1;
+    prof->countdown = prof->interval;
+}
+
+void modbus_profile_attach(modbus_profile_t *prof)
+{
+    local_profile = prof;
+}
+
+modbus_profile_t *modbus_profile_local(void)
+{
+    return local_profile;
+}
+
+uint64_t modbus_profile_ticks(void)
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return modbus_trace_now();
+#endif
+}
+
+void modbus_profile_add(modbus_profile_t *prof,
+                        uint32_t device_id,
+                        const modbus_point_t *point,
+                        uint8_t post,
+                        uint64_t cycles)
+{
+    uint8_t mode;
+    uint32_t h;
+    size_t probe;
+
+    if (!prof || !point) {
+        return;
+    }
+
+    mode = (uint8_t)scale_mode(point);
+    h = device_id * 2654435761u ^ ((uint32_t)point->data_type << 16) ^ ((uint32_t)mode << 8) ^ post;
+    h ^= h >> 15;
+
+    /* Open addressing with linear probing */
+    for (probe = 0; probe < MODBUS_PROFILE_SLOTS; probe++) {
+        modbus_profile_entry_t *e = &prof->entries[(h + probe) & (MODBUS_PROFILE_SLOTS - 1)];
+        if (!e->used) {
+            e->used = 1;
+            e->device_id = device_id;
+            e->data_type = (uint8_t)point->data_type;
+            e->scale_mode = mode;
+            e->post = post;
+        } else if (e->device_id != device_id || e->data_type != (uint8_t)point->data_type ||
+                   e->scale_mode != mode || e->post != post) {
+            continue;
+        }
+        e->samples++;
+        e->cycles += cycles;
+        return;
+    }
+    prof->dropped++;
+}
+
+int modbus_profile_report(const modbus_profile_t *prof, char *buf, size_t size, size_t *len)
+{
+    const modbus_profile_entry_t *ranked[MODBUS_PROFILE_SLOTS];
+    profile_out_t out;
+    uint64_t total = 0;
+    size_t count = 0;
+    size_t i;
+
+    if (!prof || !buf || !len) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    for (i = 0; i < MODBUS_PROFILE_SLOTS; i++) {
+        if (prof->entries[i].used) {
+            ranked[count++] = &prof->entries[i];
+            total += prof->entries[i].cycles;
+        }
+    }
+    qsort(ranked, count, sizeof(ranked[0]), compare_cost);
+
+    out.buf = buf;
+    out.size = size;
+    out.len = 0;
+    out.overflow = false;
+
+    out_printf(&out, "%6s %16s %10s %10s  %-10s %s\n",
+               "share", "est_cycles", "samples", "cyc/point", "device", "kind");
+    for (i = 0; i < count; i++) {
+        const modbus_profile_entry_t *e = ranked[i];
+        out_printf(&out, "%5.1f%% %16llu %10llu %10.1f  %-10lu ",
+                   total ? 100.0 * (double)e->cycles / (double)total : 0.0,
+                   (unsigned long long)(e->cycles * prof->interval),
+                   (unsigned long long)e->samples,
+                   (double)e->cycles / (double)e->samples,
+                   (unsigned long)e->device_id);
+        out_kind(&out, e, ' ');
+        out_printf(&out, "\n");
+    }
+    if (prof->dropped) {
+        out_printf(&out, "dropped samples: %llu\n", (unsigned long long)prof->dropped);
+    }
+
+    if (out.overflow) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    *len = out.len;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_profile_folded(const modbus_profile_t *prof, char *buf, size_t size, size_t *len)
+{
+    profile_out_t out;
+    size_t i;
+
+    if (!prof || !buf || !len) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    out.buf = buf;
+    out.size = size;
+    out.len = 0;
+    out.overflow = false;
+    if (size > 0) {
+        buf[0] = '\0';
+    }
+
+    for (i = 0; i < MODBUS_PROFILE_SLOTS; i++) {
+        const modbus_profile_entry_t *e = &prof->entries[i];
+        if (!e->used) {
+            continue;
+        }
+        out_printf(&out, "device_%lu;", (unsigned long)e->device_id);
+        out_kind(&out, e, ';');
+        out_printf(&out, " %llu\n", (unsigned long long)(e->cycles * prof->interval));
+    }
+
+    if (out.overflow) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    *len = out.len;
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+static modbus_profile_scale_t scale_mode(const modbus_point_t *point)
+{
+    double scale = point->scaling_factor;
+
+    /* Mirrors the saturating path taken by plan execution */
+    if (point->calib || point->value_offset != 0.0) {
+        return MODBUS_PROFILE_SCALE_CHECKED;
+    }
+    if (scale == 1.0) {
+        return MODBUS_PROFILE_SCALE_NONE;
+    }
+    if ((scale > 1.0 || scale < 0.0) && point->data_type != MODBUS_BIT_BOOLEAN &&
+        point->data_type < MODBUS_IEEE_FLOAT64_ABCDEFGH) {
+        return MODBUS_PROFILE_SCALE_CHECKED;
+    }
+    return MODBUS_PROFILE_SCALE_LINEAR;
+}
+
+static void out_printf(profile_out_t *out, const char *fmt, ...)
+{
+    va_list args;
+    int n;
+
+    if (out->overflow) {
+        return;
+    }
+
+    va_start(args, fmt);
+    n = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+    va_end(args);
+
+    if (n < 0 || (size_t)n >= out->size - out->len) {
+        out->overflow = true;
+        return;
+    }
+    out->len += (size_t)n;
+}
+
+/* Writes "type<sep>order<sep>scaling<sep>post", post as "calib_table+offset" */
+static void out_kind(profile_out_t *out, const modbus_profile_entry_t *e, char sep)
+{
+    const char *name = modbus_type_name((modbus_data_type_t)e->data_type);
+    const char *order = NULL;
+    const char *join = "";
+    size_t i;
+
+    /* Every type from INT16 upwards carries a byte order suffix */
+    if (e->data_type >= MODBUS_INT16_SIGNED_AB) {
+        order = strrchr(name, '_');
+    }
+    if (order) {
+        out_printf(out, "%.*s%c%s%c", (int)(order - name), name, sep, order + 1, sep);
+    } else {
+        out_printf(out, "%s%c-%c", name, sep, sep);
+    }
+    out_printf(out, "%s%c", scale_names[e->scale_mode], sep);
+    if (!e->post) {
+        out_printf(out, "none");
+    }
+    for (i = 0; i < sizeof(post_names) / sizeof(post_names[0]); i++) {
+        if (e->post & (1u << i)) {
+            out_printf(out, "%s%s", join, post_names[i]);
+            join = "+";
+        }
+    }
+}
+
+static int compare_cost(const void *a, const void *b)
+{
+    const modbus_profile_entry_t *ea = *(const modbus_profile_entry_t *const *)a;
+    const modbus_profile_entry_t *eb = *(const modbus_profile_entry_t *const *)b;
+
+    if (ea->cycles != eb->cycles) {
+        return ea->cycles < eb->cycles ? 1 : -1;
+    }
+    return 0;
+}
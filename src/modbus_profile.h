@@ -0,0 +1,121 @@
+/**
+ * @file modbus_profile.h
+ * @brief Sampling cost profiler for plan execution
+ * @details When a profiler is attached to a thread, plan execution times every
+ *          Nth point with the CPU cycle counter and attributes the cycles to the
+ *          device and point kind (data type, byte order, scaling mode and
+ *          post-processing). Results can be written as a ranked report or as
+ *          folded stacks for flamegraph.pl / speedscope.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_PROFILE_H
+#define MODBUS_PROFILE_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of distinct (device, kind) entries tracked, power of two */
+#ifndef MODBUS_PROFILE_SLOTS
+#define MODBUS_PROFILE_SLOTS            1024
+#endif
+
+/* Scaling modes */
+typedef enum {
+    MODBUS_PROFILE_SCALE_NONE,      /* scaling_factor == 1.0 */
+    MODBUS_PROFILE_SCALE_LINEAR,    /* plain multiply */
+    MODBUS_PROFILE_SCALE_CHECKED    /* range-checked, saturating multiply */
+} modbus_profile_scale_t;
+
+/* Post-processing stage flags */
+#define MODBUS_PROFILE_POST_CALIB_TABLE 0x01    /* Interpolation table calibration */
+#define MODBUS_PROFILE_POST_CALIB_POLY  0x02    /* Polynomial calibration */
+#define MODBUS_PROFILE_POST_OFFSET      0x04    /* Non-zero value_offset */
+
+/* Cost entry for one device and point kind */
+typedef struct {
+    uint32_t device_id;
+    uint8_t data_type;              /* modbus_data_type_t */
+    uint8_t scale_mode;             /* modbus_profile_scale_t */
+    uint8_t post;                   /* MODBUS_PROFILE_POST_* flags, 0 = none */
+    uint8_t used;
+    uint64_t samples;               /* Points timed */
+    uint64_t cycles;                /* Cycles spent in timed points */
+} modbus_profile_entry_t;
+
+/* Profiler state, owned by one thread */
+typedef struct {
+    uint32_t interval;              /* Time one point out of every interval */
+    uint32_t countdown;             /* Points left until the next sample */
+    uint64_t dropped;               /* Samples lost because the table was full */
+    modbus_profile_entry_t entries[MODBUS_PROFILE_SLOTS];
+} modbus_profile_t;
+
+/**
+ * @brief Initialize a profiler
+ * @param prof Profiler to initialize
+ * @param interval Sample one point out of every interval points (0 is treated as 1)
+ */
+void modbus_profile_init(modbus_profile_t *prof, uint32_t interval);
+
+/**
+ * @brief Attach a profiler to the calling thread
+ * @param prof Profiler, or NULL to stop profiling on this thread
+ */
+void modbus_profile_attach(modbus_profile_t *prof);
+
+/**
+ * @brief Get the profiler attached to the calling thread
+ * @return Profiler, or NULL if none is attached
+ */
+modbus_profile_t *modbus_profile_local(void);
+
+/**
+ * @brief Read the CPU cycle counter (monotonic clock on other architectures)
+ * @return Current tick count
+ */
+uint64_t modbus_profile_ticks(void);
+
+/**
+ * @brief Attribute a timed point conversion
+ * @param prof Profiler
+ * @param device_id Device the point belongs to
+ * @param point Point descriptor
+ * @param post MODBUS_PROFILE_POST_* flags of the stages applied to the point
+ * @param cycles Cycles measured for the point
+ */
+void modbus_profile_add(modbus_profile_t *prof,
+                        uint32_t device_id,
+                        const modbus_point_t *point,
+                        uint8_t post,
+                        uint64_t cycles);
+
+/**
+ * @brief Write a report of entries ranked by estimated total cycles
+ * @param prof Profiler
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ * @param len Pointer to store the written length (excluding terminator)
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf is too small
+ */
+int modbus_profile_report(const modbus_profile_t *prof, char *buf, size_t size, size_t *len);
+
+/**
+ * @brief Write folded stacks ("device;type;order;scaling;post cycles" per line)
+ * @param prof Profiler
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ * @param len Pointer to store the written length (excluding terminator)
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf is too small
+ */
+int modbus_profile_folded(const modbus_profile_t *prof, char *buf, size_t size, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_PROFILE_H */
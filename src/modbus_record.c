@@ -0,0 +1,132 @@
+/**
+ * @file modbus_record.c
+ * @brief Streaming record decoding implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_record.h"
+#include "modbus_frame.h"
+#include <string.h>
+
+/* Helper function prototypes */
+static void deliver(modbus_record_stream_t *stream, const uint16_t *registers);
+
+size_t modbus_record_size(const modbus_plan_t *plan, size_t record_regs)
+{
+    size_t points = plan ? plan->point_count : 0;
+
+    /* Values first for alignment, then status, then the register buffer */
+    return points * sizeof(modbus_value_t) + points * sizeof(int) +
+           record_regs * sizeof(uint16_t);
+}
+
+int modbus_record_init(modbus_record_stream_t *stream,
+                       const modbus_plan_t *plan,
+                       size_t record_regs,
+                       modbus_record_fn fn,
+                       void *ctx,
+                       void *storage,
+                       size_t storage_size)
+{
+    if (!stream || !plan || !fn || !storage) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (record_regs == 0 || record_regs < plan->reg_span) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    if (storage_size < modbus_record_size(plan, record_regs)) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    memset(stream, 0, sizeof(*stream));
+    stream->plan = plan;
+    stream->record_regs = record_regs;
+    stream->values = (modbus_value_t *)storage;
+    stream->status = (int *)(void *)(stream->values + plan->point_count);
+    stream->buffer = (uint16_t *)(void *)(stream->status + plan->point_count);
+    stream->fn = fn;
+    stream->ctx = ctx;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_record_feed(modbus_record_stream_t *stream, const uint16_t *registers, size_t reg_count)
+{
+    size_t size;
+
+    if (!stream || (!registers && reg_count)) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    /* Nothing to copy; registers may be NULL */
+    if (reg_count == 0) {
+        return MODBUS_CONV_OK;
+    }
+    size = stream->record_regs;
+
+    /* Complete a record started by an earlier chunk */
+    if (stream->fill > 0) {
+        size_t take = size - stream->fill < reg_count ? size - stream->fill : reg_count;
+
+        memcpy(stream->buffer + stream->fill, registers, take * sizeof(uint16_t));
+        stream->fill += take;
+        registers += take;
+        reg_count -= take;
+        if (stream->fill < size) {
+            return MODBUS_CONV_OK;
+        }
+        deliver(stream, stream->buffer);
+        stream->fill = 0;
+    }
+
+    /* Whole records are converted in place, without copying */
+    while (reg_count >= size) {
+        deliver(stream, registers);
+        registers += size;
+        reg_count -= size;
+    }
+
+    memcpy(stream->buffer, registers, reg_count * sizeof(uint16_t));
+    stream->fill = reg_count;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_record_feed_pdu(modbus_record_stream_t *stream, const uint8_t *pdu, size_t pdu_len)
+{
+    uint16_t registers[MODBUS_FRAME_MAX_REGS];
+    size_t count;
+    int rc;
+
+    if (!stream || !pdu) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    switch (pdu_len ? pdu[0] : 0) {
+        case MODBUS_FC_READ_FILE_RECORD:
+            rc = modbus_frame_read_file_record(pdu, pdu_len, registers, MODBUS_FRAME_MAX_REGS, &count);
+            break;
+        case MODBUS_FC_READ_FIFO_QUEUE:
+            rc = modbus_frame_read_fifo(pdu, pdu_len, registers, MODBUS_FRAME_MAX_REGS, &count);
+            break;
+        default:
+            rc = modbus_frame_read_registers(pdu, pdu_len, registers, MODBUS_FRAME_MAX_REGS, &count);
+            break;
+    }
+    if (rc != MODBUS_CONV_OK) {
+        return rc;
+    }
+    return modbus_record_feed(stream, registers, count);
+}
+
+void modbus_record_reset(modbus_record_stream_t *stream)
+{
+    if (stream) {
+        stream->fill = 0;
+        stream->records = 0;
+    }
+}
+
+/* Helper function implementations */
+static void deliver(modbus_record_stream_t *stream, const uint16_t *registers)
+{
+    modbus_plan_execute(stream->plan, registers, stream->record_regs, stream->values, stream->status);
+    stream->fn(stream->ctx, stream->records++, stream->values, stream->status);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file modbus_record.h
+ * @brief Streaming record decoding for file records (FC20) and FIFO queues (FC24)
+ * @details Event logs and load profiles are sequences of fixed-size records
+ *          read in chunks that need not align with record boundaries. A
+ *          record stream reassembles the registers of successive responses
+ *          into records and converts each complete record through a
+ *          record-layout plan, a modbus_plan_t whose offsets are relative to
+ *          the start of the record. Records are delivered to a callback as
+ *          soon as they are complete; only one partial record is buffered.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_RECORD_H
+#define MODBUS_RECORD_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Record callback
+ * @param ctx User context
+ * @param record Index of the record since the stream was initialized or reset
+ * @param values Converted values, one per plan point
+ * @param status Per-point status, one per plan point
+ */
+typedef void (*modbus_record_fn)(void *ctx, uint32_t record,
+                                 const modbus_value_t *values, const int *status);
+
+/* Record stream; buffers in caller storage */
+typedef struct {
+    const modbus_plan_t *plan;      /* Record-layout plan */
+    size_t record_regs;             /* Registers per record */
+    uint16_t *buffer;               /* Registers of the record being assembled */
+    size_t fill;                    /* Registers in buffer */
+    modbus_value_t *values;         /* Values of the current record */
+    int *status;                    /* Status of the current record */
+    modbus_record_fn fn;            /* Record callback */
+    void *ctx;                      /* Callback context */
+    uint32_t records;               /* Records delivered */
+} modbus_record_stream_t;
+
+/**
+ * @brief Storage needed for a record stream
+ * @param plan Record-layout plan
+ * @param record_regs Registers per record
+ * @return Size in bytes for modbus_record_init()
+ */
+size_t modbus_record_size(const modbus_plan_t *plan, size_t record_regs);
+
+/**
+ * @brief Initialize a record stream
+ * @param stream Record stream
+ * @param plan Record-layout plan (must outlive the stream)
+ * @param record_regs Registers per record, at least plan->reg_span
+ * @param fn Callback receiving each converted record
+ * @param ctx Callback context
+ * @param storage Storage of at least modbus_record_size() bytes, 8-byte aligned
+ * @param storage_size Size of storage
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE if record_regs
+ *         is 0 or smaller than the plan, MODBUS_CONV_ERR_BUFFER if storage is too small
+ */
+int modbus_record_init(modbus_record_stream_t *stream,
+                       const modbus_plan_t *plan,
+                       size_t record_regs,
+                       modbus_record_fn fn,
+                       void *ctx,
+                       void *storage,
+                       size_t storage_size);
+
+/**
+ * @brief Feed registers into the stream
+ * @details Every record completed by these registers is converted and
+ *          delivered before the call returns.
+ * @param stream Record stream
+ * @param registers Registers continuing the record sequence
+ * @param reg_count Number of registers
+ * @return MODBUS_CONV_OK on success
+ */
+int modbus_record_feed(modbus_record_stream_t *stream, const uint16_t *registers, size_t reg_count);
+
+/**
+ * @brief Feed an FC20, FC24, FC03 or FC04 response PDU into the stream
+ * @param stream Record stream
+ * @param pdu Response PDU bytes
+ * @param pdu_len Number of bytes in the PDU
+ * @return MODBUS_CONV_OK on success, error of the frame decoder otherwise
+ *         (nothing is fed from a rejected PDU)
+ */
+int modbus_record_feed_pdu(modbus_record_stream_t *stream, const uint8_t *pdu, size_t pdu_len);
+
+/**
+ * @brief Drop a partially assembled record and restart record numbering
+ * @param stream Record stream
+ */
+void modbus_record_reset(modbus_record_stream_t *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_RECORD_H */
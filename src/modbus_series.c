@@ -0,0 +1,758 @@
+/**
+ * @file modbus_series.c
+ * @brief Compressed time series implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_series.h"
+#include <string.h>
+
+/*
+ * Block layout: header, then the bit stream growing forward (timestamps and,
+ * for floats, values), and simple-8b words growing backward from the end.
+ *
+ * Timestamp code, dod = delta - previous delta:
+ *   '0'                      dod == 0
+ *   '10'   + 7 bits          dod in [-63, 64]
+ *   '110'  + 9 bits          dod in [-255, 256]
+ *   '1110' + 12 bits         dod in [-2047, 2048]
+ *   '1111' + 64 bits         otherwise
+ *
+ * Float code, x = value XOR previous value:
+ *   '0'                      x == 0
+ *   '10'  + window bits      x fits the previous leading/trailing window
+ *   '11'  + 5 bits leading zeros + 6 bits (length - 1) + length bits
+ *
+ * Simple-8b word: selector in the top 4 bits, values from the low bits up.
+ * Selectors 2-15 are the usual 60x1 ... 1x60 layouts; selector 0 marks a
+ * delta wider than 60 bits stored raw in the following word; 1 is unused.
+ */
+
+/* Worst-case bits of one timestamp and one float value */
+#define TIMESTAMP_MAX_BITS      68
+#define FLOAT_MAX_BITS          77
+
+/* Worst-case bits of one packed integer delta (escape word and raw word) */
+#define PACKED_MAX_BITS         128
+
+/* Block header */
+typedef struct {
+    uint64_t first_timestamp;       /* Timestamp of the first sample */
+    uint64_t last_timestamp;        /* Timestamp of the last sample */
+    uint64_t first_bits;            /* First value as 64 bits */
+    uint32_t count;                 /* Samples in the block */
+    uint32_t bits;                  /* Used bits of the forward stream */
+    uint32_t words;                 /* Simple-8b words at the end */
+    uint32_t reserved;
+} series_block_t;
+
+/* Integer value reader over one block */
+typedef struct {
+    const series_block_t *block;
+    const uint64_t *pending;        /* Unpacked deltas (newest block only) */
+    uint32_t pending_count;
+    uint32_t next_word;             /* Next word index */
+    uint32_t next_pending;          /* Next pending delta */
+    uint64_t word;                  /* Word being unpacked */
+    unsigned width;                 /* Value width in the word */
+    unsigned left;                  /* Values left in the word */
+} int_reader_t;
+
+static const uint8_t s8b_count[16] = { 1, 0, 60, 30, 20, 15, 12, 10, 8, 7, 6, 5, 4, 3, 2, 1 };
+static const uint8_t s8b_width[16] = { 64, 0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 15, 20, 30, 60 };
+
+/* Helper function prototypes */
+static series_block_t *block_at(const modbus_series_t *series, uint32_t n);
+static uint8_t *block_data(const series_block_t *block);
+static size_t free_bits(const modbus_series_t *series, const series_block_t *block);
+static void start_block(modbus_series_t *series, uint64_t timestamp, uint64_t bits);
+static void put_bits(uint8_t *data, uint32_t *pos, uint64_t value, unsigned n);
+static bool get_bits(const uint8_t *data, uint32_t limit, uint32_t *pos, unsigned n, uint64_t *value);
+static unsigned timestamp_bits(int64_t dod);
+static void put_timestamp(uint8_t *data, uint32_t *pos, int64_t dod);
+static bool get_timestamp(const uint8_t *data, uint32_t limit, uint32_t *pos, int64_t *dod);
+static void put_float(modbus_series_t *series, uint8_t *data, uint32_t *pos, uint64_t bits);
+static void put_word(const modbus_series_t *series, series_block_t *block, uint64_t word);
+static uint64_t get_word(size_t block_size, const series_block_t *block, uint32_t n);
+static void pack_pending(modbus_series_t *series, series_block_t *block, bool force);
+static bool next_int(size_t block_size, int_reader_t *reader, uint64_t *delta);
+static bool is_float(modbus_data_type_t data_type);
+static unsigned float_width(modbus_data_type_t data_type);
+static unsigned msb_index(uint64_t value);
+static unsigned lsb_index(uint64_t value);
+static unsigned bit_length(uint64_t value);
+static uint64_t load_bits(modbus_data_type_t data_type, const modbus_value_t *value);
+static void store_bits(modbus_data_type_t data_type, uint64_t bits, modbus_value_t *value);
+static uint64_t zigzag(int64_t value);
+static int64_t unzigzag(uint64_t value);
+
+int modbus_series_init(modbus_series_t *series,
+                       modbus_data_type_t data_type,
+                       void *storage,
+                       size_t storage_size,
+                       size_t block_size,
+                       uint64_t retention)
+{
+    size_t block_count;
+
+    if (!series || !storage) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (modbus_type_reg_count(data_type) == 0 || block_size < MODBUS_SERIES_MIN_BLOCK ||
+        block_size % 8 != 0 || block_size - sizeof(series_block_t) > UINT32_MAX / 8) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    block_count = storage_size / block_size;
+    if (block_count < 2) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    memset(series, 0, sizeof(*series));
+    series->blocks = (uint8_t *)storage;
+    series->block_size = block_size;
+    series->block_count = block_count > UINT32_MAX ? UINT32_MAX : (uint32_t)block_count;
+    series->data_type = data_type;
+    series->retention = retention;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_series_append(modbus_series_t *series, uint64_t timestamp, const modbus_value_t *value)
+{
+    series_block_t *block;
+    uint8_t *data;
+    uint64_t bits;
+    int64_t delta, dod;
+    unsigned ts_bits;
+    bool floating;
+
+    if (!series || !series->blocks || !value) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    bits = load_bits(series->data_type, value);
+    if (series->used == 0) {
+        start_block(series, timestamp, bits);
+        return MODBUS_CONV_OK;
+    }
+
+    block = block_at(series, series->used - 1);
+    delta = (int64_t)(timestamp - series->last_timestamp);
+    dod = (int64_t)((uint64_t)delta - (uint64_t)series->last_delta);
+    ts_bits = timestamp_bits(dod);
+    floating = is_float(series->data_type);
+
+    /* Room for this sample, and for packing every pending delta afterwards */
+    if (floating) {
+        if (free_bits(series, block) < ts_bits + FLOAT_MAX_BITS) {
+            start_block(series, timestamp, bits);
+            return MODBUS_CONV_OK;
+        }
+    } else if (free_bits(series, block) < ts_bits + PACKED_MAX_BITS * (series->pending_count + 1)) {
+        pack_pending(series, block, true);
+        if (free_bits(series, block) < ts_bits + PACKED_MAX_BITS) {
+            start_block(series, timestamp, bits);
+            return MODBUS_CONV_OK;
+        }
+    }
+
+    data = block_data(block);
+    put_timestamp(data, &block->bits, dod);
+    if (floating) {
+        put_float(series, data, &block->bits, bits);
+    } else {
+        series->pending[series->pending_count++] = zigzag((int64_t)(bits - series->last_bits));
+        pack_pending(series, block, false);
+    }
+
+    block->count++;
+    block->last_timestamp = timestamp;
+    series->last_timestamp = timestamp;
+    series->last_delta = delta;
+    series->last_bits = bits;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_series_append_plan(modbus_series_t *series,
+                              const modbus_plan_t *plan,
+                              const modbus_value_t *values,
+                              const int *status,
+                              uint64_t timestamp)
+{
+    size_t i;
+
+    if (!series || !plan || !values) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    for (i = 0; i < plan->point_count; i++) {
+        int result;
+
+        if (status && status[i] != MODBUS_CONV_OK) {
+            continue;
+        }
+        result = modbus_series_append(&series[i], timestamp, &values[i]);
+        if (result != MODBUS_CONV_OK) {
+            return result;
+        }
+    }
+    return MODBUS_CONV_OK;
+}
+
+int modbus_series_scan(const modbus_series_t *series,
+                       uint64_t from,
+                       uint64_t to,
+                       uint64_t *timestamps,
+                       modbus_value_t *values,
+                       size_t max_samples,
+                       size_t *count)
+{
+    bool floating;
+    unsigned width;
+    size_t n = 0;
+    uint32_t b;
+
+    if (!series || !timestamps || !values || !count) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    *count = 0;
+    floating = is_float(series->data_type);
+    width = float_width(series->data_type);
+
+    for (b = 0; b < series->used; b++) {
+        const series_block_t *block = block_at(series, b);
+        const uint8_t *data = block_data(block);
+        bool newest = b + 1 == series->used;
+        uint64_t timestamp = block->first_timestamp;
+        uint64_t bits = block->first_bits;
+        int64_t delta = 0;
+        unsigned leading = 0, trailing = 0;
+        int_reader_t reader;
+        uint32_t pos = 0;
+        uint32_t i;
+
+        if (block->last_timestamp < from) {
+            continue;
+        }
+        if (block->first_timestamp >= to) {
+            break;
+        }
+
+        memset(&reader, 0, sizeof(reader));
+        reader.block = block;
+        if (newest) {
+            reader.pending = series->pending;
+            reader.pending_count = series->pending_count;
+        }
+
+        for (i = 0; i < block->count; i++) {
+            if (i > 0) {
+                int64_t dod;
+
+                if (!get_timestamp(data, block->bits, &pos, &dod)) {
+                    return MODBUS_CONV_ERR_FRAME;
+                }
+                delta = (int64_t)((uint64_t)delta + (uint64_t)dod);
+                timestamp += (uint64_t)delta;
+
+                if (floating) {
+                    uint64_t control, x = 0;
+
+                    if (!get_bits(data, block->bits, &pos, 1, &control)) {
+                        return MODBUS_CONV_ERR_FRAME;
+                    }
+                    if (control) {
+                        if (!get_bits(data, block->bits, &pos, 1, &control)) {
+                            return MODBUS_CONV_ERR_FRAME;
+                        }
+                        if (control) {
+                            uint64_t lead, len;
+
+                            if (!get_bits(data, block->bits, &pos, 5, &lead) ||
+                                !get_bits(data, block->bits, &pos, 6, &len) ||
+                                lead + len + 1 > width) {
+                                return MODBUS_CONV_ERR_FRAME;
+                            }
+                            leading = (unsigned)lead;
+                            trailing = width - leading - (unsigned)len - 1;
+                        }
+                        if (!get_bits(data, block->bits, &pos, width - leading - trailing, &x)) {
+                            return MODBUS_CONV_ERR_FRAME;
+                        }
+                        bits ^= x << trailing;
+                    }
+                } else {
+                    uint64_t zz;
+
+                    if (!next_int(series->block_size, &reader, &zz)) {
+                        return MODBUS_CONV_ERR_FRAME;
+                    }
+                    bits += (uint64_t)unzigzag(zz);
+                }
+            }
+
+            if (timestamp >= to) {
+                *count = n;
+                return MODBUS_CONV_OK;
+            }
+            if (timestamp < from) {
+                continue;
+            }
+            if (n == max_samples) {
+                *count = n;
+                return MODBUS_CONV_ERR_BUFFER;
+            }
+            timestamps[n] = timestamp;
+            values[n].u64 = 0;
+            store_bits(series->data_type, bits, &values[n]);
+            n++;
+        }
+    }
+
+    *count = n;
+    return MODBUS_CONV_OK;
+}
+
+size_t modbus_series_count(const modbus_series_t *series)
+{
+    size_t total = 0;
+    uint32_t b;
+
+    if (!series) {
+        return 0;
+    }
+    for (b = 0; b < series->used; b++) {
+        total += block_at(series, b)->count;
+    }
+    return total;
+}
+
+size_t modbus_series_bytes(const modbus_series_t *series)
+{
+    size_t total = 0;
+    uint32_t b;
+
+    if (!series) {
+        return 0;
+    }
+    for (b = 0; b < series->used; b++) {
+        const series_block_t *block = block_at(series, b);
+        total += sizeof(series_block_t) + (block->bits + 7u) / 8u + 8u * block->words;
+    }
+    return total;
+}
+
+/* Helper function implementations */
+
+/* n-th block counted from the oldest */
+static series_block_t *block_at(const modbus_series_t *series, uint32_t n)
+{
+    size_t index = ((size_t)series->oldest + n) % series->block_count;
+    return (series_block_t *)(void *)(series->blocks + index * series->block_size);
+}
+
+static uint8_t *block_data(const series_block_t *block)
+{
+    return (uint8_t *)(uintptr_t)block + sizeof(series_block_t);
+}
+
+static size_t free_bits(const modbus_series_t *series, const series_block_t *block)
+{
+    size_t data_bits = (series->block_size - sizeof(series_block_t) - 8u * block->words) * 8u;
+    return data_bits - block->bits;
+}
+
+/* Opens a new block holding one sample, recycling the oldest when needed */
+static void start_block(modbus_series_t *series, uint64_t timestamp, uint64_t bits)
+{
+    series_block_t *block;
+
+    if (series->used > 0 && !is_float(series->data_type)) {
+        pack_pending(series, block_at(series, series->used - 1), true);
+    }
+    if (series->used == series->block_count) {
+        series->oldest = (series->oldest + 1) % series->block_count;
+        series->used--;
+    }
+    while (series->retention && series->used > 0 &&
+           block_at(series, 0)->last_timestamp + series->retention < timestamp) {
+        series->oldest = (series->oldest + 1) % series->block_count;
+        series->used--;
+    }
+
+    series->used++;
+    block = block_at(series, series->used - 1);
+    block->first_timestamp = timestamp;
+    block->last_timestamp = timestamp;
+    block->first_bits = bits;
+    block->count = 1;
+    block->bits = 0;
+    block->words = 0;
+    block->reserved = 0;
+
+    series->last_timestamp = timestamp;
+    series->last_delta = 0;
+    series->last_bits = bits;
+    series->window = 0;
+    series->pending_count = 0;
+}
+
+/* Appends the low n bits of value, most significant first */
+static void put_bits(uint8_t *data, uint32_t *pos, uint64_t value, unsigned n)
+{
+    while (n > 0) {
+        unsigned offset = *pos & 7u;
+        unsigned room = 8u - offset;
+        unsigned take = n < room ? n : room;
+        unsigned chunk = (unsigned)(value >> (n - take)) & ((1u << take) - 1u);
+
+        if (offset == 0) {
+            data[*pos >> 3] = 0;
+        }
+        data[*pos >> 3] |= (uint8_t)(chunk << (room - take));
+        *pos += take;
+        n -= take;
+    }
+}
+
+static bool get_bits(const uint8_t *data, uint32_t limit, uint32_t *pos, unsigned n, uint64_t *value)
+{
+    uint64_t result = 0;
+
+    if (n > limit - *pos) {
+        return false;
+    }
+    while (n > 0) {
+        unsigned offset = *pos & 7u;
+        unsigned room = 8u - offset;
+        unsigned take = n < room ? n : room;
+        unsigned chunk = ((unsigned)data[*pos >> 3] >> (room - take)) & ((1u << take) - 1u);
+
+        result = (result << take) | chunk;
+        *pos += take;
+        n -= take;
+    }
+    *value = result;
+    return true;
+}
+
+static unsigned timestamp_bits(int64_t dod)
+{
+    if (dod == 0) {
+        return 1;
+    }
+    if (dod >= -63 && dod <= 64) {
+        return 2 + 7;
+    }
+    if (dod >= -255 && dod <= 256) {
+        return 3 + 9;
+    }
+    if (dod >= -2047 && dod <= 2048) {
+        return 4 + 12;
+    }
+    return TIMESTAMP_MAX_BITS;
+}
+
+static void put_timestamp(uint8_t *data, uint32_t *pos, int64_t dod)
+{
+    if (dod == 0) {
+        put_bits(data, pos, 0x0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        put_bits(data, pos, 0x2, 2);
+        put_bits(data, pos, (uint64_t)(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        put_bits(data, pos, 0x6, 3);
+        put_bits(data, pos, (uint64_t)(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        put_bits(data, pos, 0xE, 4);
+        put_bits(data, pos, (uint64_t)(dod + 2047), 12);
+    } else {
+        put_bits(data, pos, 0xF, 4);
+        put_bits(data, pos, (uint64_t)dod, 64);
+    }
+}
+
+static bool get_timestamp(const uint8_t *data, uint32_t limit, uint32_t *pos, int64_t *dod)
+{
+    static const unsigned widths[4] = { 7, 9, 12, 64 };
+    static const int64_t biases[4] = { 63, 255, 2047, 0 };
+    uint64_t bit, raw;
+    unsigned ones = 0;
+
+    /* Unary prefix of up to four ones */
+    while (ones < 4) {
+        if (!get_bits(data, limit, pos, 1, &bit)) {
+            return false;
+        }
+        if (!bit) {
+            break;
+        }
+        ones++;
+    }
+    if (ones == 0) {
+        *dod = 0;
+        return true;
+    }
+    if (!get_bits(data, limit, pos, widths[ones - 1], &raw)) {
+        return false;
+    }
+    *dod = (int64_t)raw - biases[ones - 1];
+    return true;
+}
+
+static void put_float(modbus_series_t *series, uint8_t *data, uint32_t *pos, uint64_t bits)
+{
+    unsigned width = float_width(series->data_type);
+    uint64_t x = bits ^ series->last_bits;
+    unsigned leading, trailing, length;
+
+    if (x == 0) {
+        put_bits(data, pos, 0x0, 1);
+        return;
+    }
+
+    leading = width - 1u - msb_index(x);
+    trailing = lsb_index(x);
+    if (leading > 31) {
+        leading = 31;
+    }
+
+    if (series->window && leading >= series->leading && trailing >= series->trailing) {
+        put_bits(data, pos, 0x2, 2);
+        put_bits(data, pos, x >> series->trailing, width - series->leading - series->trailing);
+        return;
+    }
+
+    length = width - leading - trailing;
+    put_bits(data, pos, 0x3, 2);
+    put_bits(data, pos, leading, 5);
+    put_bits(data, pos, length - 1u, 6);
+    put_bits(data, pos, x >> trailing, length);
+    series->leading = (uint8_t)leading;
+    series->trailing = (uint8_t)trailing;
+    series->window = 1;
+}
+
+static void put_word(const modbus_series_t *series, series_block_t *block, uint64_t word)
+{
+    uint8_t *dst = (uint8_t *)block + series->block_size - 8u * (block->words + 1u);
+    unsigned i;
+
+    for (i = 0; i < 8; i++) {
+        dst[i] = (uint8_t)(word >> (8 * i));
+    }
+    block->words++;
+}
+
+static uint64_t get_word(size_t block_size, const series_block_t *block, uint32_t n)
+{
+    const uint8_t *src = (const uint8_t *)block + block_size - 8u * (n + 1u);
+    uint64_t word = 0;
+    unsigned i;
+
+    for (i = 0; i < 8; i++) {
+        word |= (uint64_t)src[i] << (8 * i);
+    }
+    return word;
+}
+
+/*
+ * Packs pending deltas greedily: each word takes the largest run that fits.
+ * Without force, packing stops while a larger run could still fill up with
+ * future deltas, so the result matches packing the whole stream at once.
+ */
+static void pack_pending(modbus_series_t *series, series_block_t *block, bool force)
+{
+    while (series->pending_count > 0) {
+        const uint64_t *p = series->pending;
+        uint32_t k = series->pending_count;
+        uint32_t taken;
+
+        if (p[0] >> 60) {
+            put_word(series, block, 0);
+            put_word(series, block, p[0]);
+            taken = 1;
+        } else {
+            unsigned prefix[MODBUS_SERIES_PENDING];
+            unsigned max_width = 0;
+            unsigned sel = 15;
+            uint64_t word;
+            uint32_t i;
+            unsigned s;
+
+            for (i = 0; i < k; i++) {
+                unsigned w = bit_length(p[i]);
+                max_width = w > max_width ? w : max_width;
+                prefix[i] = max_width;
+            }
+            for (s = 2; s < 16; s++) {
+                if (s8b_count[s] > k) {
+                    if (!force && prefix[k - 1] <= s8b_width[s]) {
+                        return;
+                    }
+                    continue;
+                }
+                if (prefix[s8b_count[s] - 1] <= s8b_width[s]) {
+                    sel = s;
+                    break;
+                }
+            }
+
+            word = (uint64_t)sel << 60;
+            for (i = 0; i < s8b_count[sel]; i++) {
+                word |= p[i] << (i * s8b_width[sel]);
+            }
+            put_word(series, block, word);
+            taken = s8b_count[sel];
+        }
+
+        memmove(series->pending, series->pending + taken, (k - taken) * sizeof(uint64_t));
+        series->pending_count -= taken;
+    }
+}
+
+static bool next_int(size_t block_size, int_reader_t *reader, uint64_t *delta)
+{
+    if (reader->left == 0) {
+        unsigned sel;
+
+        if (reader->next_word >= reader->block->words) {
+            if (reader->next_pending >= reader->pending_count) {
+                return false;
+            }
+            *delta = reader->pending[reader->next_pending++];
+            return true;
+        }
+        reader->word = get_word(block_size, reader->block, reader->next_word++);
+        sel = (unsigned)(reader->word >> 60);
+        if (sel == 0) {
+            if (reader->next_word >= reader->block->words) {
+                return false;
+            }
+            *delta = get_word(block_size, reader->block, reader->next_word++);
+            return true;
+        }
+        if (sel == 1) {
+            return false;
+        }
+        reader->width = s8b_width[sel];
+        reader->left = s8b_count[sel];
+    }
+
+    *delta = reader->word & ((UINT64_C(1) << reader->width) - 1u);
+    reader->word >>= reader->width;
+    reader->left--;
+    return true;
+}
+
+static bool is_float(modbus_data_type_t data_type)
+{
+    return data_type > MODBUS_INT64_UNSIGNED_EFGHABCD && data_type <= MODBUS_IEEE_FLOAT64_EFGHABCD;
+}
+
+static unsigned float_width(modbus_data_type_t data_type)
+{
+    return modbus_type_reg_count(data_type) == 2 ? 32u : 64u;
+}
+
+static unsigned msb_index(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - (unsigned)__builtin_clzll(value);
+#else
+    unsigned n = 0;
+    while (value >>= 1) {
+        n++;
+    }
+    return n;
+#endif
+}
+
+static unsigned lsb_index(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(value);
+#else
+    unsigned n = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static unsigned bit_length(uint64_t value)
+{
+    return value ? msb_index(value) + 1u : 0u;
+}
+
+/* Value as 64 bits: integers widened, floats by bit pattern */
+static uint64_t load_bits(modbus_data_type_t data_type, const modbus_value_t *value)
+{
+    switch (data_type) {
+        case MODBUS_BIT_BOOLEAN:
+            return value->bool_val ? 1 : 0;
+        case MODBUS_INT8_SIGNED:
+            return (uint64_t)(int64_t)value->i8;
+        case MODBUS_INT8_UNSIGNED:
+            return value->u8;
+        case MODBUS_INT16_SIGNED_AB:
+        case MODBUS_INT16_SIGNED_BA:
+            return (uint64_t)(int64_t)value->i16;
+        case MODBUS_INT16_UNSIGNED_AB:
+        case MODBUS_INT16_UNSIGNED_BA:
+            return value->u16;
+        default:
+            break;
+    }
+
+    if (data_type <= MODBUS_INT32_SIGNED_CDAB) {
+        return (uint64_t)(int64_t)value->i32;
+    }
+    if (data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        return value->u32;
+    }
+    if (data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        return value->u64;
+    }
+    if (data_type <= MODBUS_IEEE_FLOAT32_BADC) {
+        return value->u32;
+    }
+    return value->u64;
+}
+
+static void store_bits(modbus_data_type_t data_type, uint64_t bits, modbus_value_t *value)
+{
+    switch (modbus_type_reg_count(data_type)) {
+        case 1:
+            switch (data_type) {
+                case MODBUS_BIT_BOOLEAN:
+                    value->bool_val = bits != 0;
+                    break;
+                case MODBUS_INT8_SIGNED:
+                case MODBUS_INT8_UNSIGNED:
+                    value->u8 = (uint8_t)bits;
+                    break;
+                default:
+                    value->u16 = (uint16_t)bits;
+                    break;
+            }
+            break;
+        case 2:
+            value->u32 = (uint32_t)bits;
+            break;
+        default:
+            value->u64 = bits;
+            break;
+    }
+}
+
+static uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
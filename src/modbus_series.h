@@ -0,0 +1,139 @@
+/**
+ * @file modbus_series.h
+ * @brief Compressed in-memory time series of converted values
+ * @details Each point keeps a ring of fixed-size blocks in caller storage.
+ *          Blocks are independently decodable and record their time range,
+ *          so range scans skip blocks outside the requested window and the
+ *          oldest block is recycled when the ring is full or its samples
+ *          fall out of the retention window.
+ *
+ *          Timestamps are stored as delta-of-delta codes (1 bit for a steady
+ *          polling interval). Float values are XORed with the previous value
+ *          and only the meaningful bits are kept (Gorilla encoding). Integer
+ *          and boolean values are stored as zigzag deltas packed into 64-bit
+ *          simple-8b words.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_SERIES_H
+#define MODBUS_SERIES_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Integer deltas waiting for a full simple-8b word */
+#define MODBUS_SERIES_PENDING           60
+
+/* Smallest accepted block size in bytes */
+#define MODBUS_SERIES_MIN_BLOCK         128
+
+/* Time series of one point */
+typedef struct {
+    uint8_t *blocks;                /* block_count blocks of block_size bytes (caller storage) */
+    size_t block_size;              /* Bytes per block, multiple of 8 */
+    uint32_t block_count;           /* Blocks in the ring */
+    uint32_t oldest;                /* Ring index of the oldest block */
+    uint32_t used;                  /* Blocks holding samples */
+    modbus_data_type_t data_type;   /* Point data type */
+    uint64_t retention;             /* Drop blocks older than this (0 = ring size only) */
+
+    /* Encoder state of the newest block */
+    uint64_t last_timestamp;        /* Timestamp of the last sample */
+    int64_t last_delta;             /* Last timestamp delta */
+    uint64_t last_bits;             /* Last value as 64 bits */
+    uint8_t leading;                /* Float: leading zeros of the last XOR window */
+    uint8_t trailing;               /* Float: trailing zeros of the last XOR window */
+    uint8_t window;                 /* Float: an XOR window is set */
+    uint32_t pending_count;         /* Integer: deltas not yet packed */
+    uint64_t pending[MODBUS_SERIES_PENDING];
+} modbus_series_t;
+
+/**
+ * @brief Initialize an empty series
+ * @param series Series to initialize
+ * @param data_type Data type of the point
+ * @param storage Block storage, 8-byte aligned
+ * @param storage_size Size of storage; whole blocks of block_size are used
+ * @param block_size Bytes per block (multiple of 8, at least MODBUS_SERIES_MIN_BLOCK)
+ * @param retention Age after which blocks are dropped, in timestamp units (0 = keep until overwritten)
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE for an invalid
+ *         type or block size, MODBUS_CONV_ERR_BUFFER if storage holds less than two blocks
+ */
+int modbus_series_init(modbus_series_t *series,
+                       modbus_data_type_t data_type,
+                       void *storage,
+                       size_t storage_size,
+                       size_t block_size,
+                       uint64_t retention);
+
+/**
+ * @brief Append one sample
+ * @details Timestamps should not decrease; range scans assume ordered samples.
+ * @param series Series
+ * @param timestamp Sample timestamp
+ * @param value Sample value
+ * @return MODBUS_CONV_OK on success
+ */
+int modbus_series_append(modbus_series_t *series, uint64_t timestamp, const modbus_value_t *value);
+
+/**
+ * @brief Append the results of one plan execution
+ * @details Point i is appended to series[i]; failed points are skipped.
+ * @param series Array of plan->point_count series
+ * @param plan Plan the values were produced with
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Sample timestamp
+ * @return MODBUS_CONV_OK on success
+ */
+int modbus_series_append_plan(modbus_series_t *series,
+                              const modbus_plan_t *plan,
+                              const modbus_value_t *values,
+                              const int *status,
+                              uint64_t timestamp);
+
+/**
+ * @brief Decode the samples with from <= timestamp < to
+ * @details When more samples match than fit, the first max_samples are
+ *          returned; scan again from the last returned timestamp + 1.
+ * @param series Series
+ * @param from First timestamp of the range
+ * @param to End of the range (exclusive)
+ * @param timestamps Array receiving sample timestamps
+ * @param values Array receiving sample values
+ * @param max_samples Capacity of both arrays
+ * @param count Pointer to store the number of samples returned
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if more samples
+ *         remain, MODBUS_CONV_ERR_FRAME if a block is corrupt
+ */
+int modbus_series_scan(const modbus_series_t *series,
+                       uint64_t from,
+                       uint64_t to,
+                       uint64_t *timestamps,
+                       modbus_value_t *values,
+                       size_t max_samples,
+                       size_t *count);
+
+/**
+ * @brief Number of samples held
+ * @param series Series
+ * @return Sample count
+ */
+size_t modbus_series_count(const modbus_series_t *series);
+
+/**
+ * @brief Bytes of block storage holding encoded samples
+ * @param series Series
+ * @return Encoded size, useful for compression statistics
+ */
+size_t modbus_series_bytes(const modbus_series_t *series);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_SERIES_H */
@@ -0,0 +1,243 @@
+/**
+ * @file modbus_shm.c
+ * @brief Shared-memory value table implementation
+ * @author Mouli Sai
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "modbus_shm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Seqlock accesses. Data words use relaxed atomics so readers racing with
+ * the writer stay well-defined; the fences order them against the sequence.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define SHM_LOAD(p)             __atomic_load_n((p), __ATOMIC_RELAXED)
+#define SHM_LOAD_ACQUIRE(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SHM_STORE(p, v)         __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define SHM_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define SHM_FENCE_ACQUIRE()     __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define SHM_FENCE_RELEASE()     __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#error "modbus_shm.c requires GCC or Clang __atomic builtins"
+#endif
+
+/* Attempts before a reader gives up on an entry that stays locked */
+#define SHM_READ_RETRIES        1000000
+
+/* Helper function prototypes */
+static size_t segment_size(uint32_t point_count);
+static int map_segment(modbus_shm_t *shm, int fd, size_t size, int prot);
+
+int modbus_shm_create(modbus_shm_t *shm, const char *name, uint32_t point_count)
+{
+    modbus_shm_header_t *header;
+    size_t size;
+    uint32_t i;
+    int fd;
+
+    if (!shm || !name) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    size = segment_size(point_count);
+    /* Resizing and resetting a segment that readers map would fault them */
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+    if (ftruncate(fd, (off_t)size) != 0 || map_segment(shm, fd, size, PROT_READ | PROT_WRITE) != 0) {
+        int saved = errno;
+        /* The segment is ours; leaving it would make the next create fail */
+        shm_unlink(name);
+        close(fd);
+        errno = saved;
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+    close(fd);
+
+    /* Readers accept the segment only once the magic is published */
+    header = shm->header;
+    SHM_STORE_RELEASE(&header->magic, 0u);
+    header->version = MODBUS_SHM_VERSION;
+    header->point_count = point_count;
+    header->entry_size = sizeof(modbus_shm_entry_t);
+    SHM_STORE(&header->updates, (uint64_t)0);
+    for (i = 0; i < point_count; i++) {
+        modbus_shm_entry_t *e = &shm->entries[i];
+        SHM_STORE(&e->seq, (uint64_t)0);
+        SHM_STORE(&e->timestamp, (uint64_t)0);
+        SHM_STORE(&e->value, (uint64_t)0);
+        SHM_STORE(&e->meta, (uint64_t)(uint32_t)MODBUS_CONV_ERR_UNKNOWN);
+    }
+    shm->point_count = point_count;
+    SHM_STORE_RELEASE(&header->magic, MODBUS_SHM_MAGIC);
+    return MODBUS_CONV_OK;
+}
+
+int modbus_shm_open(modbus_shm_t *shm, const char *name)
+{
+    const modbus_shm_header_t *header;
+    struct stat st;
+    int fd;
+
+    if (!shm || !name) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(modbus_shm_header_t) ||
+        map_segment(shm, fd, (size_t)st.st_size, PROT_READ) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved ? saved : EINVAL;
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+    close(fd);
+
+    header = shm->header;
+    if (SHM_LOAD_ACQUIRE(&header->magic) != MODBUS_SHM_MAGIC ||
+        header->version != MODBUS_SHM_VERSION ||
+        header->entry_size != sizeof(modbus_shm_entry_t) ||
+        shm->size < segment_size(header->point_count)) {
+        modbus_shm_close(shm);
+        errno = EINVAL;
+        return MODBUS_CONV_ERR_SYSTEM;
+    }
+    shm->point_count = header->point_count;
+    return MODBUS_CONV_OK;
+}
+
+void modbus_shm_close(modbus_shm_t *shm)
+{
+    if (!shm || !shm->base) {
+        return;
+    }
+    munmap(shm->base, shm->size);
+    memset(shm, 0, sizeof(*shm));
+}
+
+int modbus_shm_unlink(const char *name)
+{
+    if (!name) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    return shm_unlink(name) == 0 ? MODBUS_CONV_OK : MODBUS_CONV_ERR_SYSTEM;
+}
+
+int modbus_shm_publish(modbus_shm_t *shm,
+                       uint32_t first,
+                       const modbus_plan_t *plan,
+                       const modbus_value_t *values,
+                       const int *status,
+                       uint64_t timestamp)
+{
+    size_t i;
+
+    if (!shm || !shm->base || !plan || !values) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (first > shm->point_count || plan->point_count > shm->point_count - first) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    for (i = 0; i < plan->point_count; i++) {
+        modbus_shm_entry_t *e = &shm->entries[first + i];
+        uint64_t seq = SHM_LOAD(&e->seq);
+        int32_t st = status ? (int32_t)status[i] : MODBUS_CONV_OK;
+        uint64_t value = 0;
+
+        memcpy(&value, &values[i], sizeof(values[i]) < sizeof(value) ? sizeof(values[i]) : sizeof(value));
+
+        SHM_STORE(&e->seq, seq + 1);
+        SHM_FENCE_RELEASE();
+        SHM_STORE(&e->timestamp, timestamp);
+        SHM_STORE(&e->value, value);
+        SHM_STORE(&e->meta, (uint64_t)(uint32_t)st | ((uint64_t)plan->points[i].data_type << 32));
+        SHM_STORE_RELEASE(&e->seq, seq + 2);
+    }
+
+    SHM_STORE_RELEASE(&shm->header->updates, SHM_LOAD(&shm->header->updates) + 1);
+    return MODBUS_CONV_OK;
+}
+
+int modbus_shm_read(const modbus_shm_t *shm, uint32_t index, modbus_shm_value_t *out)
+{
+    const modbus_shm_entry_t *e;
+    uint32_t attempt;
+
+    if (!shm || !shm->base || !out) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if (index >= shm->point_count) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+
+    e = &shm->entries[index];
+    for (attempt = 0; attempt < SHM_READ_RETRIES; attempt++) {
+        uint64_t seq = SHM_LOAD_ACQUIRE(&e->seq);
+        uint64_t timestamp, value, meta;
+
+        if (seq & 1) {
+            continue;
+        }
+        timestamp = SHM_LOAD(&e->timestamp);
+        value = SHM_LOAD(&e->value);
+        meta = SHM_LOAD(&e->meta);
+        SHM_FENCE_ACQUIRE();
+        if (SHM_LOAD(&e->seq) != seq) {
+            continue;
+        }
+
+        memset(&out->value, 0, sizeof(out->value));
+        memcpy(&out->value, &value, sizeof(out->value) < sizeof(value) ? sizeof(out->value) : sizeof(value));
+        out->timestamp = timestamp;
+        out->status = (int32_t)(uint32_t)meta;
+        out->data_type = (modbus_data_type_t)(meta >> 32);
+        return MODBUS_CONV_OK;
+    }
+
+    errno = EAGAIN;
+    return MODBUS_CONV_ERR_SYSTEM;
+}
+
+uint64_t modbus_shm_updates(const modbus_shm_t *shm)
+{
+    if (!shm || !shm->base) {
+        return 0;
+    }
+    return SHM_LOAD_ACQUIRE(&shm->header->updates);
+}
+
+/* Helper function implementations */
+static size_t segment_size(uint32_t point_count)
+{
+    return sizeof(modbus_shm_header_t) + (size_t)point_count * sizeof(modbus_shm_entry_t);
+}
+
+static int map_segment(modbus_shm_t *shm, int fd, size_t size, int prot)
+{
+    void *base = mmap(NULL, size, prot, MAP_SHARED, fd, 0);
+
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    shm->base = base;
+    shm->size = size;
+    shm->header = (modbus_shm_header_t *)base;
+    shm->entries = (modbus_shm_entry_t *)(void *)((uint8_t *)base + sizeof(modbus_shm_header_t));
+    shm->point_count = 0;
+    return 0;
+}
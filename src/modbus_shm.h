@@ -0,0 +1,142 @@
+/**
+ * @file modbus_shm.h
+ * @brief Shared-memory table of the latest converted values
+ * @details The converter creates a POSIX shared-memory segment holding one
+ *          entry per point (value, status, data type, timestamp) and
+ *          publishes plan results into it. Other processes on the host map
+ *          the segment read-only and read entries directly. Every entry is
+ *          guarded by its own sequence lock, so readers never block the
+ *          converter and never see a torn value; a reader only retries when
+ *          it raced with an update of the same entry.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_SHM_H
+#define MODBUS_SHM_H
+
+#include "modbus_plan.h"
+#include "modbus_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Segment identification */
+#define MODBUS_SHM_MAGIC                0x4D425354u    /* "MBST" */
+#define MODBUS_SHM_VERSION              1
+
+/* Segment header, one cache line */
+typedef struct {
+    uint32_t magic;                 /* MODBUS_SHM_MAGIC once initialized */
+    uint32_t version;               /* MODBUS_SHM_VERSION */
+    uint32_t point_count;           /* Entries in the table */
+    uint32_t entry_size;            /* sizeof(modbus_shm_entry_t) */
+    uint64_t updates;               /* Publish calls completed, for change polling */
+    uint8_t reserved[MODBUS_CACHE_LINE - 24];
+} modbus_shm_header_t;
+
+/* Table entry; fields are only accessed through the seqlock */
+typedef struct {
+    uint64_t seq;                   /* Odd while the entry is being written */
+    uint64_t timestamp;             /* Timestamp of the last publish */
+    uint64_t value;                 /* modbus_value_t bytes */
+    uint64_t meta;                  /* Status (low 32 bits) and data type (high 32 bits) */
+} modbus_shm_entry_t;
+
+/* Consistent copy of one entry */
+typedef struct {
+    modbus_value_t value;           /* Last converted value */
+    uint64_t timestamp;             /* Timestamp passed to modbus_shm_publish() */
+    int status;                     /* Conversion status, MODBUS_CONV_ERR_UNKNOWN before the first publish */
+    modbus_data_type_t data_type;   /* Data type of the value */
+} modbus_shm_value_t;
+
+/* Mapped segment */
+typedef struct {
+    void *base;                     /* Mapping address */
+    size_t size;                    /* Mapping size */
+    modbus_shm_header_t *header;
+    modbus_shm_entry_t *entries;
+    uint32_t point_count;
+} modbus_shm_t;
+
+/**
+ * @brief Create and map a new segment for writing
+ * @details An existing segment is never reused, since readers may have it
+ *          mapped. To replace one left by an earlier run, call
+ *          modbus_shm_unlink() first; readers keep the old mapping until they
+ *          reopen the name.
+ * @param shm Handle to initialize
+ * @param name Segment name, e.g. "/modbus_values"
+ * @param point_count Number of entries
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_SYSTEM on failure (errno is
+ *         set, EEXIST if the segment already exists)
+ */
+int modbus_shm_create(modbus_shm_t *shm, const char *name, uint32_t point_count);
+
+/**
+ * @brief Map an existing segment read-only
+ * @param shm Handle to initialize
+ * @param name Segment name
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_SYSTEM on failure or if
+ *         the segment is not (yet) a valid table (errno is set)
+ */
+int modbus_shm_open(modbus_shm_t *shm, const char *name);
+
+/**
+ * @brief Unmap a segment
+ * @param shm Handle
+ */
+void modbus_shm_close(modbus_shm_t *shm);
+
+/**
+ * @brief Remove a segment name (mappings stay valid until closed)
+ * @param name Segment name
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_SYSTEM on failure (errno is set)
+ */
+int modbus_shm_unlink(const char *name);
+
+/**
+ * @brief Publish the results of one plan execution
+ * @details Single writer: only one thread may publish into a segment.
+ * @param shm Writable handle
+ * @param first Entry of the first plan point
+ * @param plan Plan the values were produced with
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param timestamp Timestamp stored with every entry
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if the points do
+ *         not fit in the table
+ */
+int modbus_shm_publish(modbus_shm_t *shm,
+                       uint32_t first,
+                       const modbus_plan_t *plan,
+                       const modbus_value_t *values,
+                       const int *status,
+                       uint64_t timestamp);
+
+/**
+ * @brief Read one entry consistently
+ * @param shm Handle
+ * @param index Entry index
+ * @param out Receives the entry
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if index is out of
+ *         range, MODBUS_CONV_ERR_SYSTEM (errno EAGAIN) if the entry stayed
+ *         locked, e.g. because the writer died mid-update
+ */
+int modbus_shm_read(const modbus_shm_t *shm, uint32_t index, modbus_shm_value_t *out);
+
+/**
+ * @brief Number of completed publish calls
+ * @details Readers can poll this counter and skip reading when it is unchanged.
+ * @param shm Handle
+ * @return Update counter
+ */
+uint64_t modbus_shm_updates(const modbus_shm_t *shm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_SHM_H */
@@ -0,0 +1,260 @@
+/**
+ * @file modbus_sparkplug.c
+ * @brief Sparkplug B payload encoder implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_sparkplug.h"
+#include "modbus_format.h"
+#include <string.h>
+
+/* Protobuf keys: field number << 3 | wire type */
+#define PB_VARINT               0
+#define PB_FIXED64              1
+#define PB_BYTES                2
+#define PB_FIXED32              5
+#define PB_KEY(field, wire)     (uint8_t)(((field) << 3) | (wire))
+
+/* Payload fields */
+#define PAYLOAD_TIMESTAMP       PB_KEY(1, PB_VARINT)
+#define PAYLOAD_METRIC          PB_KEY(2, PB_BYTES)
+#define PAYLOAD_SEQ             PB_KEY(3, PB_VARINT)
+
+/* Metric fields */
+#define METRIC_NAME             PB_KEY(1, PB_BYTES)
+#define METRIC_ALIAS            PB_KEY(2, PB_VARINT)
+#define METRIC_TIMESTAMP        PB_KEY(3, PB_VARINT)
+#define METRIC_DATATYPE         PB_KEY(4, PB_VARINT)
+#define METRIC_IS_NULL          PB_KEY(7, PB_VARINT)
+#define METRIC_INT_VALUE        PB_KEY(10, PB_VARINT)
+#define METRIC_LONG_VALUE       PB_KEY(11, PB_VARINT)
+#define METRIC_FLOAT_VALUE      PB_KEY(12, PB_FIXED32)
+#define METRIC_DOUBLE_VALUE     PB_KEY(13, PB_FIXED64)
+#define METRIC_BOOLEAN_VALUE    PB_KEY(14, PB_VARINT)
+
+/* Worst case of a metric without its name: key, length, alias, timestamp,
+   datatype, is_null and value */
+#define METRIC_MAX_FIXED        (1 + 3 + 11 + 11 + 2 + 2 + 11)
+
+/* Helper function prototypes */
+static size_t put_varint(uint8_t *dst, uint64_t value);
+static size_t varint_len(uint64_t value);
+static size_t put_fixed(uint8_t *dst, uint64_t value, size_t n);
+static size_t put_value(uint8_t *dst, uint32_t datatype, const modbus_value_t *value);
+
+uint32_t modbus_sparkplug_datatype(modbus_data_type_t data_type)
+{
+    switch (data_type) {
+        case MODBUS_BIT_BOOLEAN:
+            return MODBUS_SPARKPLUG_BOOLEAN;
+        case MODBUS_INT8_SIGNED:
+            return MODBUS_SPARKPLUG_INT8;
+        case MODBUS_INT8_UNSIGNED:
+            return MODBUS_SPARKPLUG_UINT8;
+        case MODBUS_INT16_SIGNED_AB:
+        case MODBUS_INT16_SIGNED_BA:
+            return MODBUS_SPARKPLUG_INT16;
+        case MODBUS_INT16_UNSIGNED_AB:
+        case MODBUS_INT16_UNSIGNED_BA:
+            return MODBUS_SPARKPLUG_UINT16;
+        default:
+            break;
+    }
+
+    if ((int)data_type < 0) {
+        return 0;
+    }
+    if (data_type <= MODBUS_INT32_SIGNED_CDAB) {
+        return MODBUS_SPARKPLUG_INT32;
+    }
+    if (data_type <= MODBUS_INT32_UNSIGNED_CDAB) {
+        return MODBUS_SPARKPLUG_UINT32;
+    }
+    if (data_type <= MODBUS_INT64_SIGNED_EFGHABCD) {
+        return MODBUS_SPARKPLUG_INT64;
+    }
+    if (data_type <= MODBUS_INT64_UNSIGNED_EFGHABCD) {
+        return MODBUS_SPARKPLUG_UINT64;
+    }
+    if (data_type <= MODBUS_IEEE_FLOAT32_BADC) {
+        return MODBUS_SPARKPLUG_FLOAT;
+    }
+    if (data_type <= MODBUS_IEEE_FLOAT64_EFGHABCD) {
+        return MODBUS_SPARKPLUG_DOUBLE;
+    }
+    return 0;
+}
+
+int modbus_sparkplug_encode(uint8_t *buf,
+                            size_t size,
+                            size_t *len,
+                            const modbus_plan_t *plan,
+                            const modbus_sparkplug_metric_t *metrics,
+                            const modbus_value_t *values,
+                            const int *status,
+                            const modbus_sparkplug_options_t *options)
+{
+    size_t count;
+    size_t pos = 0;
+    size_t n;
+
+    if (!buf || !len || !plan || !values || !options) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    /* Payload timestamp */
+    if (size < 11) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    buf[pos++] = PAYLOAD_TIMESTAMP;
+    pos += put_varint(buf + pos, options->timestamp);
+
+    count = options->indices ? options->index_count : plan->point_count;
+    for (n = 0; n < count; n++) {
+        size_t i = options->indices ? options->indices[n] : n;
+        char generated[MODBUS_FORMAT_MAX + 1];
+        const char *name = NULL;
+        size_t name_len = 0;
+        uint32_t datatype;
+        size_t body, body_len, prefix;
+
+        if (i >= plan->point_count) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+        datatype = modbus_sparkplug_datatype(plan->points[i].data_type);
+
+        if (options->birth) {
+            if (metrics) {
+                name = metrics[i].name;
+            } else {
+                generated[0] = 'p';
+                modbus_format_u64(i, generated + 1);
+                name = generated;
+            }
+            name_len = strlen(name);
+        }
+        if (size - pos < METRIC_MAX_FIXED + (name ? 1 + varint_len(name_len) + name_len : 0)) {
+            return MODBUS_CONV_ERR_BUFFER;
+        }
+
+        /* Metric body is written after a one-byte length, widened below if needed */
+        buf[pos] = PAYLOAD_METRIC;
+        body = pos + 2;
+        pos = body;
+        if (name) {
+            buf[pos++] = METRIC_NAME;
+            pos += put_varint(buf + pos, name_len);
+            memcpy(buf + pos, name, name_len);
+            pos += name_len;
+        }
+        buf[pos++] = METRIC_ALIAS;
+        pos += put_varint(buf + pos, metrics ? metrics[i].alias : i);
+        buf[pos++] = METRIC_TIMESTAMP;
+        pos += put_varint(buf + pos, options->timestamp);
+        if (options->birth) {
+            buf[pos++] = METRIC_DATATYPE;
+            pos += put_varint(buf + pos, datatype);
+        }
+        if (status && status[i] != MODBUS_CONV_OK) {
+            buf[pos++] = METRIC_IS_NULL;
+            buf[pos++] = 1;
+        } else {
+            pos += put_value(buf + pos, datatype, &values[i]);
+        }
+
+        body_len = pos - body;
+        prefix = varint_len(body_len);
+        if (prefix > 1) {
+            memmove(buf + body + prefix - 1, buf + body, body_len);
+            pos += prefix - 1;
+        }
+        put_varint(buf + body - 1, body_len);
+    }
+
+    if (size - pos < 2) {
+        return MODBUS_CONV_ERR_BUFFER;
+    }
+    buf[pos++] = PAYLOAD_SEQ;
+    pos += put_varint(buf + pos, options->seq);
+
+    *len = pos;
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+static size_t put_varint(uint8_t *dst, uint64_t value)
+{
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        dst[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    dst[n++] = (uint8_t)value;
+    return n;
+}
+
+static size_t varint_len(uint64_t value)
+{
+    size_t n = 1;
+
+    while (value >= 0x80) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static size_t put_fixed(uint8_t *dst, uint64_t value, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        dst[i] = (uint8_t)(value >> (8 * i));
+    }
+    return n;
+}
+
+/* Writes the value field matching the datatype */
+static size_t put_value(uint8_t *dst, uint32_t datatype, const modbus_value_t *value)
+{
+    switch (datatype) {
+        case MODBUS_SPARKPLUG_BOOLEAN:
+            dst[0] = METRIC_BOOLEAN_VALUE;
+            dst[1] = value->bool_val ? 1 : 0;
+            return 2;
+        /* Signed types travel as their two's complement in uint32/uint64 */
+        case MODBUS_SPARKPLUG_INT8:
+            dst[0] = METRIC_INT_VALUE;
+            return 1 + put_varint(dst + 1, (uint32_t)(int32_t)value->i8);
+        case MODBUS_SPARKPLUG_INT16:
+            dst[0] = METRIC_INT_VALUE;
+            return 1 + put_varint(dst + 1, (uint32_t)(int32_t)value->i16);
+        case MODBUS_SPARKPLUG_INT32:
+            dst[0] = METRIC_INT_VALUE;
+            return 1 + put_varint(dst + 1, (uint32_t)value->i32);
+        case MODBUS_SPARKPLUG_UINT8:
+            dst[0] = METRIC_INT_VALUE;
+            return 1 + put_varint(dst + 1, value->u8);
+        case MODBUS_SPARKPLUG_UINT16:
+            dst[0] = METRIC_INT_VALUE;
+            return 1 + put_varint(dst + 1, value->u16);
+        case MODBUS_SPARKPLUG_UINT32:
+            dst[0] = METRIC_INT_VALUE;
+            return 1 + put_varint(dst + 1, value->u32);
+        case MODBUS_SPARKPLUG_INT64:
+        case MODBUS_SPARKPLUG_UINT64:
+            dst[0] = METRIC_LONG_VALUE;
+            return 1 + put_varint(dst + 1, value->u64);
+        case MODBUS_SPARKPLUG_FLOAT:
+            dst[0] = METRIC_FLOAT_VALUE;
+            return 1 + put_fixed(dst + 1, value->u32, 4);
+        case MODBUS_SPARKPLUG_DOUBLE:
+            dst[0] = METRIC_DOUBLE_VALUE;
+            return 1 + put_fixed(dst + 1, value->u64, 8);
+        default:
+            dst[0] = METRIC_IS_NULL;
+            dst[1] = 1;
+            return 2;
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * @file modbus_sparkplug.h
+ * @brief Sparkplug B payload encoding of plan results
+ * @details Writes the Sparkplug B protobuf Payload message (timestamp, seq
+ *          and one Metric per point) straight from conversion results into a
+ *          caller buffer, without a protobuf runtime and without allocation.
+ *          Birth payloads carry metric names, aliases and datatypes; data
+ *          payloads carry aliases and values only.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_SPARKPLUG_H
+#define MODBUS_SPARKPLUG_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sparkplug B metric datatypes used for Modbus values */
+#define MODBUS_SPARKPLUG_INT8           1
+#define MODBUS_SPARKPLUG_INT16          2
+#define MODBUS_SPARKPLUG_INT32          3
+#define MODBUS_SPARKPLUG_INT64          4
+#define MODBUS_SPARKPLUG_UINT8          5
+#define MODBUS_SPARKPLUG_UINT16         6
+#define MODBUS_SPARKPLUG_UINT32         7
+#define MODBUS_SPARKPLUG_UINT64         8
+#define MODBUS_SPARKPLUG_FLOAT          9
+#define MODBUS_SPARKPLUG_DOUBLE         10
+#define MODBUS_SPARKPLUG_BOOLEAN        11
+
+/* Metric metadata for one point */
+typedef struct {
+    const char *name;               /* Metric name, e.g. "Meter/Power" */
+    uint64_t alias;                 /* Metric alias used in data payloads */
+} modbus_sparkplug_metric_t;
+
+/* Payload options */
+typedef struct {
+    uint64_t timestamp;             /* Payload and metric timestamp (Unix ms) */
+    uint8_t seq;                    /* Sequence number (0-255) */
+    bool birth;                     /* NBIRTH/DBIRTH: include names and datatypes */
+    const uint32_t *indices;        /* Points to include (e.g. changed ones), NULL for all */
+    size_t index_count;             /* Number of indices */
+} modbus_sparkplug_options_t;
+
+/**
+ * @brief Sparkplug B datatype of a point data type
+ * @param data_type Modbus data type
+ * @return MODBUS_SPARKPLUG_* datatype, 0 (Unknown) for an invalid type
+ */
+uint32_t modbus_sparkplug_datatype(modbus_data_type_t data_type);
+
+/**
+ * @brief Encode plan results as a Sparkplug B payload
+ * @details Failed points are sent with is_null set. Without metrics, points
+ *          are named "p0", "p1", ... and aliased by their index.
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ * @param len Pointer to store the payload length
+ * @param plan Plan the values were produced with
+ * @param metrics Per-point metric metadata, may be NULL
+ * @param values Values from modbus_plan_execute()
+ * @param status Per-point status from modbus_plan_execute(), may be NULL
+ * @param options Timestamp, sequence number, birth flag and point selection
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_BUFFER if buf is too small,
+ *         MODBUS_CONV_ERR_INVALID_TYPE if an index is out of range
+ */
+int modbus_sparkplug_encode(uint8_t *buf,
+                            size_t size,
+                            size_t *len,
+                            const modbus_plan_t *plan,
+                            const modbus_sparkplug_metric_t *metrics,
+                            const modbus_value_t *values,
+                            const int *status,
+                            const modbus_sparkplug_options_t *options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_SPARKPLUG_H */
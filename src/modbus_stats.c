@@ -0,0 +1,117 @@
+/**
+ * @file modbus_stats.c
+ * @brief Sharded per-thread conversion counters implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_stats.h"
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define STATS_TLS           __thread
+#define STATS_LOAD(p)       __atomic_load_n((p), __ATOMIC_RELAXED)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define STATS_TLS           _Thread_local
+#define STATS_LOAD(p)       (*(volatile const uint64_t *)(p))
+#else
+/* No thread-local storage: single-threaded targets share one binding */
+#define STATS_TLS
+#define STATS_LOAD(p)       (*(volatile const uint64_t *)(p))
+#endif
+
+static STATS_TLS modbus_stats_shard_t *local_shard;
+static modbus_stats_shard_t *shard_list;
+
+/* Helper function prototypes */
+static bool shard_registered(const modbus_stats_shard_t *shard);
+static void shard_register(modbus_stats_shard_t *shard);
+
+int modbus_stats_attach(modbus_stats_shard_t *shard)
+{
+    if (!shard) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    /* Counters are zeroed only before the first registration; snapshots
+     * already include a registered shard, so clearing it would make the
+     * merged totals go backwards */
+    if (!shard_registered(shard)) {
+        memset(&shard->stats, 0, sizeof(shard->stats));
+        shard_register(shard);
+    }
+    local_shard = shard;
+    return MODBUS_CONV_OK;
+}
+
+modbus_stats_t *modbus_stats_local(void)
+{
+#ifdef MODBUS_CONV_NO_STATS
+    return NULL;
+#else
+    return local_shard ? &local_shard->stats : NULL;
+#endif
+}
+
+int modbus_stats_snapshot(modbus_stats_t *snapshot)
+{
+    const modbus_stats_shard_t *shard;
+    size_t i;
+
+    if (!snapshot) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    memset(snapshot, 0, sizeof(*snapshot));
+#if defined(__GNUC__) || defined(__clang__)
+    shard = __atomic_load_n(&shard_list, __ATOMIC_ACQUIRE);
+#else
+    shard = shard_list;
+#endif
+    for (; shard; shard = shard->next) {
+        const modbus_stats_t *s = &shard->stats;
+        for (i = 0; i < MODBUS_STATS_TYPES; i++) {
+            snapshot->conversions[i] += STATS_LOAD(&s->conversions[i]);
+        }
+        for (i = 0; i < MODBUS_STATS_ERRORS; i++) {
+            snapshot->errors[i] += STATS_LOAD(&s->errors[i]);
+        }
+        snapshot->scaling_overflows += STATS_LOAD(&s->scaling_overflows);
+        snapshot->plans_executed += STATS_LOAD(&s->plans_executed);
+        snapshot->frames_parsed += STATS_LOAD(&s->frames_parsed);
+        snapshot->frame_errors += STATS_LOAD(&s->frame_errors);
+    }
+
+    return MODBUS_CONV_OK;
+}
+
+/* Helper function implementations */
+static bool shard_registered(const modbus_stats_shard_t *shard)
+{
+    const modbus_stats_shard_t *s;
+
+#if defined(__GNUC__) || defined(__clang__)
+    s = __atomic_load_n(&shard_list, __ATOMIC_ACQUIRE);
+#else
+    s = shard_list;
+#endif
+    for (; s; s = s->next) {
+        if (s == shard) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void shard_register(modbus_stats_shard_t *shard)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    modbus_stats_shard_t *head = __atomic_load_n(&shard_list, __ATOMIC_RELAXED);
+    do {
+        shard->next = head;
+    } while (!__atomic_compare_exchange_n(&shard_list, &head, shard, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+#else
+    shard->next = shard_list;
+    shard_list = shard;
+#endif
+}
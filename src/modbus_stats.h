@@ -0,0 +1,102 @@
+/**
+ * @file modbus_stats.h
+ * @brief Sharded per-thread conversion counters
+ * @details Each converting thread attaches its own cache-line aligned shard;
+ *          the plan executor and frame decoder increment the calling thread's
+ *          shard without atomic read-modify-write operations. Snapshots merge
+ *          all registered shards and may be taken from any thread.
+ *          Define MODBUS_CONV_NO_STATS to compile the counting out entirely.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_STATS_H
+#define MODBUS_STATS_H
+
+#include "modbus_conversion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MODBUS_CACHE_LINE
+#define MODBUS_CACHE_LINE               64
+#endif
+
+/* Number of data types and error codes tracked */
+#define MODBUS_STATS_TYPES              (MODBUS_IEEE_FLOAT64_EFGHABCD + 1)
+#define MODBUS_STATS_ERRORS             (-MODBUS_CONV_ERR_SYSTEM + 1)
+
+/* Counter set, errors are indexed by -error_code */
+typedef struct {
+    uint64_t conversions[MODBUS_STATS_TYPES];   /* Successful conversions per data type */
+    uint64_t errors[MODBUS_STATS_ERRORS];       /* Failed conversions per error code */
+    uint64_t scaling_overflows;                 /* Scaled values saturated to the type range */
+    uint64_t plans_executed;                    /* Plan executions */
+    uint64_t frames_parsed;                     /* Frames decoded successfully */
+    uint64_t frame_errors;                      /* Frames rejected by the decoder */
+} modbus_stats_t;
+
+/* Per-thread shard, padded to whole cache lines to avoid false sharing */
+typedef struct modbus_stats_shard {
+    modbus_stats_t stats;
+    struct modbus_stats_shard *next;
+#if defined(__GNUC__) || defined(__clang__)
+} __attribute__((aligned(MODBUS_CACHE_LINE))) modbus_stats_shard_t;
+#else
+} modbus_stats_shard_t;
+#endif
+
+/**
+ * @brief Attach a shard to the calling thread
+ * @details The shard is zeroed and registered for snapshots on its first
+ *          attach and used by every conversion on this thread. Re-attaching
+ *          a registered shard keeps its counts, so merged counters never
+ *          decrease. Shards stay registered for the life of the process, so
+ *          they must have static or equally long storage.
+ * @param shard Shard owned by the calling thread
+ * @return MODBUS_CONV_OK on success, error code otherwise
+ */
+int modbus_stats_attach(modbus_stats_shard_t *shard);
+
+/**
+ * @brief Get the counters of the calling thread's shard
+ * @return Counters, or NULL if no shard is attached
+ */
+modbus_stats_t *modbus_stats_local(void);
+
+/**
+ * @brief Merge all registered shards
+ * @param snapshot Pointer to store the merged counters
+ * @return MODBUS_CONV_OK on success, error code otherwise
+ */
+int modbus_stats_snapshot(modbus_stats_t *snapshot);
+
+/* Counter update for library modules: single writer, tear-free for readers */
+#if defined(MODBUS_CONV_NO_STATS)
+#define MODBUS_STATS_ADD(stats, field, n)   do { } while (0)
+#elif defined(__GNUC__) || defined(__clang__)
+#define MODBUS_STATS_ADD(stats, field, n)                                           \
+    do {                                                                            \
+        modbus_stats_t *stats_ = (stats);                                           \
+        if (stats_) {                                                               \
+            __atomic_store_n(&stats_->field,                                        \
+                __atomic_load_n(&stats_->field, __ATOMIC_RELAXED) + (n),            \
+                __ATOMIC_RELAXED);                                                  \
+        }                                                                           \
+    } while (0)
+#else
+#define MODBUS_STATS_ADD(stats, field, n)                                           \
+    do {                                                                            \
+        modbus_stats_t *stats_ = (stats);                                           \
+        if (stats_) {                                                               \
+            stats_->field += (n);                                                   \
+        }                                                                           \
+    } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_STATS_H */
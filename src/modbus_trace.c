@@ -0,0 +1,222 @@
+/**
+ * @file modbus_trace.c
+ * @brief Per-stage latency tracing implementation
+ * @author Mouli Sai
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "modbus_trace.h"
+#include "modbus_conversion.h"
+#include <string.h>
+
+#ifndef MODBUS_TRACE_CLOCK_NS
+#include <time.h>
+#endif
+
+/* Single-writer counters: relaxed loads/stores keep concurrent readers tear-free */
+#if defined(__GNUC__) || defined(__clang__)
+#define TRACE_LOAD(p)       __atomic_load_n((p), __ATOMIC_RELAXED)
+#define TRACE_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#else
+#define TRACE_LOAD(p)       (*(volatile const uint64_t *)(p))
+#define TRACE_STORE(p, v)   (*(volatile uint64_t *)(p) = (v))
+#endif
+
+#define TRACE_MAX_VALUE     ((1ull << MODBUS_TRACE_MAX_BITS) - 1)
+
+/* Helper function prototypes */
+static unsigned msb_index(uint64_t value);
+static size_t bucket_index(uint64_t value);
+static uint64_t bucket_highest(size_t index);
+static void hist_add(modbus_trace_hist_t *hist, uint64_t value);
+
+void modbus_trace_recorder_init(modbus_trace_recorder_t *rec)
+{
+    if (rec) {
+        memset(rec, 0, sizeof(*rec));
+    }
+}
+
+uint64_t modbus_trace_now(void)
+{
+#ifdef MODBUS_TRACE_CLOCK_NS
+    return (uint64_t)MODBUS_TRACE_CLOCK_NS();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void modbus_trace_stamp(modbus_trace_frame_t *frame, modbus_trace_stage_t stage)
+{
+    if (!frame || stage >= MODBUS_TRACE_STAGE_COUNT) {
+        return;
+    }
+
+    /* Starting a new frame clears stamps left over from the previous one */
+    if (stage == MODBUS_TRACE_RECEIVE) {
+        memset(frame, 0, sizeof(*frame));
+    }
+    frame->stamp[stage] = modbus_trace_now();
+}
+
+void modbus_trace_record(modbus_trace_recorder_t *rec, const modbus_trace_frame_t *frame)
+{
+    static const uint8_t span_from[MODBUS_TRACE_SPAN_COUNT] = {
+        MODBUS_TRACE_RECEIVE, MODBUS_TRACE_PARSE, MODBUS_TRACE_CONVERT, MODBUS_TRACE_RECEIVE
+    };
+    static const uint8_t span_to[MODBUS_TRACE_SPAN_COUNT] = {
+        MODBUS_TRACE_PARSE, MODBUS_TRACE_CONVERT, MODBUS_TRACE_PUBLISH, MODBUS_TRACE_PUBLISH
+    };
+    int span;
+
+    if (!rec || !frame) {
+        return;
+    }
+
+    for (span = 0; span < MODBUS_TRACE_SPAN_COUNT; span++) {
+        uint64_t from = frame->stamp[span_from[span]];
+        uint64_t to = frame->stamp[span_to[span]];
+        if (from != 0 && to >= from) {
+            hist_add(&rec->spans[span], to - from);
+        }
+    }
+}
+
+int modbus_trace_merge(const modbus_trace_recorder_t *const *recs,
+                       size_t count,
+                       modbus_trace_recorder_t *merged)
+{
+    size_t r, i;
+    int span;
+
+    if (!recs || !merged) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    memset(merged, 0, sizeof(*merged));
+    for (r = 0; r < count; r++) {
+        if (!recs[r]) {
+            continue;
+        }
+        for (span = 0; span < MODBUS_TRACE_SPAN_COUNT; span++) {
+            const modbus_trace_hist_t *src = &recs[r]->spans[span];
+            modbus_trace_hist_t *dst = &merged->spans[span];
+            uint64_t max = TRACE_LOAD(&src->max);
+
+            for (i = 0; i < MODBUS_TRACE_BUCKETS; i++) {
+                uint64_t c = TRACE_LOAD(&src->counts[i]);
+                dst->counts[i] += c;
+                dst->total += c;
+            }
+            dst->sum += TRACE_LOAD(&src->sum);
+            if (max > dst->max) {
+                dst->max = max;
+            }
+        }
+    }
+
+    return MODBUS_CONV_OK;
+}
+
+uint64_t modbus_trace_percentile(const modbus_trace_recorder_t *rec,
+                                 modbus_trace_span_t span,
+                                 double percentile)
+{
+    const modbus_trace_hist_t *hist;
+    uint64_t total = 0;
+    uint64_t target;
+    uint64_t seen = 0;
+    size_t i;
+
+    if (!rec || span >= MODBUS_TRACE_SPAN_COUNT) {
+        return 0;
+    }
+    hist = &rec->spans[span];
+
+    /* Sum the buckets rather than trusting total, which may lag a live writer */
+    for (i = 0; i < MODBUS_TRACE_BUCKETS; i++) {
+        total += TRACE_LOAD(&hist->counts[i]);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    if (percentile < 0.0) {
+        percentile = 0.0;
+    } else if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+    target = (uint64_t)(percentile / 100.0 * (double)total + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+
+    for (i = 0; i < MODBUS_TRACE_BUCKETS; i++) {
+        seen += TRACE_LOAD(&hist->counts[i]);
+        if (seen >= target) {
+            uint64_t value = bucket_highest(i);
+            uint64_t max = TRACE_LOAD(&hist->max);
+            return (max != 0 && value > max) ? max : value;
+        }
+    }
+    return TRACE_LOAD(&hist->max);
+}
+
+/* Helper function implementations */
+static unsigned msb_index(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - (unsigned)__builtin_clzll(value);
+#else
+    unsigned n = 0;
+    while (value >>= 1) {
+        n++;
+    }
+    return n;
+#endif
+}
+
+static size_t bucket_index(uint64_t value)
+{
+    unsigned shift;
+
+    if (value < 2u * MODBUS_TRACE_SUB_HALF) {
+        return (size_t)value;
+    }
+    if (value > TRACE_MAX_VALUE) {
+        value = TRACE_MAX_VALUE;
+    }
+    shift = msb_index(value) - (MODBUS_TRACE_SUB_BITS - 1);
+    return (size_t)MODBUS_TRACE_SUB_HALF * (shift + 1) +
+           (size_t)((value >> shift) - MODBUS_TRACE_SUB_HALF);
+}
+
+static uint64_t bucket_highest(size_t index)
+{
+    unsigned shift;
+    uint64_t sub;
+
+    if (index < 2u * MODBUS_TRACE_SUB_HALF) {
+        return (uint64_t)index;
+    }
+    shift = (unsigned)(index / MODBUS_TRACE_SUB_HALF) - 1;
+    sub = (uint64_t)(index % MODBUS_TRACE_SUB_HALF) + MODBUS_TRACE_SUB_HALF;
+    return ((sub + 1) << shift) - 1;
+}
+
+static void hist_add(modbus_trace_hist_t *hist, uint64_t value)
+{
+    uint64_t *slot = &hist->counts[bucket_index(value)];
+
+    TRACE_STORE(slot, TRACE_LOAD(slot) + 1);
+    TRACE_STORE(&hist->total, TRACE_LOAD(&hist->total) + 1);
+    TRACE_STORE(&hist->sum, TRACE_LOAD(&hist->sum) + value);
+    if (value > TRACE_LOAD(&hist->max)) {
+        TRACE_STORE(&hist->max, value);
+    }
+}
@@ -0,0 +1,126 @@
+/**
+ * @file modbus_trace.h
+ * @brief Per-stage latency tracing for Modbus frame processing
+ * @details Timestamps each frame at receive, parse, convert and publish and
+ *          aggregates the stage durations into per-thread HDR histograms.
+ *          Each recorder has a single writer thread; merged percentiles can be
+ *          read from any thread without stopping the writers.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_TRACE_H
+#define MODBUS_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Histogram precision: 2^MODBUS_TRACE_SUB_BITS linear sub-buckets per octave */
+#ifndef MODBUS_TRACE_SUB_BITS
+#define MODBUS_TRACE_SUB_BITS           6
+#endif
+
+/* Largest trackable duration is 2^MODBUS_TRACE_MAX_BITS - 1 nanoseconds */
+#ifndef MODBUS_TRACE_MAX_BITS
+#define MODBUS_TRACE_MAX_BITS           40
+#endif
+
+#define MODBUS_TRACE_SUB_HALF           (1u << (MODBUS_TRACE_SUB_BITS - 1))
+#define MODBUS_TRACE_BUCKETS            \
+    (MODBUS_TRACE_SUB_HALF * (MODBUS_TRACE_MAX_BITS - MODBUS_TRACE_SUB_BITS + 2))
+
+/* Frame processing stages, in pipeline order */
+typedef enum {
+    MODBUS_TRACE_RECEIVE,
+    MODBUS_TRACE_PARSE,
+    MODBUS_TRACE_CONVERT,
+    MODBUS_TRACE_PUBLISH,
+    MODBUS_TRACE_STAGE_COUNT
+} modbus_trace_stage_t;
+
+/* Measured spans between stage timestamps */
+typedef enum {
+    MODBUS_TRACE_SPAN_PARSE,        /* receive -> parse   */
+    MODBUS_TRACE_SPAN_CONVERT,      /* parse   -> convert */
+    MODBUS_TRACE_SPAN_PUBLISH,      /* convert -> publish */
+    MODBUS_TRACE_SPAN_TOTAL,        /* receive -> publish */
+    MODBUS_TRACE_SPAN_COUNT
+} modbus_trace_span_t;
+
+/* Stage timestamps of one frame in nanoseconds (0 = stage not stamped) */
+typedef struct {
+    uint64_t stamp[MODBUS_TRACE_STAGE_COUNT];
+} modbus_trace_frame_t;
+
+/* HDR histogram of durations in nanoseconds */
+typedef struct {
+    uint64_t counts[MODBUS_TRACE_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+} modbus_trace_hist_t;
+
+/* Per-thread recorder, one histogram per span */
+typedef struct {
+    modbus_trace_hist_t spans[MODBUS_TRACE_SPAN_COUNT];
+} modbus_trace_recorder_t;
+
+/**
+ * @brief Reset a recorder to empty histograms
+ * @param rec Recorder to initialize
+ */
+void modbus_trace_recorder_init(modbus_trace_recorder_t *rec);
+
+/**
+ * @brief Read the trace clock
+ * @return Monotonic time in nanoseconds
+ */
+uint64_t modbus_trace_now(void);
+
+/**
+ * @brief Timestamp a frame at a pipeline stage (one clock read)
+ * @param frame Frame timestamps to update
+ * @param stage Stage that has just completed
+ */
+void modbus_trace_stamp(modbus_trace_frame_t *frame, modbus_trace_stage_t stage);
+
+/**
+ * @brief Add the spans of a completed frame to a recorder
+ * @details Must only be called by the thread owning the recorder. Spans whose
+ *          stage timestamps are missing are skipped.
+ * @param rec Recorder owned by the calling thread
+ * @param frame Frame timestamps
+ */
+void modbus_trace_record(modbus_trace_recorder_t *rec, const modbus_trace_frame_t *frame);
+
+/**
+ * @brief Merge per-thread recorders into a snapshot
+ * @param recs Array of recorder pointers (NULL entries are skipped)
+ * @param count Number of recorders
+ * @param merged Recorder receiving the merged histograms
+ * @return MODBUS_CONV_OK on success, error code otherwise
+ */
+int modbus_trace_merge(const modbus_trace_recorder_t *const *recs,
+                       size_t count,
+                       modbus_trace_recorder_t *merged);
+
+/**
+ * @brief Get a percentile of a span from a (merged) recorder
+ * @param rec Recorder or merged snapshot
+ * @param span Span to query
+ * @param percentile Percentile in the range 0.0 - 100.0
+ * @return Duration in nanoseconds (highest value equivalent to the bucket), 0 if empty
+ */
+uint64_t modbus_trace_percentile(const modbus_trace_recorder_t *rec,
+                                 modbus_trace_span_t span,
+                                 double percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_TRACE_H */
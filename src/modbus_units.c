@@ -0,0 +1,113 @@
+/**
+ * @file modbus_units.c
+ * @brief Engineering unit conversion implementation
+ * @author Mouli Sai
+ */
+
+#include "modbus_units.h"
+
+/* Quantities */
+#define QTY_NONE                0
+#define QTY_TEMPERATURE         1
+#define QTY_ENERGY              2
+#define QTY_POWER               3
+#define QTY_PRESSURE            4
+#define QTY_VOLUME              5
+#define QTY_LENGTH              6
+#define QTY_VOLTAGE             7
+#define QTY_CURRENT             8
+
+/* Unit definition: base = value * scale + offset */
+typedef struct {
+    uint8_t quantity;
+    double scale;
+    double offset;
+} unit_def_t;
+
+/* Base units: kelvin, joule, watt, pascal, cubic metre, metre, volt, ampere */
+static const unit_def_t unit_defs[MODBUS_UNIT_COUNT] = {
+    [MODBUS_UNIT_NONE]       = { QTY_NONE,        1.0,          0.0 },
+    [MODBUS_UNIT_CELSIUS]    = { QTY_TEMPERATURE, 1.0,          273.15 },
+    [MODBUS_UNIT_FAHRENHEIT] = { QTY_TEMPERATURE, 5.0 / 9.0,    459.67 * 5.0 / 9.0 },
+    [MODBUS_UNIT_KELVIN]     = { QTY_TEMPERATURE, 1.0,          0.0 },
+    [MODBUS_UNIT_WH]         = { QTY_ENERGY,      3600.0,       0.0 },
+    [MODBUS_UNIT_KWH]        = { QTY_ENERGY,      3.6e6,        0.0 },
+    [MODBUS_UNIT_MWH]        = { QTY_ENERGY,      3.6e9,        0.0 },
+    [MODBUS_UNIT_JOULE]      = { QTY_ENERGY,      1.0,          0.0 },
+    [MODBUS_UNIT_W]          = { QTY_POWER,       1.0,          0.0 },
+    [MODBUS_UNIT_KW]         = { QTY_POWER,       1e3,          0.0 },
+    [MODBUS_UNIT_MW]         = { QTY_POWER,       1e6,          0.0 },
+    [MODBUS_UNIT_PA]         = { QTY_PRESSURE,    1.0,          0.0 },
+    [MODBUS_UNIT_KPA]        = { QTY_PRESSURE,    1e3,          0.0 },
+    [MODBUS_UNIT_MBAR]       = { QTY_PRESSURE,    100.0,        0.0 },
+    [MODBUS_UNIT_BAR]        = { QTY_PRESSURE,    1e5,          0.0 },
+    [MODBUS_UNIT_PSI]        = { QTY_PRESSURE,    6894.757293168, 0.0 },
+    [MODBUS_UNIT_LITRE]      = { QTY_VOLUME,      1e-3,         0.0 },
+    [MODBUS_UNIT_M3]         = { QTY_VOLUME,      1.0,          0.0 },
+    [MODBUS_UNIT_US_GALLON]  = { QTY_VOLUME,      3.785411784e-3, 0.0 },
+    [MODBUS_UNIT_MM]         = { QTY_LENGTH,      1e-3,         0.0 },
+    [MODBUS_UNIT_M]          = { QTY_LENGTH,      1.0,          0.0 },
+    [MODBUS_UNIT_INCH]       = { QTY_LENGTH,      0.0254,       0.0 },
+    [MODBUS_UNIT_FOOT]       = { QTY_LENGTH,      0.3048,       0.0 },
+    [MODBUS_UNIT_MV]         = { QTY_VOLTAGE,     1e-3,         0.0 },
+    [MODBUS_UNIT_V]          = { QTY_VOLTAGE,     1.0,          0.0 },
+    [MODBUS_UNIT_KV]         = { QTY_VOLTAGE,     1e3,          0.0 },
+    [MODBUS_UNIT_MA]         = { QTY_CURRENT,     1e-3,         0.0 },
+    [MODBUS_UNIT_A]          = { QTY_CURRENT,     1.0,          0.0 },
+};
+
+int modbus_unit_factors(modbus_unit_t from, modbus_unit_t to, double *scale, double *offset)
+{
+    const unit_def_t *f;
+    const unit_def_t *t;
+
+    if (!scale || !offset) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+    if ((unsigned)from >= MODBUS_UNIT_COUNT || (unsigned)to >= MODBUS_UNIT_COUNT) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+    f = &unit_defs[from];
+    t = &unit_defs[to];
+    if (f->quantity != t->quantity) {
+        return MODBUS_CONV_ERR_INVALID_TYPE;
+    }
+
+    /* to = (from * f.scale + f.offset - t.offset) / t.scale */
+    *scale = f->scale / t->scale;
+    *offset = (f->offset - t->offset) / t->scale;
+    return MODBUS_CONV_OK;
+}
+
+int modbus_units_fold(modbus_point_t *points, size_t point_count)
+{
+    size_t i;
+
+    if (!points && point_count > 0) {
+        return MODBUS_CONV_ERR_NULL_PTR;
+    }
+
+    for (i = 0; i < point_count; i++) {
+        modbus_point_t *p = &points[i];
+        double scale, offset;
+        int rc;
+
+        /* No target unit keeps the declared one */
+        if (p->target_unit == MODBUS_UNIT_NONE || p->unit == p->target_unit) {
+            continue;
+        }
+        if (p->calib || p->data_type == MODBUS_BIT_BOOLEAN) {
+            return MODBUS_CONV_ERR_INVALID_TYPE;
+        }
+        rc = modbus_unit_factors((modbus_unit_t)p->unit, (modbus_unit_t)p->target_unit,
+                                 &scale, &offset);
+        if (rc != MODBUS_CONV_OK) {
+            return rc;
+        }
+        /* (raw * s + o) * scale + offset */
+        p->scaling_factor *= scale;
+        p->value_offset = p->value_offset * scale + offset;
+        p->unit = p->target_unit;
+    }
+    return MODBUS_CONV_OK;
+}
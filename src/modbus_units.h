@@ -0,0 +1,101 @@
+/**
+ * @file modbus_units.h
+ * @brief Engineering unit conversion folded into point scaling
+ * @details Point descriptors may declare the unit of their scaled value and
+ *          the unit wanted by the application. modbus_units_fold() rewrites
+ *          such points so that the conversion becomes part of their
+ *          scaling_factor and value_offset; plan execution then converts
+ *          units with the same multiply-add it already performs.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_UNITS_H
+#define MODBUS_UNITS_H
+
+#include "modbus_plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Units, grouped by quantity */
+typedef enum {
+    MODBUS_UNIT_NONE,
+
+    /* Temperature */
+    MODBUS_UNIT_CELSIUS,
+    MODBUS_UNIT_FAHRENHEIT,
+    MODBUS_UNIT_KELVIN,
+
+    /* Energy */
+    MODBUS_UNIT_WH,
+    MODBUS_UNIT_KWH,
+    MODBUS_UNIT_MWH,
+    MODBUS_UNIT_JOULE,
+
+    /* Power */
+    MODBUS_UNIT_W,
+    MODBUS_UNIT_KW,
+    MODBUS_UNIT_MW,
+
+    /* Pressure */
+    MODBUS_UNIT_PA,
+    MODBUS_UNIT_KPA,
+    MODBUS_UNIT_MBAR,
+    MODBUS_UNIT_BAR,
+    MODBUS_UNIT_PSI,
+
+    /* Volume */
+    MODBUS_UNIT_LITRE,
+    MODBUS_UNIT_M3,
+    MODBUS_UNIT_US_GALLON,
+
+    /* Length */
+    MODBUS_UNIT_MM,
+    MODBUS_UNIT_M,
+    MODBUS_UNIT_INCH,
+    MODBUS_UNIT_FOOT,
+
+    /* Electrical */
+    MODBUS_UNIT_MV,
+    MODBUS_UNIT_V,
+    MODBUS_UNIT_KV,
+    MODBUS_UNIT_MA,
+    MODBUS_UNIT_A,
+
+    MODBUS_UNIT_COUNT
+} modbus_unit_t;
+
+/**
+ * @brief Linear conversion between two units: to = from * scale + offset
+ * @param from Source unit
+ * @param to Target unit
+ * @param scale Pointer to store the multiplier
+ * @param offset Pointer to store the offset
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE for unknown
+ *         units or units of different quantities
+ */
+int modbus_unit_factors(modbus_unit_t from, modbus_unit_t to, double *scale, double *offset);
+
+/**
+ * @brief Fold declared unit conversions into the scaling of points
+ * @details For every point with a target_unit that differs from its unit,
+ *          scaling_factor and value_offset are rewritten to produce the
+ *          target unit and unit is set to target_unit. A target_unit of
+ *          MODBUS_UNIT_NONE keeps the declared unit. Call before
+ *          modbus_plan_compile(), which rejects points with unfolded units.
+ *          Calibrated points are rejected; convert their table or
+ *          coefficients instead.
+ * @param points Point descriptors (modified)
+ * @param point_count Number of points
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE for the first
+ *         point with incompatible units (points before it are already folded)
+ */
+int modbus_units_fold(modbus_point_t *points, size_t point_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_UNITS_H */
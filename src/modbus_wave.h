@@ -0,0 +1,62 @@
+/**
+ * @file modbus_wave.h
+ * @brief Waveform capture decoding with per-cycle RMS, peak and crest factor
+ * @details Power-quality meters expose oscillography buffers of thousands of
+ *          int16 samples per channel. modbus_wave_decode() converts such a
+ *          block to scaled floats in one tight loop instead of a
+ *          modbus_convert() call per sample, and accumulates the sum of
+ *          squares and the peak of every cycle in the same pass. Sums are
+ *          kept in integers on the raw samples, so they are exact and the
+ *          scaling is applied once per cycle.
+ * @author Mouli Sai
+ * @version 1.0
+ */
+
+#ifndef MODBUS_WAVE_H
+#define MODBUS_WAVE_H
+
+#include "modbus_conversion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Statistics of one cycle, in scaled units */
+typedef struct {
+    double rms;                     /* Root mean square */
+    double peak;                    /* Largest absolute sample */
+    double crest;                   /* peak / rms, 0 for a zero cycle */
+} modbus_wave_cycle_t;
+
+/**
+ * @brief Convert an int16 waveform block and compute per-cycle statistics
+ * @details Only complete cycles are measured; trailing samples are converted
+ *          but not counted. Samples are always all converted, even when
+ *          max_cycles is too small.
+ * @param registers Sample registers, one sample per register
+ * @param sample_count Number of samples
+ * @param data_type MODBUS_INT16_SIGNED_AB or MODBUS_INT16_SIGNED_BA
+ * @param scaling_factor Units per count
+ * @param samples Array of sample_count floats receiving the scaled samples, may be NULL
+ * @param cycle_length Samples per cycle, 0 to skip the statistics
+ * @param cycles Array receiving the statistics of each complete cycle
+ * @param max_cycles Capacity of cycles
+ * @param cycle_count Pointer to store the number of cycles written, may be NULL
+ * @return MODBUS_CONV_OK on success, MODBUS_CONV_ERR_INVALID_TYPE for another
+ *         data type, MODBUS_CONV_ERR_BUFFER if cycles could not hold every cycle
+ */
+int modbus_wave_decode(const uint16_t *registers,
+                       size_t sample_count,
+                       modbus_data_type_t data_type,
+                       double scaling_factor,
+                       float *samples,
+                       size_t cycle_length,
+                       modbus_wave_cycle_t *cycles,
+                       size_t max_cycles,
+                       size_t *cycle_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_WAVE_H */